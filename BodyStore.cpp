@@ -0,0 +1,112 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+#include "BodyStore.h"
+#include <algorithm>
+#include <initializer_list>
+
+namespace {
+    template<typename T>
+    void permuteArray(std::vector<T>& values, const std::vector<size_t>& order) {
+        std::vector<T> result;
+        result.reserve(values.size());
+        for (size_t k : order) {
+            result.push_back(std::move(values[k]));
+        }
+        values.swap(result);
+    }
+}
+
+void BodyStore::reserve(size_t n) {
+    for (auto* array : {&x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &mass, &radius}) {
+        array->reserve(n);
+    }
+    id.reserve(n);
+    trajectory.reserve(n);
+    level.reserve(n);
+}
+
+void BodyStore::clear() {
+    for (auto* array : {&x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &mass, &radius}) {
+        array->clear();
+    }
+    id.clear();
+    trajectory.clear();
+    level.clear();
+}
+
+void BodyStore::add(const CelestialBody& body) {
+    glm::dvec3 p = body.getPosition();
+    glm::dvec3 v = body.getVelocity();
+    x.push_back(p.x);
+    y.push_back(p.y);
+    z.push_back(p.z);
+    vx.push_back(v.x);
+    vy.push_back(v.y);
+    vz.push_back(v.z);
+    ax.push_back(0.0);
+    ay.push_back(0.0);
+    az.push_back(0.0);
+    mass.push_back(body.getMass());
+    radius.push_back(body.getRadius());
+    id.push_back(nextId++);
+    trajectory.add(body.getTrajectory());
+    level.push_back(0);
+}
+
+void BodyStore::append(const BodyTable& table) {
+    const size_t n = size() + table.size();
+    std::vector<double>* targets[] = {&x, &y, &z, &vx, &vy, &vz, &mass, &radius};
+    const std::vector<double>* sources[] = {&table.x, &table.y, &table.z, &table.vx, &table.vy, &table.vz,
+                                            &table.mass, &table.radius};
+    for (size_t k = 0; k < 8; ++k) {
+        targets[k]->insert(targets[k]->end(), sources[k]->begin(), sources[k]->end());
+    }
+    for (auto* array : {&ax, &ay, &az}) {
+        array->resize(n, 0.0);
+    }
+    id.reserve(n);
+    while (id.size() < n) {
+        id.push_back(nextId++);
+    }
+    trajectory.addEmpty(table.size());
+    level.resize(n, 0);
+}
+
+void BodyStore::set(size_t i, const CelestialBody& body) {
+    glm::dvec3 p = body.getPosition();
+    glm::dvec3 v = body.getVelocity();
+    x[i] = p.x;
+    y[i] = p.y;
+    z[i] = p.z;
+    vx[i] = v.x;
+    vy[i] = v.y;
+    vz[i] = v.z;
+    mass[i] = body.getMass();
+    radius[i] = body.getRadius();
+}
+
+CelestialBody BodyStore::get(size_t i) const {
+    CelestialBody body(mass[i], getPosition(i), getVelocity(i), radius[i]);
+    std::vector<glm::vec3> points;
+    trajectory.copy(i, points);
+    for (const auto& point : points) {
+        body.addToTrajectory(glm::dvec3(point));
+    }
+    return body;
+}
+
+void BodyStore::permute(const std::vector<size_t>& order) {
+    for (auto* array : {&x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &mass, &radius}) {
+        permuteArray(*array, order);
+    }
+    permuteArray(id, order);
+    trajectory.permute(order);
+    permuteArray(level, order);
+}
+
+void BodyStore::clearAccelerations() {
+    std::fill(ax.begin(), ax.end(), 0.0);
+    std::fill(ay.begin(), ay.end(), 0.0);
+    std::fill(az.begin(), az.end(), 0.0);
+}
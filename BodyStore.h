@@ -0,0 +1,60 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+
+#ifndef GRAVITY_BODYSTORE_H
+#define GRAVITY_BODYSTORE_H
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "BodyTable.h"
+#include "CelestialBody.h"
+#include "TrajectoryStore.h"
+
+// Structure-of-arrays body storage. The hot per-step fields live in their own
+// contiguous arrays so force kernels can stream and vectorise over them;
+// CelestialBody is only used to move single bodies in and out.
+class BodyStore {
+public:
+    size_t size() const { return mass.size(); }
+    bool empty() const { return mass.empty(); }
+    void reserve(size_t n);
+    void clear();
+
+    void add(const CelestialBody& body);
+    // Appends every body of table, growing each array once
+    void append(const BodyTable& table);
+    void set(size_t i, const CelestialBody& body);
+    CelestialBody get(size_t i) const;
+    // Reorders every array so that new slot k holds what was in slot order[k].
+    // Bodies missing from order are dropped.
+    void permute(const std::vector<size_t>& order);
+    void clearAccelerations();
+
+    glm::dvec3 getPosition(size_t i) const { return glm::dvec3(x[i], y[i], z[i]); }
+    glm::dvec3 getVelocity(size_t i) const { return glm::dvec3(vx[i], vy[i], vz[i]); }
+    glm::dvec3 getAcceleration(size_t i) const { return glm::dvec3(ax[i], ay[i], az[i]); }
+    double getMass(size_t i) const { return mass[i]; }
+    double getRadius(size_t i) const { return radius[i]; }
+    uint64_t getId(size_t i) const { return id[i]; }
+    void addToTrajectory(size_t i, const glm::dvec3& position) { trajectory.push(i, glm::vec3(position)); }
+
+    // Hot data, one array per component
+    std::vector<double> x, y, z;
+    std::vector<double> vx, vy, vz;
+    std::vector<double> ax, ay, az;
+    std::vector<double> mass;
+
+    // Cold data, only touched by collisions and rendering
+    std::vector<double> radius;
+    std::vector<uint64_t> id;   // Stable across reordering and merges
+    TrajectoryStore trajectory;
+    std::vector<uint8_t> level; // Block timestep level, the body steps with dt / 2^level
+
+private:
+    friend class Checkpoint;
+
+    uint64_t nextId = 0;
+};
+#endif //GRAVITY_BODYSTORE_H
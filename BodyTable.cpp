@@ -0,0 +1,317 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+#include "BodyTable.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+namespace {
+    const char MAGIC[8] = {'G', 'R', 'A', 'V', 'B', 'O', 'D', 'Y'};
+    const uint64_t BYTE_ORDER_TAG = 0x0102030405060708ull;
+    const uint64_t VERSION = 1;
+    const size_t HEADER_SIZE = 32;
+    const size_t COLUMNS = 8;
+    const char* const COLUMN_NAMES[COLUMNS] = {"mass", "x", "y", "z", "vx", "vy", "vz", "radius"};
+    // Text per parse task. Large enough to amortise the task overhead, small
+    // enough that a few million rows split over every thread.
+    const size_t CSV_CHUNK_BYTES = size_t(1) << 22;
+
+    uint64_t byteSwap(uint64_t value) {
+        uint64_t result = 0;
+        for (int k = 0; k < 8; ++k) {
+            result = (result << 8) | (value & 0xff);
+            value >>= 8;
+        }
+        return result;
+    }
+
+    std::array<std::vector<double>*, COLUMNS> columns(BodyTable& table) {
+        return {&table.mass, &table.x, &table.y, &table.z, &table.vx, &table.vy, &table.vz, &table.radius};
+    }
+
+    std::array<const std::vector<double>*, COLUMNS> columns(const BodyTable& table) {
+        return {&table.mass, &table.x, &table.y, &table.z, &table.vx, &table.vy, &table.vz, &table.radius};
+    }
+
+    void forEachChunk(ThreadPool* pool, size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+        if (pool) {
+            pool->parallelFor(count, grain, body);
+        } else if (count > 0) {
+            body(0, count);
+        }
+    }
+
+    bool isBlank(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    size_t lineNumber(const char* text, size_t offset) {
+        size_t line = 1;
+        for (size_t i = 0; i < offset; ++i) {
+            line += text[i] == '\n';
+        }
+        return line;
+    }
+
+    BodyTable readBinary(const MappedFile& file, const std::string& path, ThreadPool* pool) {
+        if (file.size() < HEADER_SIZE) {
+            throw std::runtime_error(path + " is truncated");
+        }
+        uint64_t fields[3];
+        std::memcpy(fields, file.data() + sizeof(MAGIC), sizeof(fields));
+        const bool swapped = fields[0] != BYTE_ORDER_TAG;
+        if (swapped) {
+            if (fields[0] != byteSwap(BYTE_ORDER_TAG)) {
+                throw std::runtime_error(path + " has an unknown byte order");
+            }
+            for (uint64_t& field : fields) field = byteSwap(field);
+        }
+        if (fields[1] != VERSION) {
+            throw std::runtime_error(path + " is body table version " + std::to_string(fields[1])
+                                     + ", expected " + std::to_string(VERSION));
+        }
+        const uint64_t count = fields[2];
+        if (count > (file.size() - HEADER_SIZE) / (COLUMNS * sizeof(double))
+            || HEADER_SIZE + count * COLUMNS * sizeof(double) != file.size()) {
+            throw std::runtime_error(path + " is truncated or corrupt");
+        }
+
+        BodyTable table;
+        table.resize(count);
+        auto targets = columns(table);
+        const char* source = file.data() + HEADER_SIZE;
+        // Columns are copied in blocks so the page faults on the mapping spread over the pool
+        const size_t grain = 1 << 16;
+        forEachChunk(pool, count, grain, [&](size_t begin, size_t end) {
+            for (size_t c = 0; c < COLUMNS; ++c) {
+                double* out = targets[c]->data();
+                std::memcpy(out + begin, source + (c * count + begin) * sizeof(double),
+                            (end - begin) * sizeof(double));
+                if (!swapped) continue;
+                for (size_t i = begin; i < end; ++i) {
+                    uint64_t bits;
+                    std::memcpy(&bits, &out[i], 8);
+                    bits = byteSwap(bits);
+                    std::memcpy(&out[i], &bits, 8);
+                }
+            }
+        });
+        return table;
+    }
+
+    // Parses the header row at [begin, end), filling order with the table
+    // column of each field, or -1 for fields to skip
+    std::vector<int> parseHeader(const char* begin, const char* end, const std::string& path) {
+        std::vector<int> order;
+        bool found[COLUMNS] = {};
+        const char* p = begin;
+        while (true) {
+            while (p < end && isBlank(*p)) ++p;
+            const char* nameEnd = p;
+            while (nameEnd < end && *nameEnd != ',' && !isBlank(*nameEnd)) ++nameEnd;
+            std::string name(p, nameEnd);
+            for (char& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            int column = -1;
+            for (size_t c = 0; c < COLUMNS; ++c) {
+                if (name == COLUMN_NAMES[c]) column = static_cast<int>(c);
+            }
+            if (column >= 0) {
+                if (found[column]) throw std::runtime_error(path + ": column " + name + " appears twice");
+                found[column] = true;
+            }
+            order.push_back(column);
+            p = nameEnd;
+            while (p < end && isBlank(*p)) ++p;
+            if (p >= end) break;
+            if (*p != ',') throw std::runtime_error(path + ": header fields must be separated by commas");
+            ++p;
+        }
+        for (size_t c = 0; c < COLUMNS; ++c) {
+            if (!found[c]) throw std::runtime_error(path + ": missing column " + COLUMN_NAMES[c]);
+        }
+        return order;
+    }
+
+    // Parses the rows in [begin, end) into table. Returns the offset of the
+    // first malformed line from text, or SIZE_MAX if there is none.
+    size_t parseRows(const char* text, size_t begin, size_t end, const std::vector<int>& order, BodyTable& table) {
+        auto targets = columns(table);
+        double row[COLUMNS];
+        size_t lineStart = begin;
+        while (lineStart < end) {
+            const char* p = text + lineStart;
+            const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - lineStart));
+            if (!lineEnd) lineEnd = text + end;
+            const size_t next = static_cast<size_t>(lineEnd - text) + 1;
+
+            while (p < lineEnd && isBlank(*p)) ++p;
+            if (p == lineEnd || *p == '#') {
+                lineStart = next;
+                continue;
+            }
+            for (size_t field = 0; field < order.size(); ++field) {
+                while (p < lineEnd && isBlank(*p)) ++p;
+                if (p < lineEnd && *p == '+') ++p;  // from_chars only takes a minus sign
+                double value;
+                auto result = std::from_chars(p, lineEnd, value);
+                if (result.ec != std::errc()) return lineStart;
+                p = result.ptr;
+                while (p < lineEnd && isBlank(*p)) ++p;
+                if (field + 1 < order.size()) {
+                    if (p == lineEnd || *p != ',') return lineStart;
+                    ++p;
+                }
+                if (order[field] >= 0) row[order[field]] = value;
+            }
+            if (p != lineEnd) return lineStart;
+            for (size_t c = 0; c < COLUMNS; ++c) {
+                targets[c]->push_back(row[c]);
+            }
+            lineStart = next;
+        }
+        return SIZE_MAX;
+    }
+
+    BodyTable readCsv(const MappedFile& file, const std::string& path, ThreadPool* pool) {
+        const char* text = file.data();
+        const size_t size = file.size();
+
+        // Skip leading comments and take the column order from the header, if any
+        std::vector<int> order = {0, 1, 2, 3, 4, 5, 6, 7};
+        size_t dataStart = 0;
+        while (dataStart < size) {
+            const char* lineEnd = static_cast<const char*>(std::memchr(text + dataStart, '\n', size - dataStart));
+            const size_t end = lineEnd ? static_cast<size_t>(lineEnd - text) : size;
+            size_t first = dataStart;
+            while (first < end && isBlank(text[first])) ++first;
+            if (first < end && text[first] != '#') {
+                if (std::isalpha(static_cast<unsigned char>(text[first]))) {
+                    order = parseHeader(text + first, text + end, path);
+                    dataStart = std::min(end + 1, size);
+                }
+                break;
+            }
+            dataStart = std::min(end + 1, size);
+        }
+
+        // Cut the rows into chunks at line breaks and parse each into its own table
+        std::vector<size_t> bounds = {dataStart};
+        for (size_t at = dataStart + CSV_CHUNK_BYTES; at < size; at += CSV_CHUNK_BYTES) {
+            const void* lineEnd = std::memchr(text + at - 1, '\n', size - at + 1);
+            size_t start = lineEnd ? static_cast<size_t>(static_cast<const char*>(lineEnd) - text) + 1 : size;
+            if (start >= size) break;
+            if (start > bounds.back()) bounds.push_back(start);
+            at = std::max(at, start);
+        }
+        bounds.push_back(size);
+        const size_t chunks = bounds.size() - 1;
+
+        std::vector<BodyTable> parts(chunks);
+        std::vector<size_t> errors(chunks, SIZE_MAX);
+        forEachChunk(pool, chunks, 1, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                // A guess of 12 characters per field, the columns grow if rows are shorter
+                parts[k].reserve((bounds[k + 1] - bounds[k]) / (12 * order.size()));
+                errors[k] = parseRows(text, bounds[k], bounds[k + 1], order, parts[k]);
+            }
+        });
+        for (size_t k = 0; k < chunks; ++k) {
+            if (errors[k] != SIZE_MAX) {
+                throw std::runtime_error(path + ":" + std::to_string(lineNumber(text, errors[k]))
+                                         + ": expected " + std::to_string(order.size()) + " comma-separated numbers");
+            }
+        }
+
+        // Concatenate in file order
+        std::vector<size_t> offsets(chunks + 1, 0);
+        for (size_t k = 0; k < chunks; ++k) {
+            offsets[k + 1] = offsets[k] + parts[k].size();
+        }
+        BodyTable table;
+        table.resize(offsets[chunks]);
+        auto targets = columns(table);
+        forEachChunk(pool, chunks, 1, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                const BodyTable& part = parts[k];
+                auto sources = columns(part);
+                for (size_t c = 0; c < COLUMNS; ++c) {
+                    std::copy(sources[c]->begin(), sources[c]->end(), targets[c]->begin() + offsets[k]);
+                }
+                parts[k] = BodyTable();
+            }
+        });
+        return table;
+    }
+}
+
+void BodyTable::reserve(size_t n) {
+    for (auto* column : columns(*this)) {
+        column->reserve(n);
+    }
+}
+
+void BodyTable::resize(size_t n) {
+    for (auto* column : columns(*this)) {
+        column->resize(n);
+    }
+}
+
+void BodyTable::add(double bodyMass, const glm::dvec3& position, const glm::dvec3& velocity, double bodyRadius) {
+    resize(size() + 1);
+    set(size() - 1, bodyMass, position, velocity, bodyRadius);
+}
+
+void BodyTable::set(size_t i, double bodyMass, const glm::dvec3& position, const glm::dvec3& velocity,
+                    double bodyRadius) {
+    mass[i] = bodyMass;
+    x[i] = position.x;
+    y[i] = position.y;
+    z[i] = position.z;
+    vx[i] = velocity.x;
+    vy[i] = velocity.y;
+    vz[i] = velocity.z;
+    radius[i] = bodyRadius;
+}
+
+void BodyTable::append(const BodyTable& other) {
+    auto targets = columns(*this);
+    auto sources = columns(other);
+    for (size_t c = 0; c < COLUMNS; ++c) {
+        targets[c]->insert(targets[c]->end(), sources[c]->begin(), sources[c]->end());
+    }
+}
+
+BodyTable readBodyTable(const std::string& path, ThreadPool* pool) {
+    MappedFile file(path);
+    if (file.size() >= sizeof(MAGIC) && std::memcmp(file.data(), MAGIC, sizeof(MAGIC)) == 0) {
+        return readBinary(file, path, pool);
+    }
+    return readCsv(file, path, pool);
+}
+
+void writeBodyTable(const BodyTable& table, const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("Failed to open " + path + " for writing");
+    }
+    const uint64_t fields[3] = {BYTE_ORDER_TAG, VERSION, table.size()};
+    bool written = std::fwrite(MAGIC, sizeof(MAGIC), 1, file) == 1
+                   && std::fwrite(fields, sizeof(fields), 1, file) == 1;
+    for (const auto* column : columns(table)) {
+        written = written && std::fwrite(column->data(), sizeof(double), column->size(), file) == column->size();
+    }
+    written = std::fclose(file) == 0 && written;
+    if (!written) {
+        std::remove(path.c_str());
+        throw std::runtime_error("Failed to write body table " + path);
+    }
+}
@@ -0,0 +1,48 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+
+#ifndef GRAVITY_BODYTABLE_H
+#define GRAVITY_BODYTABLE_H
+#pragma once
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Initial conditions in column form, for handing many bodies to
+// Simulator::addBodies at once instead of one CelestialBody at a time
+struct BodyTable {
+    std::vector<double> mass;
+    std::vector<double> x, y, z;
+    std::vector<double> vx, vy, vz;
+    std::vector<double> radius;
+
+    size_t size() const { return mass.size(); }
+    void reserve(size_t n);
+    void resize(size_t n);
+    void add(double bodyMass, const glm::dvec3& position, const glm::dvec3& velocity, double bodyRadius);
+    void set(size_t i, double bodyMass, const glm::dvec3& position, const glm::dvec3& velocity, double bodyRadius);
+    void append(const BodyTable& other);
+};
+
+// Reads a body table from a CSV or binary file, choosing by the file's first
+// bytes. Files are mapped rather than read, and CSV text is parsed in
+// parallel on pool when one is given. Throws std::runtime_error with the
+// offending line on malformed input.
+//
+// CSV rows hold mass, x, y, z, vx, vy, vz and radius in SI units. Lines
+// starting with '#' are comments. An optional header row of those names
+// gives the column order, otherwise it is the one above. Columns with other
+// names are skipped but must still be numbers.
+//
+// The binary format is a 32-byte header (the magic "GRAVBODY", a byte-order
+// tag, a version and the body count, each 8 bytes) followed by the eight
+// columns as arrays of doubles, in the order above. A file written on a
+// machine of the other byte order is swapped on load.
+BodyTable readBodyTable(const std::string& path, ThreadPool* pool = nullptr);
+// Writes table in the binary format. Throws std::runtime_error on failure.
+void writeBodyTable(const BodyTable& table, const std::string& path);
+
+#endif //GRAVITY_BODYTABLE_H
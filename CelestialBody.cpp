@@ -13,7 +13,7 @@ std::string vec3_to_string(const glm::vec3& v) {
 }
 
 CelestialBody::CelestialBody(double mass, const glm::dvec3& position, const glm::dvec3& velocity, double radius)
-        : mass(mass), position(position), velocity(velocity), acceleration(0.0f) {}
+        : mass(mass), position(position), velocity(velocity), acceleration(0.0f), radius(radius) {}
 
 void CelestialBody::update(double dt) {
     // Runge-Kutta 4th order method
@@ -39,10 +39,3 @@ void CelestialBody::update(double dt) {
 void CelestialBody::applyForce(const glm::dvec3& force) {
     acceleration += force / mass;
 }
-
-void CelestialBody::addToTrajectory(const glm::dvec3& position) {
-    trajectory.push_back(position);
-    if (trajectory.size() > MAX_TRAJECTORY_POINTS) {
-        trajectory.erase(trajectory.begin());
-    }
-}
\ No newline at end of file
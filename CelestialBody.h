@@ -19,7 +19,8 @@ public:
     [[nodiscard]] double getMass() const { return mass; }
     [[nodiscard]] glm::dvec3 getPosition() const { return position; }
     [[nodiscard]] glm::dvec3 getVelocity() const { return velocity; }
-    void addToTrajectory(const glm::dvec3& position);
+    // History carried into and out of a BodyStore, which keeps the bounded copy
+    void addToTrajectory(const glm::dvec3& position) { trajectory.push_back(position); }
     const std::vector<glm::dvec3>& getTrajectory() const { return trajectory; }
     double getRadius() const { return radius; }
 
@@ -29,7 +30,6 @@ private:
     glm::dvec3 velocity;
     glm::dvec3 acceleration;
     std::vector<glm::dvec3> trajectory;
-    static const size_t MAX_TRAJECTORY_POINTS = 1000;
     double radius;
 };
 #endif //GRAVITY_CELESTIALBODY_H
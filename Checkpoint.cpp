@@ -0,0 +1,255 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+#include "Checkpoint.h"
+#include "MappedFile.h"
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+namespace {
+    const char MAGIC[8] = {'G', 'R', 'A', 'V', 'C', 'K', 'P', 'T'};
+    // Reads back as 0x0807060504030201 on a machine of the other byte order
+    const uint64_t BYTE_ORDER_TAG = 0x0102030405060708ull;
+    const size_t ALIGNMENT = 64;
+
+    // Header flags
+    const uint64_t PIN_HEAVIEST_BODY = 1;
+    const uint64_t BLOCK_TIMESTEPS = 2;
+    const uint64_t ACCELERATIONS_VALID = 4;
+    const uint64_t MASS_ORDER_DIRTY = 8;
+    const uint64_t MESH_CLOUD_IN_CELL = 16;
+
+    // Every field is 8 bytes wide, so a foreign file is fixed up by swapping
+    // each one in place
+    struct Header {
+        char magic[8];
+        uint64_t byteOrder;
+        uint64_t version;
+        uint64_t fileSize;
+        uint64_t bodyCount;
+        uint64_t nextId;
+        double time;
+        uint64_t forceEvaluations;
+        uint64_t forceSolver;
+        uint64_t integrator;
+        double openingAngle;      // Barnes-Hut's
+        uint64_t flags;
+        uint64_t maxLevel;
+        double timestepAccuracy;
+        uint64_t multipoleOrder;
+        uint64_t meshSize;
+        double multipoleOpeningAngle;
+    };
+
+    size_t alignUp(size_t bytes) {
+        return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    // The double arrays of a body store, in file order. The id and level arrays follow them.
+    template <typename Store>
+    auto doubleArrays(Store& bodies) {
+        return std::array<decltype(&bodies.x), 11>{&bodies.x, &bodies.y, &bodies.z,
+                                                   &bodies.vx, &bodies.vy, &bodies.vz,
+                                                   &bodies.ax, &bodies.ay, &bodies.az,
+                                                   &bodies.mass, &bodies.radius};
+    }
+
+    size_t fileSize(size_t bodyCount) {
+        return alignUp(sizeof(Header)) + 12 * alignUp(bodyCount * 8) + alignUp(bodyCount);
+    }
+
+    uint64_t byteSwap(uint64_t value) {
+        uint64_t result = 0;
+        for (int k = 0; k < 8; ++k) {
+            result = (result << 8) | (value & 0xff);
+            value >>= 8;
+        }
+        return result;
+    }
+
+    template <typename T>
+    void readArray(const char* source, size_t count, bool swapped, std::vector<T>& out) {
+        static_assert(sizeof(T) == 8, "only 8-byte fields need swapping");
+        out.resize(count);
+        if (count == 0) return;
+        std::memcpy(out.data(), source, count * sizeof(T));
+        if (!swapped) return;
+        for (T& value : out) {
+            uint64_t bits;
+            std::memcpy(&bits, &value, 8);
+            bits = byteSwap(bits);
+            std::memcpy(&value, &bits, 8);
+        }
+    }
+}
+
+void Checkpoint::save(const Simulator& simulator, const std::string& path) {
+    std::vector<char> image;
+    serialize(simulator, image);
+    write(image, path);
+}
+
+void Checkpoint::serialize(const Simulator& simulator, std::vector<char>& image) {
+    const BodyStore& bodies = simulator.bodies;
+    const size_t n = bodies.size();
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.byteOrder = BYTE_ORDER_TAG;
+    header.version = VERSION;
+    header.fileSize = fileSize(n);
+    header.bodyCount = n;
+    header.nextId = bodies.nextId;
+    header.time = simulator.time;
+    header.forceEvaluations = simulator.forceEvaluations;
+    header.forceSolver = static_cast<uint64_t>(simulator.forceSolver);
+    header.integrator = static_cast<uint64_t>(simulator.integrator);
+    header.openingAngle = simulator.octree.getOpeningAngle();
+    header.flags = (simulator.pinHeaviestBody ? PIN_HEAVIEST_BODY : 0)
+                   | (simulator.blockTimesteps ? BLOCK_TIMESTEPS : 0)
+                   | (simulator.accelerationsValid ? ACCELERATIONS_VALID : 0)
+                   | (simulator.massOrderDirty ? MASS_ORDER_DIRTY : 0)
+                   | (simulator.getMassAssignment() == MassAssignment::CloudInCell ? MESH_CLOUD_IN_CELL : 0);
+    header.maxLevel = static_cast<uint64_t>(simulator.maxLevel);
+    header.timestepAccuracy = simulator.timestepAccuracy;
+    header.multipoleOrder = static_cast<uint64_t>(simulator.getMultipoleOrder());
+    header.meshSize = simulator.getMeshSize();
+    header.multipoleOpeningAngle = simulator.multipole.getOpeningAngle();
+
+    image.resize(header.fileSize);
+    size_t offset = 0;
+    auto put = [&image, &offset](const void* source, size_t bytes) {
+        if (bytes > 0) std::memcpy(image.data() + offset, source, bytes);
+        std::memset(image.data() + offset + bytes, 0, alignUp(bytes) - bytes);
+        offset += alignUp(bytes);
+    };
+    put(&header, sizeof(header));
+    for (const auto* array : doubleArrays(bodies)) {
+        put(array->data(), n * sizeof(double));
+    }
+    put(bodies.id.data(), n * sizeof(uint64_t));
+    put(bodies.level.data(), n);
+}
+
+void Checkpoint::write(const std::vector<char>& image, const std::string& path) {
+    const std::string temporary = path + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("Failed to open " + temporary + " for writing");
+    }
+    bool written = std::fwrite(image.data(), 1, image.size(), file) == image.size();
+    written = std::fclose(file) == 0 && written;
+    std::error_code renameError;
+    if (written) {
+        std::filesystem::rename(temporary, path, renameError);
+    }
+    if (!written || renameError) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Failed to write checkpoint " + path);
+    }
+}
+
+void Checkpoint::load(Simulator& simulator, const std::string& path) {
+    MappedFile file(path);
+    if (file.size() < sizeof(Header)) {
+        throw std::runtime_error(path + " is not a checkpoint");
+    }
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error(path + " is not a checkpoint");
+    }
+    const bool swapped = header.byteOrder != BYTE_ORDER_TAG;
+    if (swapped) {
+        if (header.byteOrder != byteSwap(BYTE_ORDER_TAG)) {
+            throw std::runtime_error(path + " has an unknown byte order");
+        }
+        char* fields = reinterpret_cast<char*>(&header) + sizeof(header.magic);
+        for (size_t at = 0; at < sizeof(header) - sizeof(header.magic); at += 8) {
+            uint64_t bits;
+            std::memcpy(&bits, fields + at, 8);
+            bits = byteSwap(bits);
+            std::memcpy(fields + at, &bits, 8);
+        }
+    }
+    if (header.version != VERSION) {
+        throw std::runtime_error(path + " is checkpoint version " + std::to_string(header.version)
+                                 + ", this build reads version " + std::to_string(VERSION));
+    }
+    const size_t n = header.bodyCount;
+    if (header.fileSize != file.size() || header.fileSize != fileSize(n)) {
+        throw std::runtime_error(path + " is truncated or corrupt");
+    }
+    if (header.forceSolver > static_cast<uint64_t>(ForceSolver::ParticleMesh)
+        || header.integrator > static_cast<uint64_t>(Integrator::Yoshida4) || header.maxLevel > 30
+        || header.multipoleOrder < 1 || header.multipoleOrder > FastMultipole::MAX_ORDER
+        || header.meshSize < ParticleMesh::MIN_SIZE || header.meshSize > ParticleMesh::MAX_SIZE) {
+        throw std::runtime_error(path + " has invalid settings");
+    }
+
+    BodyStore& bodies = simulator.bodies;
+    bodies.clear();
+    const char* source = file.data() + alignUp(sizeof(Header));
+    for (auto* array : doubleArrays(bodies)) {
+        readArray(source, n, swapped, *array);
+        source += alignUp(n * sizeof(double));
+    }
+    readArray(source, n, swapped, bodies.id);
+    source += alignUp(n * sizeof(uint64_t));
+    bodies.level.assign(source, source + n);
+    bodies.nextId = header.nextId;
+    bodies.trajectory.reserve(n);
+    const std::vector<glm::dvec3> noHistory;
+    for (size_t i = 0; i < n; ++i) {
+        bodies.trajectory.add(noHistory);
+    }
+
+    simulator.time = header.time;
+    simulator.forceEvaluations = header.forceEvaluations;
+    simulator.forceSolver = static_cast<ForceSolver>(header.forceSolver);
+    simulator.integrator = static_cast<Integrator>(header.integrator);
+    simulator.octree.setOpeningAngle(header.openingAngle);
+    simulator.multipole.setOpeningAngle(header.multipoleOpeningAngle);
+    simulator.multipole.setOrder(static_cast<int>(header.multipoleOrder));
+    simulator.mesh.setSize(header.meshSize);
+    simulator.mesh.setAssignment((header.flags & MESH_CLOUD_IN_CELL) != 0 ? MassAssignment::CloudInCell
+                                                                           : MassAssignment::TriangularShapedCloud);
+    simulator.pinHeaviestBody = (header.flags & PIN_HEAVIEST_BODY) != 0;
+    simulator.blockTimesteps = (header.flags & BLOCK_TIMESTEPS) != 0;
+    simulator.accelerationsValid = (header.flags & ACCELERATIONS_VALID) != 0;
+    simulator.massOrderDirty = (header.flags & MASS_ORDER_DIRTY) != 0;
+    simulator.maxLevel = static_cast<int>(header.maxLevel);
+    simulator.timestepAccuracy = header.timestepAccuracy;
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void CheckpointWriter::save(const Simulator& simulator, const std::string& path) {
+    wait();
+    Checkpoint::serialize(simulator, image);
+    thread = std::thread([this, path]() {
+        try {
+            Checkpoint::write(image, path);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    });
+}
+
+void CheckpointWriter::wait() {
+    if (thread.joinable()) {
+        thread.join();
+    }
+    if (error) {
+        std::exception_ptr failed = error;
+        error = nullptr;
+        std::rethrow_exception(failed);
+    }
+}
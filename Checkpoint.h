@@ -0,0 +1,64 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+
+#ifndef GRAVITY_CHECKPOINT_H
+#define GRAVITY_CHECKPOINT_H
+#pragma once
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Simulator.h"
+
+// Binary snapshot of a Simulator: every body array, the simulation time, and
+// the solver and integrator settings, so a restarted run continues bit for
+// bit where the saved one left off. Trajectories are display history and are
+// not saved, a restarted run starts with empty trails. So does the thread
+// count, which is a property of the machine rather than the run.
+//
+// The file is a fixed header followed by one array per body field, each
+// aligned to 64 bytes, in the byte order of the machine that wrote it. The
+// header records that byte order, so a file from a machine of the other
+// order is still read correctly, just without the fast path. Loading maps the
+// file and copies each array straight into the body store.
+//
+// All functions throw std::runtime_error when a file can't be read or written,
+// or isn't a checkpoint of a supported version.
+class Checkpoint {
+public:
+    static const uint64_t VERSION = 1;
+
+    static void save(const Simulator& simulator, const std::string& path);
+    // Replaces the simulator's bodies and settings with the checkpoint's
+    static void load(Simulator& simulator, const std::string& path);
+
+    // The complete file contents, for writing later
+    static void serialize(const Simulator& simulator, std::vector<char>& image);
+    // Writes through a temporary file and renames it over path, so a crash
+    // mid-write leaves the previous checkpoint intact
+    static void write(const std::vector<char>& image, const std::string& path);
+};
+
+// Periodic checkpoints off the stepping thread. save() only copies the state
+// into memory, and a background thread writes it out while the simulation
+// carries on.
+class CheckpointWriter {
+public:
+    CheckpointWriter() = default;
+    ~CheckpointWriter();
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // Waits for the previous checkpoint to finish, then starts this one
+    void save(const Simulator& simulator, const std::string& path);
+    // Blocks until the last checkpoint is written, and rethrows its error if it failed
+    void wait();
+
+private:
+    std::vector<char> image;
+    std::thread thread;
+    std::exception_ptr error;
+};
+#endif //GRAVITY_CHECKPOINT_H
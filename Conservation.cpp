@@ -0,0 +1,100 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+#include "Conservation.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+    const size_t CHUNK = 4096;
+
+    struct Sums {
+        double kinetic = 0.0;
+        glm::dvec3 momentum{0.0};
+        glm::dvec3 angularMomentum{0.0};
+        glm::dvec3 weighted{0.0};  // sum m (r - pivot)
+        double mass = 0.0;
+        double momentumScale = 0.0;
+        double angularMomentumScale = 0.0;
+        double inertia = 0.0;      // sum m |r - pivot|^2
+    };
+
+    double relative(double change, double scale) {
+        return scale > 0.0 ? change / scale : 0.0;
+    }
+}
+
+ConservationSample measureConservation(const BodyStore& bodies, double potentialEnergy, double time,
+                                       const glm::dvec3& pivot, bool restFirst, ThreadPool* pool) {
+    const size_t n = bodies.size();
+    std::vector<Sums> partial((n + CHUNK - 1) / CHUNK);
+    auto sum = [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            Sums& s = partial[c];
+            for (size_t i = c * CHUNK; i < std::min((c + 1) * CHUNK, n); ++i) {
+                const double m = bodies.mass[i];
+                const glm::dvec3 r = bodies.getPosition(i) - pivot;
+                const glm::dvec3 v = restFirst && i == 0 ? glm::dvec3(0.0) : bodies.getVelocity(i);
+                const glm::dvec3 p = m * v;
+                const glm::dvec3 l = glm::cross(r, p);
+                s.kinetic += 0.5 * glm::dot(p, v);
+                s.momentum += p;
+                s.angularMomentum += l;
+                s.weighted += m * r;
+                s.mass += m;
+                s.momentumScale += glm::length(p);
+                s.angularMomentumScale += glm::length(l);
+                s.inertia += m * glm::dot(r, r);
+            }
+        }
+    };
+    if (pool) {
+        pool->parallelFor(partial.size(), 1, sum);
+    } else {
+        sum(0, partial.size());
+    }
+
+    Sums total;
+    for (const Sums& s : partial) {
+        total.kinetic += s.kinetic;
+        total.momentum += s.momentum;
+        total.angularMomentum += s.angularMomentum;
+        total.weighted += s.weighted;
+        total.mass += s.mass;
+        total.momentumScale += s.momentumScale;
+        total.angularMomentumScale += s.angularMomentumScale;
+        total.inertia += s.inertia;
+    }
+
+    ConservationSample sample;
+    sample.time = time;
+    sample.kineticEnergy = total.kinetic;
+    sample.potentialEnergy = potentialEnergy;
+    sample.momentum = total.momentum;
+    sample.angularMomentum = total.angularMomentum;
+    sample.mass = total.mass;
+    sample.momentumScale = total.momentumScale;
+    sample.angularMomentumScale = total.angularMomentumScale;
+    if (total.mass > 0.0) {
+        const glm::dvec3 offset = total.weighted / total.mass;
+        sample.centerOfMass = pivot + offset;
+        sample.radius = std::sqrt(std::max(total.inertia / total.mass - glm::dot(offset, offset), 0.0));
+    }
+    return sample;
+}
+
+ConservationDrift conservationDrift(const ConservationSample& reference, const ConservationSample& sample) {
+    ConservationDrift drift;
+    drift.energy = relative(std::abs(sample.totalEnergy() - reference.totalEnergy()),
+                            std::abs(reference.totalEnergy()));
+    drift.momentum = relative(glm::length(sample.momentum - reference.momentum), reference.momentumScale);
+    drift.angularMomentum = relative(glm::length(sample.angularMomentum - reference.angularMomentum),
+                                     reference.angularMomentumScale);
+    if (reference.mass > 0.0) {
+        const glm::dvec3 expected = reference.centerOfMass
+                                    + reference.momentum / reference.mass * (sample.time - reference.time);
+        drift.centerOfMass = relative(glm::length(sample.centerOfMass - expected), reference.radius);
+    }
+    return drift;
+}
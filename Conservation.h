@@ -0,0 +1,47 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+
+#ifndef GRAVITY_CONSERVATION_H
+#define GRAVITY_CONSERVATION_H
+#pragma once
+#include <glm/glm.hpp>
+#include "BodyStore.h"
+#include "ThreadPool.h"
+
+// The quantities an isolated system keeps, at one time
+struct ConservationSample {
+    double time = 0.0;
+    double kineticEnergy = 0.0;       // J
+    double potentialEnergy = 0.0;     // J, softened, as the force solver sees it
+    glm::dvec3 momentum{0.0};         // kg m/s
+    glm::dvec3 angularMomentum{0.0};  // kg m^2/s, about the pivot
+    glm::dvec3 centerOfMass{0.0};     // m
+    double mass = 0.0;                // kg
+    // What the drifts are measured against: sum m |v|, sum m |r x v| and the
+    // rms distance of the mass from the centre of mass
+    double momentumScale = 0.0;
+    double angularMomentumScale = 0.0;
+    double radius = 0.0;
+
+    double totalEnergy() const { return kineticEnergy + potentialEnergy; }
+};
+
+// How far a sample has moved from a reference, each relative to the reference
+struct ConservationDrift {
+    double energy = 0.0;           // |E - E0| / |E0|
+    double momentum = 0.0;         // |P - P0| / sum m |v|
+    double angularMomentum = 0.0;  // |L - L0| / sum m |r x v|
+    double centerOfMass = 0.0;     // |R - R0 - V0 (t - t0)| / rms radius, V0 = P0 / M
+};
+
+// Everything but the potential energy, which the caller takes from its force
+// evaluation, in one O(N) pass. With restFirst the first body is held in
+// place (the pinned body), so it counts as at rest whatever its velocity.
+// Chunks are summed in order, so the result is the same for any thread count.
+ConservationSample measureConservation(const BodyStore& bodies, double potentialEnergy, double time,
+                                       const glm::dvec3& pivot, bool restFirst, ThreadPool* pool = nullptr);
+
+ConservationDrift conservationDrift(const ConservationSample& reference, const ConservationSample& sample);
+
+#endif //GRAVITY_CONSERVATION_H
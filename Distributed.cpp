@@ -0,0 +1,511 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+#include "Distributed.h"
+#include "Profiler.h"
+#include "Simulator.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+    // Key samples each rank contributes to finding the splitters. The load of
+    // a rank can miss its share by about one sample's worth of work.
+    const size_t SAMPLES_PER_RANK = 256;
+    // Cells outlining a domain. One bounding box would do, but a few stray
+    // bodies stretch it over everyone else's domain, and then nothing passes
+    // the opening test.
+    const size_t COVER_CELLS = 64;
+
+    void run(ThreadPool* pool, size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+        if (pool) {
+            pool->parallelFor(count, grain, body);
+        } else if (count > 0) {
+            body(0, count);
+        }
+    }
+
+    template<typename T>
+    void put(Transport::Message& message, const T& value) {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        message.insert(message.end(), bytes, bytes + sizeof(T));
+    }
+
+    class Reader {
+    public:
+        explicit Reader(const Transport::Message& message) : message(message) {}
+
+        template<typename T>
+        T get() {
+            if (offset + sizeof(T) > message.size()) {
+                throw std::runtime_error("Truncated message from another rank");
+            }
+            T value;
+            std::memcpy(&value, message.data() + offset, sizeof(T));
+            offset += sizeof(T);
+            return value;
+        }
+        bool done() const { return offset >= message.size(); }
+
+    private:
+        const Transport::Message& message;
+        size_t offset = 0;
+    };
+
+    // Spreads the low 21 bits of v so that two zero bits follow each one
+    uint64_t spread(uint32_t v) {
+        uint64_t x = v & 0x1fffff;
+        x = (x | x << 32) & 0x1f00000000ffffULL;
+        x = (x | x << 16) & 0x1f0000ff0000ffULL;
+        x = (x | x << 8) & 0x100f00f00f00f00fULL;
+        x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+        x = (x | x << 2) & 0x1249249249249249ULL;
+        return x;
+    }
+
+    // Size of one body and its cost in a message
+    const size_t BODY_BYTES = sizeof(uint64_t) + 12 * sizeof(double);
+
+    // A body and its cost, in the order the arrays are declared
+    void putBody(Transport::Message& message, const BodyStore& bodies, const std::vector<double>& costs, size_t i) {
+        put(message, bodies.id[i]);
+        for (const std::vector<double>* array : {&bodies.x, &bodies.y, &bodies.z, &bodies.vx, &bodies.vy,
+                                                 &bodies.vz, &bodies.ax, &bodies.ay, &bodies.az, &bodies.mass,
+                                                 &bodies.radius, &costs}) {
+            put(message, (*array)[i]);
+        }
+    }
+
+    void getBody(Reader& reader, BodyStore& bodies, std::vector<double>& costs) {
+        bodies.id.push_back(reader.get<uint64_t>());
+        for (std::vector<double>* array : {&bodies.x, &bodies.y, &bodies.z, &bodies.vx, &bodies.vy, &bodies.vz,
+                                           &bodies.ax, &bodies.ay, &bodies.az, &bodies.mass, &bodies.radius,
+                                           &costs}) {
+            array->push_back(reader.get<double>());
+        }
+        bodies.trajectory.addEmpty(1);
+        bodies.level.push_back(0);
+    }
+
+    // Copies body i of source to the end of target, keeping its id
+    void copyBody(const BodyStore& source, size_t i, BodyStore& target) {
+        target.x.push_back(source.x[i]);
+        target.y.push_back(source.y[i]);
+        target.z.push_back(source.z[i]);
+        target.vx.push_back(source.vx[i]);
+        target.vy.push_back(source.vy[i]);
+        target.vz.push_back(source.vz[i]);
+        target.ax.push_back(source.ax[i]);
+        target.ay.push_back(source.ay[i]);
+        target.az.push_back(source.az[i]);
+        target.mass.push_back(source.mass[i]);
+        target.radius.push_back(source.radius[i]);
+        target.id.push_back(source.id[i]);
+        target.trajectory.addEmpty(1);
+        target.level.push_back(0);
+    }
+
+    void bounds(const BodyStore& bodies, glm::dvec3& lo, glm::dvec3& hi) {
+        lo = glm::dvec3(std::numeric_limits<double>::infinity());
+        hi = -lo;
+        for (size_t i = 0; i < bodies.size(); ++i) {
+            lo = glm::min(lo, bodies.getPosition(i));
+            hi = glm::max(hi, bodies.getPosition(i));
+        }
+    }
+}
+
+uint64_t mortonKey(uint32_t x, uint32_t y, uint32_t z) {
+    return spread(x) << 2 | spread(y) << 1 | spread(z);
+}
+
+// Skilling's transform ("Programming the Hilbert curve", 2004): turns the
+// coordinates into the transposed Hilbert index in place, whose bits
+// interleave like a Morton key
+uint64_t hilbertKey(uint32_t x, uint32_t y, uint32_t z) {
+    uint32_t axes[3] = {x & 0x1fffff, y & 0x1fffff, z & 0x1fffff};
+    const uint32_t top = 1u << (KEY_BITS - 1);
+    for (uint32_t q = top; q > 1; q >>= 1) {
+        const uint32_t p = q - 1;
+        for (uint32_t& axis : axes) {
+            if (axis & q) {
+                axes[0] ^= p;
+            } else {
+                const uint32_t t = (axes[0] ^ axis) & p;
+                axes[0] ^= t;
+                axis ^= t;
+            }
+        }
+    }
+    axes[1] ^= axes[0];
+    axes[2] ^= axes[1];
+    uint32_t t = 0;
+    for (uint32_t q = top; q > 1; q >>= 1) {
+        if (axes[2] & q) t ^= q - 1;
+    }
+    for (uint32_t& axis : axes) {
+        axis ^= t;
+    }
+    return mortonKey(axes[0], axes[1], axes[2]);
+}
+
+DistributedSimulator::DistributedSimulator(Transport& transport, const Simulator& base)
+        : transport(transport),
+          localTree(base.getOpeningAngle()),
+          tree(base.getOpeningAngle()),
+          pinHeaviestBody(base.getPinHeaviestBody()),
+          time(base.getTime()),
+          globalBodyCount(base.getBodies().size()) {
+    const BodyStore& all = base.getBodies();
+    const size_t n = all.size();
+    if (pinHeaviestBody && n > 0) {
+        size_t heaviest = 0;
+        for (size_t i = 1; i < n; ++i) {
+            if (all.mass[i] > all.mass[heaviest]) heaviest = i;
+        }
+        pinnedId = all.id[heaviest];
+    }
+
+    // Every rank sees the same bodies, so they all cut the curve the same
+    // way without talking to each other
+    glm::dvec3 lo, hi;
+    bounds(all, lo, hi);
+    const std::vector<uint64_t> keys = computeKeys(all, lo, hi);
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+    const size_t ranks = transport.getProcessCount();
+    const size_t rank = transport.getRank();
+    const size_t first = n * rank / ranks;
+    const size_t last = n * (rank + 1) / ranks;
+    // Trajectories are never recorded here, so the bodies need no ring pool
+    bodies.trajectory.disable();
+    bodies.reserve(last - first);
+    for (size_t k = first; k < last; ++k) {
+        copyBody(all, order[k], bodies);
+    }
+    costs.assign(bodies.size(), 1.0);
+    findPinned();
+}
+
+DistributedSimulator::~DistributedSimulator() = default;
+
+void DistributedSimulator::setOpeningAngle(double theta) {
+    localTree.setOpeningAngle(theta);
+    tree.setOpeningAngle(theta);
+    accelerationsValid = false;
+}
+
+void DistributedSimulator::setThreadCount(size_t threads) {
+    if (threads == getThreadCount()) return;
+    pool = threads > 1 ? std::make_unique<ThreadPool>(threads) : nullptr;
+}
+
+std::vector<uint64_t> DistributedSimulator::computeKeys(const BodyStore& store, const glm::dvec3& lo,
+                                                        const glm::dvec3& hi) const {
+    // Cells of the cube enclosing the box, so the curve is not stretched
+    const glm::dvec3 extent = hi - lo;
+    const double size = std::max(extent.x, std::max(extent.y, extent.z));
+    const double cells = static_cast<double>((1u << KEY_BITS) - 1);
+    const double scale = size > 0.0 ? cells / size : 0.0;
+    std::vector<uint64_t> keys(store.size());
+    run(pool.get(), store.size(), 4096, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const glm::dvec3 cell = glm::clamp((store.getPosition(i) - lo) * scale, 0.0, cells);
+            const auto cx = static_cast<uint32_t>(cell.x);
+            const auto cy = static_cast<uint32_t>(cell.y);
+            const auto cz = static_cast<uint32_t>(cell.z);
+            keys[i] = curve == CurveOrder::Hilbert ? hilbertKey(cx, cy, cz) : mortonKey(cx, cy, cz);
+        }
+    });
+    return keys;
+}
+
+std::vector<uint64_t> DistributedSimulator::sortByKey(const glm::dvec3& lo, const glm::dvec3& hi) {
+    std::vector<uint64_t> keys = computeKeys(bodies, lo, hi);
+    std::vector<size_t> order(bodies.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+    bodies.permute(order);
+    std::vector<double> sortedCosts(order.size());
+    std::vector<uint64_t> sortedKeys(order.size());
+    for (size_t k = 0; k < order.size(); ++k) {
+        sortedCosts[k] = costs[order[k]];
+        sortedKeys[k] = keys[order[k]];
+    }
+    costs.swap(sortedCosts);
+    return sortedKeys;
+}
+
+void DistributedSimulator::findPinned() {
+    pinnedIndex = bodies.size();
+    if (!pinHeaviestBody) return;
+    auto found = std::find(bodies.id.begin(), bodies.id.end(), pinnedId);
+    pinnedIndex = static_cast<size_t>(found - bodies.id.begin());
+}
+
+std::vector<DistributedSimulator::Domain> DistributedSimulator::gatherDomains(bool withCover) {
+    glm::dvec3 lo, hi;
+    bounds(bodies, lo, hi);
+    const std::vector<Octree::Bounds> cover = withCover ? localTree.getCover(COVER_CELLS) : std::vector<Octree::Bounds>();
+    Transport::Message message;
+    put(message, static_cast<uint64_t>(bodies.size()));
+    put(message, std::accumulate(costs.begin(), costs.end(), 0.0));
+    put(message, lo);
+    put(message, hi);
+    put(message, static_cast<uint64_t>(cover.size()));
+    for (const Octree::Bounds& cell : cover) {
+        put(message, cell);
+    }
+
+    std::vector<Domain> domains;
+    for (const Transport::Message& reply : transport.allGather(message)) {
+        Reader reader(reply);
+        Domain domain;
+        domain.count = reader.get<uint64_t>();
+        domain.work = reader.get<double>();
+        domain.lo = reader.get<glm::dvec3>();
+        domain.hi = reader.get<glm::dvec3>();
+        domain.cover.resize(reader.get<uint64_t>());
+        for (Octree::Bounds& cell : domain.cover) {
+            cell = reader.get<Octree::Bounds>();
+        }
+        domains.push_back(std::move(domain));
+    }
+    return domains;
+}
+
+void DistributedSimulator::update(double dt) {
+    PROFILE_SCOPE("DistributedSimulator::update");
+    if (!accelerationsValid) {
+        computeAccelerations();
+    }
+    kick(0.5 * dt);
+    drift(dt);
+    if (rebalanceInterval > 0 && ++stepsSinceRebalance >= rebalanceInterval) {
+        stepsSinceRebalance = 0;
+        rebalance();
+    }
+    computeAccelerations();
+    kick(0.5 * dt);
+    time += dt;
+}
+
+void DistributedSimulator::kick(double dt) {
+    run(pool.get(), bodies.size(), 4096, [this, dt](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (i == pinnedIndex) continue;
+            bodies.vx[i] += bodies.ax[i] * dt;
+            bodies.vy[i] += bodies.ay[i] * dt;
+            bodies.vz[i] += bodies.az[i] * dt;
+        }
+    });
+}
+
+void DistributedSimulator::drift(double dt) {
+    run(pool.get(), bodies.size(), 4096, [this, dt](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (i == pinnedIndex) continue;
+            bodies.x[i] += bodies.vx[i] * dt;
+            bodies.y[i] += bodies.vy[i] * dt;
+            bodies.z[i] += bodies.vz[i] * dt;
+        }
+    });
+}
+
+void DistributedSimulator::computeAccelerations() {
+    PROFILE_SCOPE("forces");
+    const size_t ranks = transport.getProcessCount();
+    const size_t rank = transport.getRank();
+    const size_t n = bodies.size();
+
+    // Send every rank the part of this rank's tree it cannot do without
+    std::vector<Transport::Message> incoming;
+    {
+        PROFILE_SCOPE("essential tree exchange");
+        if (ranks > 1) {
+            localTree.build(bodies);
+        }
+        const std::vector<Domain> domains = gatherDomains(ranks > 1);
+        std::vector<Transport::Message> outgoing(ranks);
+        if (ranks > 1 && n > 0) {
+            std::vector<glm::dvec3> points;
+            std::vector<double> pointMasses;
+            for (size_t q = 0; q < ranks; ++q) {
+                if (q == rank || domains[q].count == 0) continue;
+                localTree.exportEssential(domains[q].cover, points, pointMasses);
+                outgoing[q].reserve(points.size() * 4 * sizeof(double));
+                for (size_t k = 0; k < points.size(); ++k) {
+                    put(outgoing[q], points[k]);
+                    put(outgoing[q], pointMasses[k]);
+                }
+            }
+        }
+        incoming = transport.exchange(std::move(outgoing));
+    }
+
+    // The tree only reads positions and masses, so the imported points go in
+    // after the local bodies with nothing else
+    scratch.x.assign(bodies.x.begin(), bodies.x.end());
+    scratch.y.assign(bodies.y.begin(), bodies.y.end());
+    scratch.z.assign(bodies.z.begin(), bodies.z.end());
+    scratch.mass.assign(bodies.mass.begin(), bodies.mass.end());
+    for (size_t q = 0; q < ranks; ++q) {
+        if (q == rank) continue;
+        Reader reader(incoming[q]);
+        while (!reader.done()) {
+            const auto point = reader.get<glm::dvec3>();
+            scratch.x.push_back(point.x);
+            scratch.y.push_back(point.y);
+            scratch.z.push_back(point.z);
+            scratch.mass.push_back(reader.get<double>());
+        }
+    }
+    importedPoints = scratch.size() - n;
+
+    {
+        PROFILE_SCOPE("octree build");
+        tree.build(scratch);
+    }
+    // Local bodies come first in scratch, so they are the tree's first n
+    tree.computeAccelerations(bodies, n, pool.get(), nullptr, costs.data());
+    accelerationsValid = true;
+}
+
+// Cuts the curve of the global bounding box so that every rank gets the same
+// share of the last evaluation's interactions. Each rank sorts its bodies by
+// key and offers evenly spaced samples, each carrying the work of the bodies
+// since the previous one; every rank then finds the same splitters in the
+// merged samples and sends each body to the rank whose range holds its key.
+void DistributedSimulator::rebalance() {
+    PROFILE_SCOPE("rebalance");
+    const size_t ranks = transport.getProcessCount();
+    const size_t rank = transport.getRank();
+
+    glm::dvec3 lo(std::numeric_limits<double>::infinity());
+    glm::dvec3 hi = -lo;
+    for (const Domain& domain : gatherDomains(false)) {
+        if (domain.count == 0) continue;
+        lo = glm::min(lo, domain.lo);
+        hi = glm::max(hi, domain.hi);
+    }
+    if (globalBodyCount == 0) return;
+    const std::vector<uint64_t> keys = sortByKey(lo, hi);
+
+    const size_t n = bodies.size();
+    const size_t sampleCount = std::min(n, SAMPLES_PER_RANK);
+    Transport::Message samples;
+    for (size_t s = 0; s < sampleCount; ++s) {
+        const size_t begin = n * s / sampleCount;
+        const size_t end = n * (s + 1) / sampleCount;
+        put(samples, keys[end - 1]);
+        put(samples, std::accumulate(costs.begin() + begin, costs.begin() + end, 0.0));
+    }
+    std::vector<std::pair<uint64_t, double>> merged;
+    for (const Transport::Message& message : transport.allGather(samples)) {
+        Reader reader(message);
+        while (!reader.done()) {
+            const auto key = reader.get<uint64_t>();
+            merged.emplace_back(key, reader.get<double>());
+        }
+    }
+    std::sort(merged.begin(), merged.end());
+    double total = 0.0;
+    for (const auto& sample : merged) {
+        total += sample.second;
+    }
+
+    // Rank r takes the keys up to upper[r]
+    std::vector<uint64_t> upper(ranks, std::numeric_limits<uint64_t>::max());
+    double cumulative = 0.0;
+    size_t r = 0;
+    for (const auto& sample : merged) {
+        cumulative += sample.second;
+        while (r + 1 < ranks && cumulative >= total * static_cast<double>(r + 1) / static_cast<double>(ranks)) {
+            upper[r++] = sample.first;
+        }
+    }
+
+    std::vector<Transport::Message> outgoing(ranks);
+    std::vector<size_t> kept;
+    for (size_t i = 0; i < n; ++i) {
+        const auto owner = static_cast<size_t>(std::lower_bound(upper.begin(), upper.end(), keys[i]) - upper.begin());
+        if (owner == rank) {
+            kept.push_back(i);
+        } else {
+            putBody(outgoing[owner], bodies, costs, i);
+            ++migratedBodies;
+        }
+    }
+    std::vector<Transport::Message> incoming = transport.exchange(std::move(outgoing));
+
+    bodies.permute(kept);
+    std::vector<double> keptCosts(kept.size());
+    for (size_t k = 0; k < kept.size(); ++k) {
+        keptCosts[k] = costs[kept[k]];
+    }
+    costs.swap(keptCosts);
+    size_t arriving = 0;
+    for (size_t q = 0; q < ranks; ++q) {
+        if (q != rank) arriving += incoming[q].size() / BODY_BYTES;
+    }
+    bodies.reserve(bodies.size() + arriving);
+    costs.reserve(costs.size() + arriving);
+    for (size_t q = 0; q < ranks; ++q) {
+        if (q == rank) continue;
+        Reader reader(incoming[q]);
+        while (!reader.done()) {
+            getBody(reader, bodies, costs);
+        }
+    }
+    sortByKey(lo, hi);
+    findPinned();
+    ++rebalances;
+}
+
+BodyStore DistributedSimulator::gather() {
+    const size_t ranks = transport.getProcessCount();
+    std::vector<Transport::Message> outgoing(ranks);
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        putBody(outgoing[0], bodies, costs, i);
+    }
+    std::vector<Transport::Message> incoming = transport.exchange(std::move(outgoing));
+
+    BodyStore all;
+    all.trajectory.disable();
+    if (transport.getRank() != 0) return all;
+    size_t total = 0;
+    for (const Transport::Message& message : incoming) {
+        total += message.size() / BODY_BYTES;
+    }
+    all.reserve(total);
+    std::vector<double> allCosts;
+    allCosts.reserve(total);
+    for (const Transport::Message& message : incoming) {
+        Reader reader(message);
+        while (!reader.done()) {
+            getBody(reader, all, allCosts);
+        }
+    }
+    std::vector<size_t> order(all.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&all](size_t a, size_t b) { return all.id[a] < all.id[b]; });
+    all.permute(order);
+    return all;
+}
+
+std::vector<DistributedStatistics> DistributedSimulator::gatherStatistics() {
+    DistributedStatistics own{bodies.size(), importedPoints, migratedBodies, rebalances, transport.getBytesSent(),
+                              std::accumulate(costs.begin(), costs.end(), 0.0)};
+    Transport::Message message;
+    put(message, own);
+    std::vector<DistributedStatistics> all;
+    for (const Transport::Message& reply : transport.allGather(message)) {
+        Reader reader(reply);
+        all.push_back(reader.get<DistributedStatistics>());
+    }
+    return all;
+}
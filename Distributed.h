@@ -0,0 +1,133 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+
+#ifndef GRAVITY_DISTRIBUTED_H
+#define GRAVITY_DISTRIBUTED_H
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "BodyStore.h"
+#include "Octree.h"
+#include "ThreadPool.h"
+#include "Transport.h"
+
+class Simulator;
+
+// Space-filling curves for ordering bodies. Both take cell coordinates of
+// up to KEY_BITS bits per axis and return a key of 3 * KEY_BITS bits; cells
+// with nearby keys are nearby in space. Hilbert keys never jump between
+// distant cells, so a range of them makes a more compact domain than the
+// same range of Morton keys, at a few more operations per key.
+enum class CurveOrder {
+    Morton,
+    Hilbert
+};
+
+const int KEY_BITS = 21;
+
+uint64_t mortonKey(uint32_t x, uint32_t y, uint32_t z);
+uint64_t hilbertKey(uint32_t x, uint32_t y, uint32_t z);
+
+// One rank's share of a distributed run
+struct DistributedStatistics {
+    uint64_t bodies;          // Owned now
+    uint64_t importedPoints;  // Remote cells and bodies in the last force evaluation
+    uint64_t migratedBodies;  // Sent to other ranks by rebalancing, in total
+    uint64_t rebalances;
+    uint64_t bytesSent;       // By the transport, in total
+    double work;              // Tree interactions of the last force evaluation
+};
+
+// Barnes-Hut over several processes, each owning the bodies of one range of
+// a space-filling curve. Every force evaluation, the ranks swap outlines of
+// their domains, a few dozen top cells of their trees, and each sends every
+// other rank the locally essential part of its tree for that outline: the
+// cells far enough away to count as one point mass, and the bodies of those
+// that are not. A rank then walks a tree of
+// its own bodies and everything it imported, so it needs nothing else from
+// the others. The domains are cut again every few steps so that each rank
+// has the same share of the tree interactions of the last evaluation.
+//
+// Bodies move with kick-drift-kick leapfrog at a fixed dt. Collisions are
+// not checked, trajectories are not recorded, and the other solvers and
+// integrators of Simulator are not available. Results depend on the number
+// of processes, since the imported points differ from the cells of a single
+// tree, but not on the number of threads per process.
+//
+// Every member but the accessors is collective: all ranks must call it in
+// the same order.
+class DistributedSimulator {
+public:
+    // Every rank must pass the same base, e.g. a scenario loaded before
+    // SocketTransport::fork; each keeps its range of an equal-count split of
+    // the curve. Takes base's opening angle and pinHeaviestBody setting.
+    DistributedSimulator(Transport& transport, const Simulator& base);
+    ~DistributedSimulator();
+
+    void setOpeningAngle(double theta);
+    double getOpeningAngle() const { return tree.getOpeningAngle(); }
+    void setCurve(CurveOrder order) { curve = order; }
+    CurveOrder getCurve() const { return curve; }
+    // Cut the domains again every interval updates (default 10, 0 never)
+    void setRebalanceInterval(size_t interval) { rebalanceInterval = interval; }
+    size_t getRebalanceInterval() const { return rebalanceInterval; }
+    // Threads of this process. Create them after forking: a forked process
+    // has none of its parent's.
+    void setThreadCount(size_t threads);
+    size_t getThreadCount() const { return pool ? pool->getThreadCount() : 1; }
+
+    void update(double dt);
+    void rebalance();
+    double getTime() const { return time; }
+
+    // This rank's bodies, in curve order
+    const BodyStore& getBodies() const { return bodies; }
+    size_t getGlobalBodyCount() const { return globalBodyCount; }
+    // Every body on rank 0, in id order; an empty store on the other ranks
+    BodyStore gather();
+    // Every rank's statistics, in rank order, on every rank
+    std::vector<DistributedStatistics> gatherStatistics();
+
+private:
+    // What the other ranks need to know about one rank's bodies
+    struct Domain {
+        uint64_t count;
+        double work;
+        glm::dvec3 lo;                     // Bounding box
+        glm::dvec3 hi;
+        std::vector<Octree::Bounds> cover; // Cells of localTree holding them, when it is current
+    };
+
+    std::vector<Domain> gatherDomains(bool withCover);
+    std::vector<uint64_t> computeKeys(const BodyStore& store, const glm::dvec3& lo, const glm::dvec3& hi) const;
+    // Returns the sorted keys
+    std::vector<uint64_t> sortByKey(const glm::dvec3& lo, const glm::dvec3& hi);
+    void findPinned();
+    void computeAccelerations();
+    void kick(double dt);
+    void drift(double dt);
+
+    Transport& transport;
+    BodyStore bodies;
+    std::vector<double> costs;  // Per body, the interactions of its last walk
+    Octree localTree;           // This rank's bodies, for exporting
+    Octree tree;                // Local bodies and imported points, for the forces
+    BodyStore scratch;          // Positions and masses of what tree is built from
+    CurveOrder curve = CurveOrder::Hilbert;
+    size_t rebalanceInterval = 10;
+    size_t stepsSinceRebalance = 0;
+    bool pinHeaviestBody;
+    uint64_t pinnedId = 0;
+    size_t pinnedIndex;         // Local slot of the pinned body, or bodies.size() if another rank has it
+    bool accelerationsValid = false;
+    double time = 0.0;
+    size_t globalBodyCount;
+    uint64_t importedPoints = 0;
+    uint64_t migratedBodies = 0;
+    uint64_t rebalances = 0;
+    std::unique_ptr<ThreadPool> pool;
+};
+#endif //GRAVITY_DISTRIBUTED_H
@@ -0,0 +1,281 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+#include "Ensemble.h"
+#include "Physics.h"
+#include "Profiler.h"
+#include "SimdLanes.h"
+#include "Simulator.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    // Positions are kept in softening lengths, as in the force kernels, so the
+    // pair loop needs no unit conversions
+    const double UNIT = 1.0 / SOFTENING_LENGTH;
+    const double MASS_SCALE = G * UNIT * UNIT;
+
+    using Lanes = SimdLanes<double>;
+
+    void run(ThreadPool* pool, size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+        if (pool) {
+            pool->parallelFor(count, grain, body);
+        } else {
+            body(0, count);
+        }
+    }
+}
+
+Ensemble::Ensemble(const Simulator& base, size_t memberCount)
+    : members(memberCount),
+      width(Lanes::WIDTH),
+      padded((memberCount + Lanes::WIDTH - 1) / Lanes::WIDTH * Lanes::WIDTH),
+      bodyCount(base.getBodies().size()),
+      pinHeaviestBody(base.getPinHeaviestBody()) {
+    if (members == 0) {
+        throw std::runtime_error("An ensemble needs at least one member");
+    }
+    const BodyStore& bodies = base.getBodies();
+    const size_t total = bodyCount * padded;
+    for (auto* array : {&x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &mass, &gm}) {
+        array->resize(total);
+    }
+    for (size_t m = 0; m < padded; ++m) {
+        for (size_t i = 0; i < bodyCount; ++i) {
+            const size_t k = slot(m, i);
+            x[k] = bodies.x[i] * UNIT;
+            y[k] = bodies.y[i] * UNIT;
+            z[k] = bodies.z[i] * UNIT;
+            vx[k] = bodies.vx[i];
+            vy[k] = bodies.vy[i];
+            vz[k] = bodies.vz[i];
+            mass[k] = bodies.mass[i];
+            gm[k] = bodies.mass[i] * MASS_SCALE;
+        }
+    }
+    pinned.assign(padded, bodyCount);
+    initialEnergy.assign(padded, 0.0);
+    minSeparation2.assign(padded, std::numeric_limits<double>::infinity());
+}
+
+Ensemble::~Ensemble() = default;
+
+void Ensemble::setMass(size_t member, size_t body, double value) {
+    mass[slot(member, body)] = value;
+    gm[slot(member, body)] = value * MASS_SCALE;
+    started = false;
+}
+
+void Ensemble::setPosition(size_t member, size_t body, const glm::dvec3& position) {
+    const size_t k = slot(member, body);
+    x[k] = position.x * UNIT;
+    y[k] = position.y * UNIT;
+    z[k] = position.z * UNIT;
+    started = false;
+}
+
+void Ensemble::setVelocity(size_t member, size_t body, const glm::dvec3& velocity) {
+    const size_t k = slot(member, body);
+    vx[k] = velocity.x;
+    vy[k] = velocity.y;
+    vz[k] = velocity.z;
+    started = false;
+}
+
+glm::dvec3 Ensemble::getPosition(size_t member, size_t body) const {
+    const size_t k = slot(member, body);
+    return glm::dvec3(x[k], y[k], z[k]) * SOFTENING_LENGTH;
+}
+
+glm::dvec3 Ensemble::getVelocity(size_t member, size_t body) const {
+    const size_t k = slot(member, body);
+    return glm::dvec3(vx[k], vy[k], vz[k]);
+}
+
+void Ensemble::perturb(double scale, unsigned seed) {
+    for (size_t m = 1; m < members; ++m) {
+        std::seed_seq sequence{seed, static_cast<unsigned>(m)};
+        std::mt19937_64 rng(sequence);
+        std::normal_distribution<double> normal(0.0, scale);
+        for (size_t i = 0; i < bodyCount; ++i) {
+            const size_t k = slot(m, i);
+            const double r = std::sqrt(x[k] * x[k] + y[k] * y[k] + z[k] * z[k]);
+            const double v = std::sqrt(vx[k] * vx[k] + vy[k] * vy[k] + vz[k] * vz[k]);
+            x[k] += r * normal(rng);
+            y[k] += r * normal(rng);
+            z[k] += r * normal(rng);
+            vx[k] += v * normal(rng);
+            vy[k] += v * normal(rng);
+            vz[k] += v * normal(rng);
+        }
+    }
+    started = false;
+}
+
+void Ensemble::sweepMass(size_t body, double low, double high) {
+    if (body >= bodyCount) {
+        throw std::runtime_error("Mass sweep body " + std::to_string(body) + " out of range");
+    }
+    for (size_t m = 0; m < members; ++m) {
+        const double t = members > 1 ? static_cast<double>(m) / static_cast<double>(members - 1) : 0.0;
+        setMass(m, body, low + (high - low) * t);
+    }
+}
+
+void Ensemble::setThreadCount(size_t threads) {
+    if (threads == getThreadCount()) return;
+    pool = threads > 1 ? std::make_unique<ThreadPool>(threads) : nullptr;
+}
+
+// Pins the heaviest body of each member, resets the closest approaches and
+// takes the reference energies
+void Ensemble::start() {
+    for (size_t m = 0; m < padded; ++m) {
+        pinned[m] = bodyCount;
+        if (pinHeaviestBody && bodyCount > 0) {
+            size_t heaviest = 0;
+            for (size_t i = 1; i < bodyCount; ++i) {
+                if (mass[slot(m, i)] > mass[slot(m, heaviest)]) heaviest = i;
+            }
+            pinned[m] = heaviest;
+            vx[slot(m, heaviest)] = vy[slot(m, heaviest)] = vz[slot(m, heaviest)] = 0.0;
+        }
+        minSeparation2[m] = std::numeric_limits<double>::infinity();
+    }
+    run(pool.get(), padded / Lanes::WIDTH, 1, [this](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block) {
+            accelerate(block * Lanes::WIDTH);
+        }
+    });
+    for (size_t m = 0; m < members; ++m) {
+        double kinetic, potential;
+        initialEnergy[m] = energy(m, kinetic, potential);
+    }
+    started = true;
+}
+
+void Ensemble::update(double dt, size_t steps) {
+    PROFILE_SCOPE("ensemble");
+    if (!started) {
+        start();
+    }
+    run(pool.get(), padded / Lanes::WIDTH, 1, [this, dt, steps](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block) {
+            stepBlock(block * Lanes::WIDTH, dt, steps);
+        }
+    });
+    time += dt * static_cast<double>(steps);
+    memberSteps += static_cast<uint64_t>(members) * steps;
+}
+
+// Kick-drift-kick for the members [first, first + Lanes::WIDTH). The closing
+// kick's accelerations open the next step.
+void Ensemble::stepBlock(size_t first, double dt, size_t steps) {
+    using V = Lanes::V;
+    const V half = Lanes::set(0.5 * dt);
+    const V drift = Lanes::set(dt * UNIT);
+    auto kick = [&]() {
+        for (size_t i = 0; i < bodyCount; ++i) {
+            const size_t k = slot(first, i);
+            Lanes::store(&vx[k], Lanes::fmadd(Lanes::load(&ax[k]), half, Lanes::load(&vx[k])));
+            Lanes::store(&vy[k], Lanes::fmadd(Lanes::load(&ay[k]), half, Lanes::load(&vy[k])));
+            Lanes::store(&vz[k], Lanes::fmadd(Lanes::load(&az[k]), half, Lanes::load(&vz[k])));
+        }
+        if (pinHeaviestBody) {
+            for (size_t m = first; m < first + Lanes::WIDTH; ++m) {
+                if (pinned[m] == bodyCount) continue;
+                const size_t k = slot(m, pinned[m]);
+                vx[k] = vy[k] = vz[k] = 0.0;
+            }
+        }
+    };
+    for (size_t step = 0; step < steps; ++step) {
+        kick();
+        for (size_t i = 0; i < bodyCount; ++i) {
+            const size_t k = slot(first, i);
+            Lanes::store(&x[k], Lanes::fmadd(Lanes::load(&vx[k]), drift, Lanes::load(&x[k])));
+            Lanes::store(&y[k], Lanes::fmadd(Lanes::load(&vy[k]), drift, Lanes::load(&y[k])));
+            Lanes::store(&z[k], Lanes::fmadd(Lanes::load(&vz[k]), drift, Lanes::load(&z[k])));
+        }
+        accelerate(first);
+        kick();
+    }
+}
+
+// Direct summation over the pairs i < j of Lanes::WIDTH members at once, the
+// same pair in every lane. Also lowers the members' closest approaches.
+void Ensemble::accelerate(size_t first) {
+    using V = Lanes::V;
+    const V zero = Lanes::set(0.0);
+    for (size_t i = 0; i < bodyCount; ++i) {
+        const size_t k = slot(first, i);
+        Lanes::store(&ax[k], zero);
+        Lanes::store(&ay[k], zero);
+        Lanes::store(&az[k], zero);
+    }
+    V closest = Lanes::load(&minSeparation2[first]);
+    for (size_t i = 0; i < bodyCount; ++i) {
+        const size_t ki = slot(first, i);
+        const V xi = Lanes::load(&x[ki]), yi = Lanes::load(&y[ki]), zi = Lanes::load(&z[ki]);
+        const V gmi = Lanes::load(&gm[ki]);
+        V sx = Lanes::load(&ax[ki]), sy = Lanes::load(&ay[ki]), sz = Lanes::load(&az[ki]);
+        for (size_t j = i + 1; j < bodyCount; ++j) {
+            const size_t kj = slot(first, j);
+            const V dx = Lanes::sub(Lanes::load(&x[kj]), xi);
+            const V dy = Lanes::sub(Lanes::load(&y[kj]), yi);
+            const V dz = Lanes::sub(Lanes::load(&z[kj]), zi);
+            const V r2 = Lanes::fmadd(dx, dx, Lanes::fmadd(dy, dy, Lanes::mul(dz, dz)));
+            closest = Lanes::min(closest, r2);
+            const V s = ForceSoftening::scale<Lanes>(r2);
+            const V sj = Lanes::mul(Lanes::load(&gm[kj]), s);
+            sx = Lanes::fmadd(dx, sj, sx);
+            sy = Lanes::fmadd(dy, sj, sy);
+            sz = Lanes::fmadd(dz, sj, sz);
+            const V si = Lanes::mul(gmi, s);
+            Lanes::subtract(&ax[kj], dx, si);
+            Lanes::subtract(&ay[kj], dy, si);
+            Lanes::subtract(&az[kj], dz, si);
+        }
+        Lanes::store(&ax[ki], sx);
+        Lanes::store(&ay[ki], sy);
+        Lanes::store(&az[ki], sz);
+    }
+    Lanes::store(&minSeparation2[first], closest);
+}
+
+double Ensemble::energy(size_t member, double& kinetic, double& potential) const {
+    using M = ScalarMath<double>;
+    kinetic = 0.0;
+    potential = 0.0;
+    for (size_t i = 0; i < bodyCount; ++i) {
+        const size_t ki = slot(member, i);
+        kinetic += 0.5 * mass[ki] * (vx[ki] * vx[ki] + vy[ki] * vy[ki] + vz[ki] * vz[ki]);
+        for (size_t j = i + 1; j < bodyCount; ++j) {
+            const size_t kj = slot(member, j);
+            const double dx = x[kj] - x[ki], dy = y[kj] - y[ki], dz = z[kj] - z[ki];
+            const double r2 = dx * dx + dy * dy + dz * dz;
+            potential += G * mass[ki] * mass[kj] * ForceSoftening::potential<M>(r2) * UNIT;
+        }
+    }
+    return kinetic + potential;
+}
+
+std::vector<EnsembleSummary> Ensemble::summarize() const {
+    std::vector<EnsembleSummary> summaries(members);
+    for (size_t m = 0; m < members; ++m) {
+        EnsembleSummary& summary = summaries[m];
+        summary.member = m;
+        summary.time = time;
+        const double total = energy(m, summary.kineticEnergy, summary.potentialEnergy);
+        summary.energyError = started && initialEnergy[m] != 0.0
+                                  ? (total - initialEnergy[m]) / std::abs(initialEnergy[m]) : 0.0;
+        summary.minSeparation = started ? std::sqrt(minSeparation2[m]) * SOFTENING_LENGTH
+                                        : std::numeric_limits<double>::infinity();
+    }
+    return summaries;
+}
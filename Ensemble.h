@@ -0,0 +1,110 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+
+#ifndef GRAVITY_ENSEMBLE_H
+#define GRAVITY_ENSEMBLE_H
+#pragma once
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include "ThreadPool.h"
+
+class Simulator;
+
+// State of one member at the end of an update
+struct EnsembleSummary {
+    size_t member;
+    double time;
+    double kineticEnergy;    // J
+    double potentialEnergy;  // J, with the build's softening
+    double energyError;      // (E - E0) / |E0|, E0 taken when the member started stepping
+    double minSeparation;    // Closest approach of any two bodies since then (m)
+};
+
+// Many independent copies of a small system stepped together, for parameter
+// sweeps and perturbed initial conditions. Every member has the same bodies;
+// positions, velocities and masses may differ.
+//
+// All members live in one batched store with the members of a body next to
+// each other, so the direct-summation kernel runs the same pair in every SIMD
+// lane, each lane a different member. That keeps the vector units full for
+// the few-body systems that waste them in Simulator. Blocks of members are
+// spread over the threads and each runs all the steps of an update on its
+// own, so an update costs one fork and join however many steps it has.
+//
+// Members are integrated with kick-drift-kick leapfrog, direct summation in
+// double and the build's softening. There are no collisions, and the other
+// solvers and integrators of Simulator are not available. Results are
+// bit-identical for every thread count.
+class Ensemble {
+public:
+    // Every member starts as a copy of base's bodies and takes its
+    // pinHeaviestBody setting
+    Ensemble(const Simulator& base, size_t members);
+    ~Ensemble();
+
+    size_t size() const { return members; }
+    size_t getBodyCount() const { return bodyCount; }
+
+    void setMass(size_t member, size_t body, double mass);
+    void setPosition(size_t member, size_t body, const glm::dvec3& position);
+    void setVelocity(size_t member, size_t body, const glm::dvec3& velocity);
+    double getMass(size_t member, size_t body) const { return mass[slot(member, body)]; }
+    glm::dvec3 getPosition(size_t member, size_t body) const;
+    glm::dvec3 getVelocity(size_t member, size_t body) const;
+
+    // Moves every body of every member but the first by a Gaussian offset
+    // with a standard deviation of scale times its distance from the origin
+    // in each axis, and its velocity likewise. Each member draws from its
+    // own generator, so the result does not depend on the thread count.
+    void perturb(double scale, unsigned seed);
+    // Sets the mass of body linearly from low in the first member to high in the last
+    void sweepMass(size_t body, double low, double high);
+
+    void setThreadCount(size_t threads);
+    size_t getThreadCount() const { return pool ? pool->getThreadCount() : 1; }
+
+    // Advances every member by steps steps of dt
+    void update(double dt, size_t steps = 1);
+    double getTime() const { return time; }
+    // Member-steps run so far, the unit of ensemble throughput
+    uint64_t getMemberSteps() const { return memberSteps; }
+
+    // One summary per member, in member order. Costs a pass over the pairs
+    // of every member.
+    std::vector<EnsembleSummary> summarize() const;
+
+private:
+    size_t slot(size_t member, size_t body) const {
+        return (member / width) * bodyCount * width + body * width + member % width;
+    }
+    void start();
+    void stepBlock(size_t first, double dt, size_t steps);
+    void accelerate(size_t first);
+    double energy(size_t member, double& kinetic, double& potential) const;
+
+    size_t members;
+    size_t width;      // Members per block, the SIMD width
+    size_t padded;     // Members rounded up to whole blocks; the spare lanes run copies of base
+    size_t bodyCount;
+    bool pinHeaviestBody;
+
+    // Blocks of width members, one after the other; within a block, the
+    // members of body i are at i * width. A block's bodies are contiguous, so
+    // a thread stepping it stays in its own cache lines. Positions are in
+    // softening lengths, masses are also kept as G m / L^2 for the kernel.
+    std::vector<double> x, y, z;
+    std::vector<double> vx, vy, vz;
+    std::vector<double> ax, ay, az;
+    std::vector<double> mass, gm;
+
+    std::vector<size_t> pinned;         // Per member, the heaviest body or bodyCount for none
+    std::vector<double> initialEnergy;  // Per member, E0
+    std::vector<double> minSeparation2; // Per member, in softening lengths squared
+    bool started = false;               // Whether E0, the pins and the accelerations are current
+    double time = 0.0;
+    uint64_t memberSteps = 0;
+    std::unique_ptr<ThreadPool> pool;
+};
+#endif //GRAVITY_ENSEMBLE_H
@@ -0,0 +1,173 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+#include "EventChannel.h"
+#include <cmath>
+#include <cstddef>
+
+uint64_t EventCounts::total() const {
+    uint64_t sum = 0;
+    for (uint64_t c : count) sum += c;
+    return sum;
+}
+
+EventCounts EventCounts::operator-(const EventCounts& earlier) const {
+    EventCounts difference;
+    for (size_t t = 0; t < static_cast<size_t>(EventType::Count); ++t) {
+        difference.count[t] = count[t] - earlier.count[t];
+    }
+    difference.dropped = dropped - earlier.dropped;
+    return difference;
+}
+
+EventChannel::EventChannel(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    cells = std::make_unique<Cell[]>(size);
+    mask = size - 1;
+    // Slot k is free for the producer that claims position k
+    for (size_t k = 0; k < size; ++k) {
+        cells[k].sequence.store(k, std::memory_order_relaxed);
+    }
+}
+
+bool EventChannel::tryPush(const Event& event) {
+    uint64_t position = tail.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = cells[position & mask];
+        const uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+        const int64_t lag = static_cast<int64_t>(sequence - position);
+        if (lag == 0) {
+            if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                cell.event = event;
+                cell.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (lag < 0) {
+            return false;  // The slot still holds an event from one lap ago
+        } else {
+            position = tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+size_t EventChannel::drain(std::vector<Event>& out) {
+    size_t drainedCount = 0;
+    uint64_t position = head.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = cells[position & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != position + 1) break;
+        out.push_back(cell.event);
+        // Free the slot for the producer one lap ahead
+        cell.sequence.store(position + mask + 1, std::memory_order_release);
+        ++position;
+        ++drainedCount;
+    }
+    head.store(position, std::memory_order_relaxed);
+    return drainedCount;
+}
+
+EventCounts EventChannel::getCounts() const {
+    EventCounts result;
+    for (size_t t = 0; t < static_cast<size_t>(EventType::Count); ++t) {
+        result.count[t] = counts[t].load(std::memory_order_relaxed);
+    }
+    result.dropped = dropped.load(std::memory_order_relaxed);
+    return result;
+}
+
+namespace {
+    const char* const EVENT_NAMES[] = {"close encounters", "softened pair forces", "rejected non-finite forces",
+                                       "merges", "conservation drifts"};
+    const char* const QUANTITY_NAMES[] = {"energy", "momentum", "angular momentum", "centre of mass"};
+
+    void describe(std::ostream& out, const Event& event) {
+        switch (event.type) {
+            case EventType::CloseEncounter:
+                out << "bodies " << event.first << " and " << event.second << " at " << event.value << " m";
+                break;
+            case EventType::SoftenedForce:
+                out << "separation " << event.value << " m";
+                break;
+            case EventType::NonFiniteForce:
+                if (event.first == NO_BODY) {
+                    // The separation is NaN too when the positions are
+                    out << "pair";
+                    if (std::isfinite(event.value)) out << " at " << event.value << " m";
+                } else {
+                    out << "body " << event.first;
+                }
+                break;
+            case EventType::Merge:
+                out << "body " << event.first << " absorbed " << event.second << ", " << event.value << " kg";
+                break;
+            case EventType::ConservationDrift:
+                out << QUANTITY_NAMES[event.first] << " off by " << event.value;
+                break;
+            default:
+                break;
+        }
+        out << ", t = " << event.time << " s";
+    }
+}
+
+EventReporter::EventReporter(EventChannel& channel, std::ostream& out, double interval)
+    : channel(channel),
+      out(out),
+      interval(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              std::chrono::duration<double>(interval))),
+      lastReport(std::chrono::steady_clock::now()),
+      reported(channel.getCounts()) {}
+
+void EventReporter::poll() {
+    collect();
+    const auto now = std::chrono::steady_clock::now();
+    if (now - lastReport >= interval) {
+        report();
+        lastReport = now;
+    }
+}
+
+void EventReporter::flush() {
+    collect();
+    report();
+    lastReport = std::chrono::steady_clock::now();
+}
+
+// Keeps the first drained event of each type as the example for the next report
+void EventReporter::collect() {
+    drained.clear();
+    channel.drain(drained);
+    for (const Event& event : drained) {
+        const size_t t = static_cast<size_t>(event.type);
+        if (!hasExample[t]) {
+            example[t] = event;
+            hasExample[t] = true;
+        }
+    }
+}
+
+void EventReporter::report() {
+    const EventCounts current = channel.getCounts();
+    const EventCounts recent = current - reported;
+    if (recent.total() == 0) return;
+    out << "Events:";
+    const char* separator = " ";
+    for (size_t t = 0; t < static_cast<size_t>(EventType::Count); ++t) {
+        if (recent.count[t] == 0) continue;
+        out << separator << recent.count[t] << ' ' << EVENT_NAMES[t];
+        if (hasExample[t]) {
+            out << " (first: ";
+            describe(out, example[t]);
+            out << ')';
+        }
+        separator = "; ";
+        hasExample[t] = false;
+    }
+    if (recent.dropped > 0) {
+        out << "; " << recent.dropped << " not queued";
+    }
+    out << '\n';
+    out.flush();
+    reported = current;
+}
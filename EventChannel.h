@@ -0,0 +1,133 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+
+#ifndef GRAVITY_EVENTCHANNEL_H
+#define GRAVITY_EVENTCHANNEL_H
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+enum class EventType : uint8_t {
+    CloseEncounter,     // Two bodies passed within the encounter distance without touching
+    SoftenedForce,      // A single pair force was evaluated inside the softening range
+    NonFiniteForce,     // A body's acceleration came out NaN or infinite and was set to zero
+    Merge,              // A collision merged two bodies
+    ConservationDrift,  // A conservation check found a quantity off by more than the threshold
+    Count
+};
+
+// What a ConservationDrift event is about
+enum class ConservedQuantity : uint8_t {
+    Energy,
+    Momentum,
+    AngularMomentum,
+    CenterOfMass
+};
+
+// Event::first of a pair force from calculateGravitationalForce, which knows no body ids
+const uint64_t NO_BODY = UINT64_MAX;
+
+struct Event {
+    EventType type;
+    double time;      // Simulated time (s)
+    uint64_t first;   // Body ids where known: the survivor of a merge, the body of a rejected force,
+                      // NO_BODY for a rejected pair force. The ConservedQuantity of a drift.
+    uint64_t second;  // The absorbed body of a merge, the other body of an encounter
+    double value;     // Separation (m) for encounters and single pair forces, absorbed mass (kg) for merges,
+                      // the relative drift of a drift
+};
+
+// Events posted so far, by type
+struct EventCounts {
+    uint64_t count[static_cast<size_t>(EventType::Count)] = {};
+    uint64_t dropped = 0;  // Counted but not queued because the ring was full
+
+    uint64_t operator[](EventType type) const { return count[static_cast<size_t>(type)]; }
+    uint64_t total() const;
+    EventCounts operator-(const EventCounts& earlier) const;
+};
+
+// Diagnostics from the simulation threads, without ever blocking them. Events
+// go into a bounded ring that any number of threads post to and one thread
+// drains (Vyukov's bounded queue: a producer claims a slot with one
+// compare-and-swap and publishes it with a sequence number). When the ring is
+// full the event is counted and dropped, so the counts stay exact while a
+// flood of events costs a bounded amount of memory.
+//
+// post() is a relaxed load and a return when the channel is disabled, and the
+// hot paths only post for rare conditions, so an idle channel costs nothing
+// measurable.
+class EventChannel {
+public:
+    // capacity is rounded up to a power of two
+    explicit EventChannel(size_t capacity = 4096);
+    EventChannel(const EventChannel&) = delete;
+    EventChannel& operator=(const EventChannel&) = delete;
+
+    void setEnabled(bool enabled) { on.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return on.load(std::memory_order_relaxed); }
+
+    // Never blocks. Does nothing when disabled.
+    void post(const Event& event) {
+        if (!isEnabled()) return;
+        counts[static_cast<size_t>(event.type)].fetch_add(1, std::memory_order_relaxed);
+        if (!tryPush(event)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Appends the queued events to out, oldest first, and returns how many.
+    // Only one thread may drain at a time.
+    size_t drain(std::vector<Event>& out);
+    EventCounts getCounts() const;
+    size_t getCapacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<uint64_t> sequence;
+        Event event;
+    };
+
+    bool tryPush(const Event& event);
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    std::atomic<bool> on{true};
+    alignas(64) std::atomic<uint64_t> tail{0};  // Next slot to claim
+    alignas(64) std::atomic<uint64_t> head{0};  // Next slot to drain
+    alignas(64) std::atomic<uint64_t> counts[static_cast<size_t>(EventType::Count)] = {};
+    std::atomic<uint64_t> dropped{0};
+};
+
+// Human-readable reports of a channel, at most one per interval of wall time:
+// the number of events of each type since the previous report with the first
+// of them as an example. A flood costs a line per interval rather than a
+// line per event.
+class EventReporter {
+public:
+    EventReporter(EventChannel& channel, std::ostream& out, double interval = 1.0);
+
+    // Drains the channel, and reports if the interval has passed and anything happened
+    void poll();
+    // Drains and reports whatever is left, however recent the last report
+    void flush();
+
+private:
+    void collect();
+    void report();
+
+    EventChannel& channel;
+    std::ostream& out;
+    std::chrono::steady_clock::duration interval;
+    std::chrono::steady_clock::time_point lastReport;
+    std::vector<Event> drained;
+    EventCounts reported;  // Channel counts at the previous report
+    Event example[static_cast<size_t>(EventType::Count)];
+    bool hasExample[static_cast<size_t>(EventType::Count)] = {};
+};
+#endif //GRAVITY_EVENTCHANNEL_H
@@ -0,0 +1,514 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+#include "FastMultipole.h"
+#include "Physics.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+// Notation: for a multi-index k, |k| = kx + ky + kz, k! = kx! ky! kz! and
+// d^k = dx^kx dy^ky dz^kz. Every expansion is stored scaled so that all
+// translations are plain sums of products:
+//
+//   P2M  M_k = sum_b m_b (x_b - z)^k / k!
+//   M2M  M'_k = sum_{j <= k} M_j (z - z')^(k - j) / (k - j)!
+//   M2L  L_j = (-1)^|j| sum_k D_{k+j}(w - z) M_k,   |k| + |j| <= p
+//   L2L  L'_i = sum_{j >= i} L_j (w' - w)^(j - i) / (j - i)!
+//   L2P  phi(x) = -G sum_j L_j (x - w)^j / j!,  a_i = G sum_j L_j (x - w)^(j - e_i) / (j - e_i)!
+//
+// where D_k(r) = d^k/dy^k 1/|x - y| with r = x - y, which obeys (after
+// Duan and Krasny 2001)
+//   |k| r^2 D_k = (2|k| - 1) sum_i k_i r_i D_{k-e_i} - (|k| - 1) sum_i k_i (k_i - 1) D_{k-2e_i}
+
+namespace {
+    void run(ThreadPool* pool, size_t count, const std::function<void(size_t, size_t)>& body) {
+        if (pool) {
+            pool->parallelFor(count, 1, body);
+        } else {
+            body(0, count);
+        }
+    }
+}
+
+FastMultipole::FastMultipole(int order, double openingAngle, size_t leafCapacity)
+        : order(0), openingAngle(openingAngle), leafCapacity(std::max<size_t>(leafCapacity, 1)) {
+    setOrder(order);
+}
+
+void FastMultipole::setOrder(int p) {
+    p = std::clamp(p, 1, MAX_ORDER);
+    if (p == order) return;
+    order = p;
+    buildTables();
+}
+
+void FastMultipole::buildTables() {
+    const int side = order + 1;
+    std::vector<int> index(side * side * side, -1);
+    auto term = [&index, side](int x, int y, int z) { return index[(x * side + y) * side + z]; };
+
+    exponents.clear();
+    degree.clear();
+    for (int n = 0; n <= order; ++n) {
+        for (int x = n; x >= 0; --x) {
+            for (int y = n - x; y >= 0; --y) {
+                index[(x * side + y) * side + (n - x - y)] = static_cast<int>(exponents.size());
+                exponents.push_back({x, y, n - x - y});
+                degree.push_back(n);
+            }
+        }
+    }
+
+    const size_t terms = exponents.size();
+    powerSteps.assign(terms, PowerStep{0, 0, 0.0});
+    recurrence.assign(terms, Recurrence{});
+    gradientTerms.clear();
+    for (size_t t = 1; t < terms; ++t) {
+        const std::array<int, 3>& k = exponents[t];
+        const double n = degree[t];
+        for (int axis = 2; axis >= 0; --axis) {
+            if (k[axis] == 0) continue;
+            std::array<int, 3> lower = k;
+            --lower[axis];
+            const int below = term(lower[0], lower[1], lower[2]);
+            powerSteps[t] = PowerStep{below, axis, 1.0 / k[axis]};
+            gradientTerms.push_back(Term{axis, static_cast<int>(t), below});
+            recurrence[t].first[axis] = below;
+            recurrence[t].firstWeight[axis] = (2.0 * n - 1.0) * k[axis] / n;
+            if (k[axis] >= 2) {
+                --lower[axis];
+                recurrence[t].second[axis] = term(lower[0], lower[1], lower[2]);
+                recurrence[t].secondWeight[axis] = (n - 1.0) * k[axis] * (k[axis] - 1) / n;
+            }
+        }
+    }
+
+    translationTerms.clear();
+    for (size_t t = 0; t < terms; ++t) {
+        const std::array<int, 3>& k = exponents[t];
+        for (size_t s = 0; s < terms; ++s) {
+            const std::array<int, 3>& j = exponents[s];
+            if (j[0] <= k[0] && j[1] <= k[1] && j[2] <= k[2]) {
+                translationTerms.push_back(Term{static_cast<int>(t), static_cast<int>(s),
+                                                term(k[0] - j[0], k[1] - j[1], k[2] - j[2])});
+            }
+        }
+    }
+    // Row j runs over k = 0, 1, ... while |k| + |j| <= p
+    localStart.assign(1, 0);
+    localShift.clear();
+    for (size_t s = 0; s < terms; ++s) {
+        const std::array<int, 3>& j = exponents[s];
+        for (size_t t = 0; t < terms && degree[t] + degree[s] <= order; ++t) {
+            const std::array<int, 3>& k = exponents[t];
+            localShift.push_back(term(k[0] + j[0], k[1] + j[1], k[2] + j[2]));
+        }
+        localStart.push_back(static_cast<int>(localShift.size()));
+    }
+    // An M2L costs about as much as one pair per term of localShift
+    directLimit = localShift.size();
+}
+
+void FastMultipole::computeAccelerations(BodyStore& bodies, ThreadPool* pool, double* potentialEnergy) {
+    withPotential = potentialEnergy != nullptr;
+    evaluate(bodies, pool);
+    withPotential = false;
+    for (size_t k = 0; k < bodyOrder.size(); ++k) {
+        const size_t i = bodyOrder[k];
+        bodies.ax[i] = accelerations[k].x;
+        bodies.ay[i] = accelerations[k].y;
+        bodies.az[i] = accelerations[k].z;
+    }
+    if (potentialEnergy) {
+        // Every pair is in both bodies' potentials
+        double energy = 0.0;
+        for (size_t k = 0; k < bodyOrder.size(); ++k) {
+            energy += masses[k] * potentials[k];
+        }
+        *potentialEnergy = 0.5 * energy;
+    }
+}
+
+void FastMultipole::computeAccelerations(BodyStore& bodies, const std::vector<size_t>& targets, ThreadPool* pool) {
+    evaluate(bodies, pool);
+    std::vector<size_t> slot(bodyOrder.size());
+    for (size_t k = 0; k < bodyOrder.size(); ++k) {
+        slot[bodyOrder[k]] = k;
+    }
+    for (size_t i : targets) {
+        bodies.ax[i] = accelerations[slot[i]].x;
+        bodies.ay[i] = accelerations[slot[i]].y;
+        bodies.az[i] = accelerations[slot[i]].z;
+    }
+}
+
+void FastMultipole::evaluate(const BodyStore& bodies, ThreadPool* pool) {
+    {
+        PROFILE_SCOPE("multipole tree");
+        build(bodies);
+    }
+    const size_t n = bodies.size();
+    if (n == 0) return;
+    const size_t terms = exponents.size();
+    multipoles.assign(cells.size() * terms, 0.0);
+    locals.assign(cells.size() * terms, 0.0);
+    accelerations.assign(n, glm::dvec3(0.0));
+    potentials.assign(withPotential ? n : 0, 0.0);
+
+    // Subtrees of at most n / 1024 bodies (or single leaves) are the unit of
+    // parallel work. The cut depends only on the tree, never on the pool.
+    frontier.clear();
+    frontierOf.assign(cells.size(), -1);
+    findFrontier(0, std::max(leafCapacity, n / 1024));
+
+    {
+        PROFILE_SCOPE("upward pass");
+        run(pool, frontier.size(), [this](size_t begin, size_t end) {
+            for (size_t f = begin; f < end; ++f) {
+                upward(frontier[f], false);
+            }
+        });
+        upward(0, true);
+    }
+
+    PROFILE_SCOPE("multipole interactions");
+    // Walk the cell pairs above the frontier here and leave the rest, grouped
+    // by the subtree of the target cell, to the tasks below
+    tasks.assign(frontier.size(), {});
+    Tally tally;
+    interact(0, 0, true, tally);
+    downward(0, true);
+
+    run(pool, frontier.size(), [this](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            Tally local;
+            for (const auto& [target, source] : tasks[f]) {
+                interact(target, source, false, local);
+            }
+            downward(frontier[f], false);
+            PROFILE_COUNT(PairInteractions, local.interactions);
+            PROFILE_COUNT(SoftenedTerms, local.softened);
+        }
+    });
+    PROFILE_COUNT(PairInteractions, tally.interactions);
+}
+
+void FastMultipole::build(const BodyStore& bodies) {
+    cells.clear();
+    const size_t n = bodies.size();
+    positions.resize(n);
+    masses.resize(n);
+    bodyOrder.resize(n);
+    if (n == 0) return;
+
+    // As in Octree::build, the partitioning only shuffles the permutation
+    glm::dvec3 lo = bodies.getPosition(0);
+    glm::dvec3 hi = lo;
+    for (size_t i = 0; i < n; ++i) {
+        glm::dvec3 p = bodies.getPosition(i);
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+        positions[i] = p;
+        masses[i] = bodies.mass[i];
+        bodyOrder[i] = i;
+    }
+    glm::dvec3 extent = hi - lo;
+    double size = std::max(extent.x, std::max(extent.y, extent.z)) * 1.0001 + 1.0;
+
+    cells.reserve(2 * n / leafCapacity + 1);
+    cells.push_back(Cell{(lo + hi) * 0.5, size, glm::dvec3(0.0), 0.0, 0.0, 0, n, -1, 0});
+    buildCell(0, 0);
+
+    std::vector<glm::dvec3> bodyPositions;
+    std::vector<double> bodyMasses;
+    bodyPositions.swap(positions);
+    bodyMasses.swap(masses);
+    positions.resize(n);
+    masses.resize(n);
+    for (size_t k = 0; k < n; ++k) {
+        positions[k] = bodyPositions[bodyOrder[k]];
+        masses[k] = bodyMasses[bodyOrder[k]];
+    }
+}
+
+// Splits like Octree::buildNode and sets each cell's expansion center and
+// radius on the way back up. Masses are still indexed by body here.
+void FastMultipole::buildCell(int index, int depth) {
+    const glm::dvec3 center = cells[index].center;
+    const double size = cells[index].size;
+    const size_t start = cells[index].start;
+    const size_t count = cells[index].count;
+    auto first = bodyOrder.begin() + start;
+    auto last = first + count;
+
+    if (count <= leafCapacity || depth >= MAX_DEPTH) {
+        glm::dvec3 weighted(0.0);
+        double mass = 0.0;
+        for (auto it = first; it != last; ++it) {
+            weighted += positions[*it] * masses[*it];
+            mass += masses[*it];
+        }
+        glm::dvec3 expansionCenter = mass > 0.0 ? weighted / mass : center;
+        double radius = 0.0;
+        for (auto it = first; it != last; ++it) {
+            radius = std::max(radius, glm::length(positions[*it] - expansionCenter));
+        }
+        cells[index].expansionCenter = expansionCenter;
+        cells[index].radius = radius;
+        cells[index].mass = mass;
+        return;
+    }
+
+    auto below = [this](int axis, double split) {
+        return [this, axis, split](size_t i) { return positions[i][axis] < split; };
+    };
+    std::vector<size_t>::iterator bounds[9];
+    bounds[0] = first;
+    bounds[8] = last;
+    bounds[4] = std::partition(bounds[0], bounds[8], below(0, center.x));
+    bounds[2] = std::partition(bounds[0], bounds[4], below(1, center.y));
+    bounds[6] = std::partition(bounds[4], bounds[8], below(1, center.y));
+    for (int k = 0; k < 8; k += 2) {
+        bounds[k + 1] = std::partition(bounds[k], bounds[k + 2], below(2, center.z));
+    }
+
+    int firstChild = static_cast<int>(cells.size());
+    for (int k = 0; k < 8; ++k) {
+        size_t childCount = static_cast<size_t>(bounds[k + 1] - bounds[k]);
+        if (childCount == 0) continue;
+        glm::dvec3 offset((k & 4) ? 0.25 : -0.25, (k & 2) ? 0.25 : -0.25, (k & 1) ? 0.25 : -0.25);
+        cells.push_back(Cell{center + offset * size, size * 0.5, glm::dvec3(0.0), 0.0, 0.0,
+                             static_cast<size_t>(bounds[k] - bodyOrder.begin()), childCount, -1, 0});
+    }
+    int childCount = static_cast<int>(cells.size()) - firstChild;
+    cells[index].firstChild = firstChild;
+    cells[index].childCount = childCount;
+
+    glm::dvec3 weighted(0.0);
+    double mass = 0.0;
+    for (int child = firstChild; child < firstChild + childCount; ++child) {
+        buildCell(child, depth + 1);
+        weighted += cells[child].expansionCenter * cells[child].mass;
+        mass += cells[child].mass;
+    }
+    glm::dvec3 expansionCenter = mass > 0.0 ? weighted / mass : center;
+
+    // The tighter of the children's spheres and the cube's farthest corner
+    double radius = 0.0;
+    for (int child = firstChild; child < firstChild + childCount; ++child) {
+        radius = std::max(radius, glm::length(cells[child].expansionCenter - expansionCenter) + cells[child].radius);
+    }
+    glm::dvec3 corner = glm::abs(expansionCenter - center) + glm::dvec3(size * 0.5);
+    cells[index].expansionCenter = expansionCenter;
+    cells[index].radius = std::min(radius, glm::length(corner));
+    cells[index].mass = mass;
+}
+
+void FastMultipole::findFrontier(int index, size_t frontierSize) {
+    const Cell& cell = cells[index];
+    if (cell.firstChild < 0 || cell.count <= frontierSize) {
+        frontierOf[index] = static_cast<int>(frontier.size());
+        frontier.push_back(index);
+        return;
+    }
+    for (int child = cell.firstChild; child < cell.firstChild + cell.childCount; ++child) {
+        findFrontier(child, frontierSize);
+    }
+}
+
+// P2M at the leaves, then M2M from the children. Above the frontier the
+// subtrees below it are already done.
+void FastMultipole::upward(int index, bool aboveFrontier) {
+    if (aboveFrontier && frontierOf[index] >= 0) return;
+    const Cell& cell = cells[index];
+    const size_t terms = exponents.size();
+    double* multipole = &multipoles[index * terms];
+    double power[MAX_TERMS];
+
+    if (cell.firstChild < 0) {
+        for (size_t k = cell.start; k < cell.start + cell.count; ++k) {
+            powers(positions[k] - cell.expansionCenter, power);
+            for (size_t t = 0; t < terms; ++t) {
+                multipole[t] += masses[k] * power[t];
+            }
+        }
+        return;
+    }
+    for (int child = cell.firstChild; child < cell.firstChild + cell.childCount; ++child) {
+        upward(child, aboveFrontier);
+        powers(cells[child].expansionCenter - cell.expansionCenter, power);
+        const double* childMultipole = &multipoles[child * terms];
+        for (const Term& term : translationTerms) {
+            multipole[term.out] += childMultipole[term.in] * power[term.shift];
+        }
+    }
+}
+
+// L2L into the children, then L2P at the leaves. Above the frontier the
+// frontier cells receive their share and are finished by their tasks.
+void FastMultipole::downward(int index, bool aboveFrontier) {
+    if (aboveFrontier && frontierOf[index] >= 0) return;
+    const Cell& cell = cells[index];
+    const size_t terms = exponents.size();
+    const double* local = &locals[index * terms];
+    double power[MAX_TERMS];
+
+    if (cell.firstChild < 0) {
+        for (size_t k = cell.start; k < cell.start + cell.count; ++k) {
+            powers(positions[k] - cell.expansionCenter, power);
+            double acceleration[3] = {0.0, 0.0, 0.0};
+            for (const Term& term : gradientTerms) {
+                acceleration[term.out] += local[term.in] * power[term.shift];
+            }
+            accelerations[k] += G * glm::dvec3(acceleration[0], acceleration[1], acceleration[2]);
+            if (withPotential) {
+                double phi = 0.0;
+                for (size_t t = 0; t < terms; ++t) {
+                    phi += local[t] * power[t];
+                }
+                potentials[k] -= G * phi;
+            }
+        }
+        return;
+    }
+    for (int child = cell.firstChild; child < cell.firstChild + cell.childCount; ++child) {
+        powers(cells[child].expansionCenter - cell.expansionCenter, power);
+        double* childLocal = &locals[child * terms];
+        for (const Term& term : translationTerms) {
+            childLocal[term.in] += local[term.out] * power[term.shift];
+        }
+        downward(child, aboveFrontier);
+    }
+}
+
+// Dual tree walk (Dehnen 2002) that only ever writes to the target side, so
+// pairs with targets in different frontier subtrees are independent. While
+// collecting, pairs whose target is at or below the frontier are queued.
+void FastMultipole::interact(int target, int source, bool collecting, Tally& tally) {
+    if (collecting && frontierOf[target] >= 0) {
+        tasks[frontierOf[target]].emplace_back(target, source);
+        return;
+    }
+    const Cell& a = cells[target];
+    const Cell& b = cells[source];
+    const bool targetLeaf = a.firstChild < 0;
+    const bool sourceLeaf = b.firstChild < 0;
+
+    // Small pairs are cheaper to sum directly than to translate, and exact
+    const bool direct = a.count * b.count <= directLimit;
+
+    if (target == source) {
+        if (targetLeaf || direct) {
+            particleToParticle(target, source, tally);
+            return;
+        }
+        for (int i = a.firstChild; i < a.firstChild + a.childCount; ++i) {
+            for (int j = a.firstChild; j < a.firstChild + a.childCount; ++j) {
+                interact(i, j, collecting, tally);
+            }
+        }
+        return;
+    }
+
+    // Expansions are of the unsoftened potential, so cells whose bodies may
+    // come closer than NEWTONIAN_DISTANCE are always opened
+    const double distance = glm::length(a.expansionCenter - b.expansionCenter);
+    if (a.radius + b.radius < openingAngle * distance && distance - a.radius - b.radius >= NEWTONIAN_DISTANCE) {
+        multipoleToLocal(target, source);
+        ++tally.interactions;
+        return;
+    }
+    if ((targetLeaf && sourceLeaf) || direct) {
+        particleToParticle(target, source, tally);
+        return;
+    }
+    // Open the larger cell
+    if (sourceLeaf || (!targetLeaf && a.radius >= b.radius)) {
+        for (int i = a.firstChild; i < a.firstChild + a.childCount; ++i) {
+            interact(i, source, collecting, tally);
+        }
+    } else {
+        for (int j = b.firstChild; j < b.firstChild + b.childCount; ++j) {
+            interact(target, j, collecting, tally);
+        }
+    }
+}
+
+void FastMultipole::multipoleToLocal(int target, int source) {
+    const size_t terms = exponents.size();
+    double derivative[MAX_TERMS];
+    derivatives(cells[target].expansionCenter - cells[source].expansionCenter, derivative);
+    const double* multipole = &multipoles[source * terms];
+    double* local = &locals[target * terms];
+    for (size_t j = 0; j < terms; ++j) {
+        double sum = 0.0;
+        const int* shift = &localShift[localStart[j]];
+        const int count = localStart[j + 1] - localStart[j];
+        for (int k = 0; k < count; ++k) {
+            sum += derivative[shift[k]] * multipole[k];
+        }
+        local[j] += degree[j] % 2 == 0 ? sum : -sum;
+    }
+}
+
+void FastMultipole::particleToParticle(int target, int source, Tally& tally) {
+    const Cell& a = cells[target];
+    const Cell& b = cells[source];
+    [[maybe_unused]] uint64_t softened = 0;
+    for (size_t i = a.start; i < a.start + a.count; ++i) {
+        const glm::dvec3 position = positions[i];
+        double ax = 0.0, ay = 0.0, az = 0.0;
+        for (size_t j = b.start; j < b.start + b.count; ++j) {
+            const double dx = positions[j].x - position.x;
+            const double dy = positions[j].y - position.y;
+            const double dz = positions[j].z - position.z;
+            const double distance2 = dx * dx + dy * dy + dz * dz;
+            // Coincident bodies, including the body itself, exert no force
+            // since the softened factor stays finite
+            const double scale = G * masses[j] * softenedInverseCube(distance2);
+            ax += dx * scale;
+            ay += dy * scale;
+            az += dz * scale;
+            if constexpr (Profiler::ENABLED) {
+                softened += distance2 > 0.0 && distance2 < NEWTONIAN_DISTANCE * NEWTONIAN_DISTANCE;
+            }
+        }
+        accelerations[i] += glm::dvec3(ax, ay, az);
+        if (withPotential) {
+            // Unlike its force, a body's softened potential on itself is not zero
+            double phi = 0.0;
+            for (size_t j = b.start; j < b.start + b.count; ++j) {
+                if (j == i) continue;
+                phi += masses[j] * softenedPotential(glm::dot(positions[j] - position, positions[j] - position));
+            }
+            potentials[i] += G * phi;
+        }
+    }
+    tally.interactions += a.count * b.count - (target == source ? a.count : 0);
+    tally.softened += softened;
+}
+
+// d^k / k! for every term
+void FastMultipole::powers(const glm::dvec3& d, double* result) const {
+    result[0] = 1.0;
+    for (size_t t = 1; t < exponents.size(); ++t) {
+        const PowerStep& step = powerSteps[t];
+        result[t] = result[step.below] * d[step.axis] * step.scale;
+    }
+}
+
+void FastMultipole::derivatives(const glm::dvec3& r, double* result) const {
+    const double inverse2 = 1.0 / glm::dot(r, r);
+    result[0] = std::sqrt(inverse2);
+    for (size_t t = 1; t < exponents.size(); ++t) {
+        const Recurrence& c = recurrence[t];
+        // Missing neighbours point at term 0 with weight 0
+        const double first = c.firstWeight[0] * r.x * result[c.first[0]] +
+                             c.firstWeight[1] * r.y * result[c.first[1]] +
+                             c.firstWeight[2] * r.z * result[c.first[2]];
+        const double second = c.secondWeight[0] * result[c.second[0]] + c.secondWeight[1] * result[c.second[1]] +
+                              c.secondWeight[2] * result[c.second[2]];
+        result[t] = (first - second) * inverse2;
+    }
+}
@@ -0,0 +1,133 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+
+#ifndef GRAVITY_FASTMULTIPOLE_H
+#define GRAVITY_FASTMULTIPOLE_H
+#pragma once
+#include <array>
+#include <glm/glm.hpp>
+#include <utility>
+#include <vector>
+#include "BodyStore.h"
+#include "ThreadPool.h"
+
+// Fast multipole method on an adaptive octree, O(N) per force evaluation.
+// Every cell carries a Cartesian multipole expansion about its centre of mass
+// (upward pass: P2M at leaves, M2M towards the root). A dual tree walk turns
+// each well-separated pair of cells into a multipole-to-local translation and
+// each close pair of leaves into direct summation. The local expansions are
+// then shifted down to the leaves and evaluated at the bodies (downward pass:
+// L2L, L2P).
+//
+// Expansions are truncated at total order p, so the force error falls off
+// like theta^p. Two cells interact through their expansions when
+// (r_A + r_B) < theta * d, where r is the radius of the cell's bodies around
+// its expansion centre and d the distance between the centres.
+//
+// The tree is cut into subtrees that depend only on the body count; each is
+// owned by one task, so results are bit-identical for every thread count.
+class FastMultipole {
+public:
+    static const int MAX_ORDER = 10;
+
+    explicit FastMultipole(int order = 4, double openingAngle = 0.5, size_t leafCapacity = 32);
+
+    // Overwrites ax/ay/az of every body. With potentialEnergy, the total
+    // potential energy (J) is also evaluated from the same expansions and
+    // stored there.
+    void computeAccelerations(BodyStore& bodies, ThreadPool* pool = nullptr, double* potentialEnergy = nullptr);
+    // Evaluates the whole field but overwrites only the listed bodies' ax/ay/az
+    void computeAccelerations(BodyStore& bodies, const std::vector<size_t>& targets, ThreadPool* pool = nullptr);
+
+    // Clamped to [1, MAX_ORDER]
+    void setOrder(int p);
+    int getOrder() const { return order; }
+    void setOpeningAngle(double theta) { openingAngle = theta; }
+    double getOpeningAngle() const { return openingAngle; }
+
+private:
+    struct Cell {
+        glm::dvec3 center;       // Geometric center of the octant
+        double size;             // Side length of the octant
+        glm::dvec3 expansionCenter; // Centre of mass, or the geometric center when massless
+        double radius;           // Bound on the distance of the cell's bodies from expansionCenter
+        double mass;
+        size_t start;            // First body (in tree order) covered by this cell
+        size_t count;
+        int firstChild;          // -1 for leaves
+        int childCount;
+    };
+
+    // One term of a precomputed expansion operator, out += in * factor[shift]
+    struct Term {
+        int out;
+        int in;
+        int shift;
+    };
+
+    // d^k / k! = d^(k - e_axis) / (k - e_axis)! * d_axis / k_axis
+    struct PowerStep {
+        int below;
+        int axis;
+        double scale;
+    };
+
+    // Neighbours k - e_i and k - 2 e_i of term k in the derivative recurrence
+    struct Recurrence {
+        int first[3] = {0, 0, 0};
+        int second[3] = {0, 0, 0};
+        double firstWeight[3] = {0.0, 0.0, 0.0};
+        double secondWeight[3] = {0.0, 0.0, 0.0};
+    };
+
+    struct Tally {
+        uint64_t interactions = 0;
+        uint64_t softened = 0;
+    };
+
+    void buildTables();
+    void build(const BodyStore& bodies);
+    void buildCell(int index, int depth);
+    void findFrontier(int index, size_t frontierSize);
+    void evaluate(const BodyStore& bodies, ThreadPool* pool);
+    void upward(int index, bool aboveFrontier);
+    void downward(int index, bool aboveFrontier);
+    void interact(int target, int source, bool collecting, Tally& tally);
+    void multipoleToLocal(int target, int source);
+    void particleToParticle(int target, int source, Tally& tally);
+    void powers(const glm::dvec3& d, double* result) const;
+    void derivatives(const glm::dvec3& r, double* result) const;
+
+    int order;
+    double openingAngle;
+    size_t leafCapacity;
+
+    // Multi-indices k = (kx, ky, kz) with |k| <= order, sorted by |k|
+    std::vector<std::array<int, 3>> exponents;
+    std::vector<int> degree;
+    std::vector<PowerStep> powerSteps;
+    std::vector<Recurrence> recurrence;
+    std::vector<Term> gradientTerms;    // (axis, j, j - e_axis) for L2P
+    std::vector<Term> translationTerms; // (k, j <= k, k - j) for M2M and L2L
+    std::vector<int> localStart;        // Start of row j of localShift; a row runs over k = 0, 1, ...
+    std::vector<int> localShift;        // Term k + j, for M2L
+    size_t directLimit = 0;             // Cell pairs with at most this many body pairs are summed directly
+
+    std::vector<Cell> cells;
+    std::vector<glm::dvec3> positions;  // Tree order after the build
+    std::vector<double> masses;         // Tree order after the build
+    std::vector<size_t> bodyOrder;      // Tree order -> body index
+    std::vector<double> multipoles;     // exponents.size() per cell
+    std::vector<double> locals;         // exponents.size() per cell, without the factor G
+    std::vector<glm::dvec3> accelerations; // Tree order
+    std::vector<double> potentials;     // Tree order (J/kg), only when withPotential
+    bool withPotential = false;
+    std::vector<int> frontier;          // Roots of the subtrees handed to tasks
+    std::vector<int> frontierOf;        // Cell -> index into frontier, -1 above and below it
+    std::vector<std::vector<std::pair<int, int>>> tasks; // Cell pairs left for each frontier subtree
+
+    static const int MAX_DEPTH = 32;
+    static const int MAX_TERMS = (MAX_ORDER + 1) * (MAX_ORDER + 2) * (MAX_ORDER + 3) / 6;
+};
+#endif //GRAVITY_FASTMULTIPOLE_H
@@ -0,0 +1,183 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+#include "FieldGrid.h"
+#include "Physics.h"
+#include "Profiler.h"
+#include "SimdLanes.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+    using Lanes = SimdLanes<float>;
+
+    // Grid points a side of a tile, a whole number of SIMD vectors
+    const size_t TILE = 16;
+    static_assert(TILE % Lanes::WIDTH == 0, "Tile rows must be whole SIMD vectors");
+    // Of the source tree; 0.5 keeps the potential within about 0.2%
+    // of a direct sum
+    const double OPENING_ANGLE = 0.5;
+
+    // Cell coordinates packed 21 bits an axis; cells further out share the edge cells
+    uint64_t cellKey(const glm::dvec3& cell) {
+        const double limit = double(1 << 20) - 1.0;
+        auto axis = [limit](double c) {
+            return static_cast<uint64_t>(static_cast<int64_t>(std::clamp(std::floor(c), -limit, limit)) + (1 << 20));
+        };
+        return axis(cell.x) << 42 | axis(cell.y) << 21 | axis(cell.z);
+    }
+
+    struct Source {
+        glm::dvec3 weighted{0.0};  // sum m r
+        double mass = 0.0;
+    };
+}
+
+FieldGrid::FieldGrid(double size, size_t resolution)
+        : size(size),
+          resolution(resolution),
+          tilesPerSide((resolution + TILE - 1) / TILE),
+          tree(OPENING_ANGLE) {
+    if (resolution < 2 || !(size > 0.0)) {
+        throw std::runtime_error("A field grid needs a positive size and at least two points a side");
+    }
+}
+
+bool FieldGrid::needsUpdate(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses) const {
+    if (!valid || positions.size() != computedPositions.size() || masses != computedMasses) return true;
+    const double limit = tolerance * getSpacing();
+    for (size_t i = 0; i < positions.size(); ++i) {
+        const glm::dvec3 moved = positions[i] - computedPositions[i];
+        if (glm::dot(moved, moved) > limit * limit) return true;
+    }
+    return false;
+}
+
+bool FieldGrid::update(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses,
+                       ThreadPool* pool) {
+    if (!needsUpdate(positions, masses)) return false;
+    PROFILE_SCOPE("field grid");
+    computedPositions = positions;
+    computedMasses = masses;
+    mergeSources(positions, masses);
+    tree.build(sources);
+
+    potential.resize(resolution * resolution);
+    fieldStrength.resize(resolution * resolution);
+    const size_t tiles = tilesPerSide * tilesPerSide;
+    if (pool) {
+        pool->parallelFor(tiles, 1, [this](size_t begin, size_t end) {
+            for (size_t tile = begin; tile < end; ++tile) {
+                computeTile(tile);
+            }
+        });
+    } else {
+        for (size_t tile = 0; tile < tiles; ++tile) {
+            computeTile(tile);
+        }
+    }
+    minPotential = *std::min_element(potential.begin(), potential.end());
+    maxFieldStrength = *std::max_element(fieldStrength.begin(), fieldStrength.end());
+    valid = true;
+    ++computations;
+    return true;
+}
+
+// One source per occupied cube of one spacing, at its centre of mass
+void FieldGrid::mergeSources(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses) {
+    const double spacing = getSpacing();
+    const glm::dvec3 origin(-0.5 * size, 0.0, -0.5 * size);
+    std::unordered_map<uint64_t, size_t> slots;
+    std::vector<Source> merged;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        if (!(masses[i] > 0.0)) continue;
+        const glm::dvec3 cell = (positions[i] - origin) / spacing;
+        auto inserted = slots.emplace(cellKey(cell + glm::dvec3(0.5)), merged.size());
+        if (inserted.second) merged.emplace_back();
+        Source& source = merged[inserted.first->second];
+        source.weighted += masses[i] * cell;
+        source.mass += masses[i];
+    }
+
+    sources.clear();
+    for (const Source& source : merged) {
+        const glm::dvec3 center = source.weighted / source.mass;
+        sources.x.push_back(center.x);
+        sources.y.push_back(center.y);
+        sources.z.push_back(center.z);
+        sources.mass.push_back(source.mass);
+    }
+}
+
+// In spacings, softened by one: phi = -G / s * sum m / sqrt(d^2 + 1) and
+// g = G / s^2 * |sum m d / (d^2 + 1)^(3/2)| for grid spacing s. Masses are
+// taken relative to the largest in the list to stay well inside float range.
+void FieldGrid::computeTile(size_t tile) {
+    using V = Lanes::V;
+    const size_t firstColumn = tile % tilesPerSide * TILE;
+    const size_t firstRow = tile / tilesPerSide * TILE;
+    const size_t lastColumn = std::min(firstColumn + TILE, resolution) - 1;
+    const size_t lastRow = std::min(firstRow + TILE, resolution) - 1;
+
+    std::vector<glm::dvec3> points;
+    std::vector<double> pointMasses;
+    const Octree::Bounds region{glm::dvec3(firstColumn, 0.0, firstRow), glm::dvec3(lastColumn, 0.0, lastRow)};
+    tree.exportEssential({region}, points, pointMasses);
+
+    double massUnit = 0.0;
+    for (double mass : pointMasses) {
+        massUnit = std::max(massUnit, mass);
+    }
+    if (massUnit == 0.0) massUnit = 1.0;
+    const size_t count = points.size();
+    std::vector<float> px(count), py(count), pz(count), pm(count);
+    for (size_t k = 0; k < count; ++k) {
+        px[k] = static_cast<float>(points[k].x);
+        py[k] = static_cast<float>(points[k].y);
+        pz[k] = static_cast<float>(points[k].z);
+        pm[k] = static_cast<float>(pointMasses[k] / massUnit);
+    }
+
+    const double spacing = getSpacing();
+    const double potentialScale = -G * massUnit / spacing;
+    const double strengthScale = G * massUnit / (spacing * spacing);
+    const V one = Lanes::set(1.0);
+    float columns[TILE];
+    float tilePotential[TILE];
+    float tileStrength[TILE];
+    for (size_t i = 0; i < TILE; ++i) {
+        columns[i] = static_cast<float>(firstColumn + i);
+    }
+
+    for (size_t row = firstRow; row <= lastRow; ++row) {
+        const V z = Lanes::set(static_cast<double>(row));
+        for (size_t i = 0; i < TILE; i += Lanes::WIDTH) {
+            const V x = Lanes::load(columns + i);
+            V phi = Lanes::set(0.0);
+            V gx = phi, gy = phi, gz = phi;
+            for (size_t k = 0; k < count; ++k) {
+                const V dx = Lanes::sub(Lanes::set(px[k]), x);
+                const V dy = Lanes::set(py[k]);
+                const V dz = Lanes::sub(Lanes::set(pz[k]), z);
+                const V r2 = Lanes::fmadd(dx, dx, Lanes::fmadd(dy, dy, Lanes::fmadd(dz, dz, one)));
+                const V inverse = Lanes::div(one, Lanes::sqrt(r2));
+                const V weighted = Lanes::mul(Lanes::set(pm[k]), inverse);
+                phi = Lanes::add(phi, weighted);
+                const V pull = Lanes::mul(weighted, Lanes::mul(inverse, inverse));
+                gx = Lanes::fmadd(pull, dx, gx);
+                gy = Lanes::fmadd(pull, dy, gy);
+                gz = Lanes::fmadd(pull, dz, gz);
+            }
+            const V strength2 = Lanes::fmadd(gx, gx, Lanes::fmadd(gy, gy, Lanes::mul(gz, gz)));
+            Lanes::store(tilePotential + i, phi);
+            Lanes::store(tileStrength + i, Lanes::sqrt(strength2));
+        }
+        for (size_t column = firstColumn; column <= lastColumn; ++column) {
+            potential[row * resolution + column] = static_cast<float>(potentialScale * tilePotential[column - firstColumn]);
+            fieldStrength[row * resolution + column] =
+                    static_cast<float>(strengthScale * tileStrength[column - firstColumn]);
+        }
+    }
+}
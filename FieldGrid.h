@@ -0,0 +1,82 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+
+#ifndef GRAVITY_FIELDGRID_H
+#define GRAVITY_FIELDGRID_H
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "BodyStore.h"
+#include "Octree.h"
+#include "ThreadPool.h"
+
+// Gravitational potential and field strength on a square grid in the y = 0
+// plane, for drawing. Point (i, j) is at x = -size/2 + i spacing,
+// z = -size/2 + j spacing, and is stored at j * resolution + i.
+//
+// The values are kept until some body has moved more than a tolerance, so
+// a slowly changing system costs one O(N) check per new state rather than a
+// pass over grid points times bodies. A recomputation first merges the
+// bodies into one source per occupied grid cell, softened by one spacing:
+// the grid cannot show anything finer, and a dense cluster costs as much as
+// a few bodies. The sources go into an octree, and each square tile of grid
+// points takes the tree's locally essential points for the tile as its
+// interaction list, so distant crowds are summed as a few cells. Tiles are
+// spread over the pool, and each is evaluated a SIMD vector of grid points
+// at a time in single precision.
+class FieldGrid {
+public:
+    // A square of side size (m) centred on the origin, resolution points a side
+    FieldGrid(double size, size_t resolution);
+
+    double getSize() const { return size; }
+    size_t getResolution() const { return resolution; }
+    double getSpacing() const { return size / static_cast<double>(resolution - 1); }
+    // Bodies may move this many spacings before the grid is recomputed (default 0.25)
+    void setTolerance(double spacings) { tolerance = spacings; }
+    double getTolerance() const { return tolerance; }
+
+    // Recomputes the grid if bodies were added or removed, a mass changed or
+    // a body moved more than the tolerance since the last computation.
+    // Returns whether it did.
+    bool update(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses,
+                ThreadPool* pool = nullptr);
+    // Makes the next update recompute
+    void invalidate() { valid = false; }
+
+    // J/kg and m/s^2, empty before the first update
+    const std::vector<float>& getPotential() const { return potential; }
+    const std::vector<float>& getFieldStrength() const { return fieldStrength; }
+    float getMinPotential() const { return minPotential; }
+    float getMaxFieldStrength() const { return maxFieldStrength; }
+    uint64_t getComputations() const { return computations; }
+
+private:
+    bool needsUpdate(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses) const;
+    void mergeSources(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses);
+    void computeTile(size_t tile);
+
+    double size;
+    size_t resolution;
+    size_t tilesPerSide;
+    double tolerance = 0.25;
+    bool valid = false;
+
+    // Bodies at the last computation
+    std::vector<glm::dvec3> computedPositions;
+    std::vector<double> computedMasses;
+
+    // Merged sources, in spacings from the grid's first point; only their
+    // positions and masses are set
+    BodyStore sources;
+    Octree tree;
+
+    std::vector<float> potential;
+    std::vector<float> fieldStrength;
+    float minPotential = 0.0f;
+    float maxFieldStrength = 0.0f;
+    uint64_t computations = 0;
+};
+#endif //GRAVITY_FIELDGRID_H
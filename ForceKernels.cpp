@@ -0,0 +1,293 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+#include "ForceKernels.h"
+#include "Profiler.h"
+#include "SimdLanes.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+namespace {
+    // The kernels work in units of the softening length, with G m / L^2 in
+    // place of each mass, so float pair terms stay far from overflow while
+    // the accelerations still come out in m/s^2.
+    const double UNIT = 1.0 / SOFTENING_LENGTH;
+    const double MASS_SCALE = G * UNIT * UNIT;
+
+    template<typename Precision>
+    struct Arrays {
+        const typename Precision::Position* x;
+        const typename Precision::Position* y;
+        const typename Precision::Position* z;
+        const typename Precision::Pair* gm;
+        typename Precision::Accumulator* ax;
+        typename Precision::Accumulator* ay;
+        typename Precision::Accumulator* az;
+    };
+
+    void run(ThreadPool* pool, size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+        if (pool) {
+            pool->parallelFor(count, grain, body);
+        } else {
+            body(0, count);
+        }
+    }
+
+    // The bodies converted for one precision policy. Each thread keeps its
+    // own, so repeated evaluations reuse the buffers.
+    template<typename Precision>
+    struct Workspace {
+        using Accumulator = typename Precision::Accumulator;
+        // Double accumulators are the body store's own arrays
+        static constexpr bool SEPARATE_SUMS = !std::is_same_v<Accumulator, double>;
+
+        std::vector<typename Precision::Position> x, y, z;
+        std::vector<typename Precision::Pair> gm;
+        std::vector<Accumulator> ax, ay, az;
+
+        Arrays<Precision> prepare(BodyStore& bodies, bool scatter, ThreadPool* pool) {
+            const size_t n = bodies.size();
+            x.resize(n);
+            y.resize(n);
+            z.resize(n);
+            gm.resize(n);
+            if (SEPARATE_SUMS && scatter) {
+                ax.assign(n, Accumulator(0));
+                ay.assign(n, Accumulator(0));
+                az.assign(n, Accumulator(0));
+            }
+            run(pool, n, 4096, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    x[i] = static_cast<typename Precision::Position>(bodies.x[i] * UNIT);
+                    y[i] = static_cast<typename Precision::Position>(bodies.y[i] * UNIT);
+                    z[i] = static_cast<typename Precision::Position>(bodies.z[i] * UNIT);
+                    gm[i] = static_cast<typename Precision::Pair>(bodies.mass[i] * MASS_SCALE);
+                }
+            });
+            if constexpr (SEPARATE_SUMS) {
+                return {x.data(), y.data(), z.data(), gm.data(), ax.data(), ay.data(), az.data()};
+            } else {
+                return {x.data(), y.data(), z.data(), gm.data(), bodies.ax.data(), bodies.ay.data(),
+                        bodies.az.data()};
+            }
+        }
+
+        // Adds separately summed accelerations to the body store
+        void finish(BodyStore& bodies, ThreadPool* pool) const {
+            if constexpr (SEPARATE_SUMS) {
+                run(pool, bodies.size(), 4096, [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; ++i) {
+                        bodies.ax[i] += ax[i];
+                        bodies.ay[i] += ay[i];
+                        bodies.az[i] += az[i];
+                    }
+                });
+            }
+        }
+    };
+
+    // Where the opposite forces of a tile pair go: body j's sums are at
+    // x[j - first], and so on
+    template<typename Sum>
+    struct ScatterTarget {
+        Sum* x;
+        Sum* y;
+        Sum* z;
+        size_t first;
+    };
+
+    // Body i against bodies [j, jEnd), Lanes::WIDTH at a time; returns where
+    // it stopped. The pair term is branch-free: softening keeps it finite, so
+    // no NaN/Inf checks are needed. With Scatter the opposite force is also
+    // subtracted from body j (Newton's third law). With Potential, acc[3]
+    // gathers the sum of gm_j times the softened potential. Softened terms are
+    // only counted in profiling builds.
+    template<typename Lanes, typename Softening, bool Scatter, bool Potential, typename Precision, typename Sum>
+    size_t row(const Arrays<Precision>& b, size_t i, size_t j, size_t jEnd, const ScatterTarget<Sum>* scatter,
+               typename Precision::Accumulator acc[4], [[maybe_unused]] uint64_t& softened) {
+        using V = typename Lanes::V;
+        const V gmi = Lanes::set(b.gm[i]);
+        [[maybe_unused]] const V range2 = Lanes::set(Softening::NEWTONIAN_RANGE * Softening::NEWTONIAN_RANGE);
+        V sx = Lanes::set(0.0), sy = Lanes::set(0.0), sz = Lanes::set(0.0);
+        [[maybe_unused]] V sp = Lanes::set(0.0);
+        for (; j + Lanes::WIDTH <= jEnd; j += Lanes::WIDTH) {
+            const V dx = Lanes::difference(b.x + j, b.x[i]);
+            const V dy = Lanes::difference(b.y + j, b.y[i]);
+            const V dz = Lanes::difference(b.z + j, b.z[i]);
+            const V r2 = Lanes::fmadd(dx, dx, Lanes::fmadd(dy, dy, Lanes::mul(dz, dz)));
+            if constexpr (Profiler::ENABLED) softened += Lanes::count(Lanes::less(r2, range2));
+            const V s = Softening::template scale<Lanes>(r2);
+            const V gmj = Lanes::load(b.gm + j);
+            const V sj = Lanes::mul(gmj, s);
+            sx = Lanes::fmadd(dx, sj, sx);
+            sy = Lanes::fmadd(dy, sj, sy);
+            sz = Lanes::fmadd(dz, sj, sz);
+            if constexpr (Potential) {
+                sp = Lanes::fmadd(gmj, Softening::template potential<Lanes>(r2), sp);
+            }
+            if constexpr (Scatter) {
+                const V si = Lanes::mul(gmi, s);
+                Lanes::subtract(scatter->x + (j - scatter->first), dx, si);
+                Lanes::subtract(scatter->y + (j - scatter->first), dy, si);
+                Lanes::subtract(scatter->z + (j - scatter->first), dz, si);
+            }
+        }
+        acc[0] += Lanes::sum(sx);
+        acc[1] += Lanes::sum(sy);
+        acc[2] += Lanes::sum(sz);
+        if constexpr (Potential) acc[3] += Lanes::sum(sp);
+        return j;
+    }
+
+    template<typename Softening, bool Scatter, bool Potential, typename Precision, typename Sum>
+    size_t fullRow(const Arrays<Precision>& b, size_t i, size_t j, size_t jEnd, const ScatterTarget<Sum>* scatter,
+                   typename Precision::Accumulator acc[4], uint64_t& softened) {
+        using Pair = typename Precision::Pair;
+        j = row<SimdLanes<Pair>, Softening, Scatter, Potential>(b, i, j, jEnd, scatter, acc, softened);
+        return row<ScalarLanes<Pair>, Softening, Scatter, Potential>(b, i, j, jEnd, scatter, acc, softened);
+    }
+
+    // Depends only on n so the schedule, and therefore the result, is the same
+    // at every thread count. At most 512 bodies so a j tile stays in L1/L2.
+    size_t tileSizeFor(size_t n) {
+        size_t tile = (n / 32 + 7) / 8 * 8;
+        return std::min<size_t>(std::max<size_t>(tile, 64), 512);
+    }
+
+    // When pair terms are narrower than the sums (mixed precision), the
+    // opposite forces of a tile pair are gathered in a buffer of pair terms
+    // and added to the sums once, rather than converted pair by pair. Returns
+    // the tile pair's share of the potential energy in kernel units (zero
+    // without Potential).
+    template<typename Softening, bool Potential, typename Precision>
+    double tilePair(const Arrays<Precision>& b, size_t n, size_t tile, size_t ti, size_t tj) {
+        using Pair = typename Precision::Pair;
+        const size_t iEnd = std::min((ti + 1) * tile, n);
+        const size_t jBegin = tj * tile;
+        const size_t jEnd = std::min(jBegin + tile, n);
+        uint64_t softened = 0;
+        double potential = 0.0;
+        auto rows = [&](const auto& scatter) {
+            for (size_t i = ti * tile; i < iEnd; ++i) {
+                typename Precision::Accumulator acc[4] = {0, 0, 0, 0};
+                fullRow<Softening, true, Potential>(b, i, ti == tj ? i + 1 : jBegin, jEnd, &scatter, acc, softened);
+                b.ax[i] += acc[0];
+                b.ay[i] += acc[1];
+                b.az[i] += acc[2];
+                if constexpr (Potential) potential += static_cast<double>(b.gm[i]) * acc[3];
+            }
+        };
+        if constexpr (std::is_same_v<Pair, typename Precision::Accumulator>) {
+            rows(ScatterTarget<Pair>{b.ax, b.ay, b.az, 0});
+        } else {
+            thread_local std::vector<Pair> buffer;
+            const size_t count = jEnd - jBegin;
+            buffer.assign(3 * count, Pair(0));
+            rows(ScatterTarget<Pair>{buffer.data(), buffer.data() + count, buffer.data() + 2 * count, jBegin});
+            for (size_t k = 0; k < count; ++k) {
+                b.ax[jBegin + k] += buffer[k];
+                b.ay[jBegin + k] += buffer[count + k];
+                b.az[jBegin + k] += buffer[2 * count + k];
+            }
+        }
+        PROFILE_COUNT(SoftenedTerms, softened);
+        return potential;
+    }
+}
+
+template<typename Precision, typename Softening>
+void accumulatePairwiseAccelerations(BodyStore& bodies, ThreadPool* pool, double* potentialEnergy) {
+    if (potentialEnergy) *potentialEnergy = 0.0;
+    const size_t n = bodies.size();
+    if (n < 2) return;
+    thread_local Workspace<Precision> workspace;
+    const Arrays<Precision> b = workspace.prepare(bodies, true, pool);
+    const size_t tile = tileSizeFor(n);
+    const size_t tiles = (n + tile - 1) / tile;
+
+    // Each tile pair's potential goes into its own slot and the slots are
+    // summed in order, so the energy is as reproducible as the forces
+    std::vector<std::pair<size_t, size_t>> round;
+    std::vector<double> roundPotential;
+    double potential = 0.0;
+    auto runRound = [&]() {
+        if (potentialEnergy) {
+            roundPotential.assign(round.size(), 0.0);
+            run(pool, round.size(), 1, [&](size_t begin, size_t end) {
+                for (size_t k = begin; k < end; ++k) {
+                    roundPotential[k] = tilePair<Softening, true>(b, n, tile, round[k].first, round[k].second);
+                }
+            });
+            for (double p : roundPotential) potential += p;
+            return;
+        }
+        run(pool, round.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                tilePair<Softening, false>(b, n, tile, round[k].first, round[k].second);
+            }
+        });
+    };
+
+    // Diagonal tiles first, then the circle method: with an even number of
+    // slots m, round r pairs slot m - 1 with r and (r + k) with (r - k) mod (m - 1)
+    for (size_t t = 0; t < tiles; ++t) {
+        round.emplace_back(t, t);
+    }
+    runRound();
+
+    const size_t slots = tiles + (tiles & 1);   // An odd tile count gets a dummy slot
+    for (size_t r = 0; r + 1 < slots; ++r) {
+        round.clear();
+        for (size_t k = 0; k < slots / 2; ++k) {
+            size_t first = k == 0 ? slots - 1 : (r + k) % (slots - 1);
+            size_t second = k == 0 ? r : (r + slots - 1 - k) % (slots - 1);
+            if (first >= tiles || second >= tiles) continue;
+            round.emplace_back(std::min(first, second), std::max(first, second));
+        }
+        runRound();
+    }
+    workspace.finish(bodies, pool);
+    if (potentialEnergy) {
+        // Back from G m / L^2 per mass and 1 / L per potential to joules
+        *potentialEnergy = potential * SOFTENING_LENGTH * SOFTENING_LENGTH * SOFTENING_LENGTH / G;
+    }
+}
+
+template<typename Precision, typename Softening>
+void computePairwiseAccelerations(BodyStore& bodies, const std::vector<size_t>& targets, ThreadPool* pool) {
+    const size_t n = bodies.size();
+    thread_local Workspace<Precision> workspace;
+    const Arrays<Precision> b = workspace.prepare(bodies, false, pool);
+    run(pool, targets.size(), 16, [&](size_t begin, size_t end) {
+        uint64_t softened = 0;
+        for (size_t k = begin; k < end; ++k) {
+            const size_t i = targets[k];
+            typename Precision::Accumulator acc[4] = {0, 0, 0, 0};
+            const ScatterTarget<typename Precision::Pair>* none = nullptr;
+            fullRow<Softening, false, false>(b, i, 0, i, none, acc, softened);
+            fullRow<Softening, false, false>(b, i, i + 1, n, none, acc, softened);
+            bodies.ax[i] = acc[0];
+            bodies.ay[i] = acc[1];
+            bodies.az[i] = acc[2];
+        }
+        PROFILE_COUNT(SoftenedTerms, softened);
+    });
+}
+
+#define INSTANTIATE_PAIRWISE(Precision, Softening) \
+    template void accumulatePairwiseAccelerations<Precision, Softening>(BodyStore&, ThreadPool*, double*); \
+    template void computePairwiseAccelerations<Precision, Softening>(BodyStore&, const std::vector<size_t>&, \
+                                                                     ThreadPool*);
+
+INSTANTIATE_PAIRWISE(DoublePrecision, ClampSoftening)
+INSTANTIATE_PAIRWISE(DoublePrecision, PlummerSoftening)
+INSTANTIATE_PAIRWISE(DoublePrecision, SplineSoftening)
+INSTANTIATE_PAIRWISE(MixedPrecision, ClampSoftening)
+INSTANTIATE_PAIRWISE(MixedPrecision, PlummerSoftening)
+INSTANTIATE_PAIRWISE(MixedPrecision, SplineSoftening)
+INSTANTIATE_PAIRWISE(FloatPrecision, ClampSoftening)
+INSTANTIATE_PAIRWISE(FloatPrecision, PlummerSoftening)
+INSTANTIATE_PAIRWISE(FloatPrecision, SplineSoftening)
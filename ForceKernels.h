@@ -0,0 +1,36 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+
+#ifndef GRAVITY_FORCEKERNELS_H
+#define GRAVITY_FORCEKERNELS_H
+#pragma once
+#include <vector>
+#include "BodyStore.h"
+#include "Physics.h"
+#include "ThreadPool.h"
+
+// Direct summation over every pair i < j. Each pair is evaluated once and
+// applied to both bodies (Newton's third law); the results are added to the
+// ax/ay/az arrays. Uses AVX-512 or AVX2 when the build targets them.
+//
+// Precision and Softening are the policies of Physics.h; the defaults are
+// the ones the build selected. Every combination is compiled in, so callers
+// such as the benchmark can compare them in one binary.
+//
+// Bodies are split into tiles and tile pairs are run in round-robin rounds in
+// which no tile appears twice, so threads never write to the same body and
+// every acceleration is summed in the same order whatever the thread count.
+// pool may be null to run on the calling thread.
+//
+// With potentialEnergy, the total softened potential energy (J) is summed in
+// the same pass and stored there.
+template<typename Precision = ForcePrecision, typename Softening = ForceSoftening>
+void accumulatePairwiseAccelerations(BodyStore& bodies, ThreadPool* pool = nullptr, double* potentialEnergy = nullptr);
+
+// Direct summation for the listed bodies only, each gathering from every other
+// body. Overwrites their ax/ay/az and leaves every other body untouched.
+template<typename Precision = ForcePrecision, typename Softening = ForceSoftening>
+void computePairwiseAccelerations(BodyStore& bodies, const std::vector<size_t>& targets, ThreadPool* pool = nullptr);
+
+#endif //GRAVITY_FORCEKERNELS_H
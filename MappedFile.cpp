@@ -0,0 +1,63 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+#include "MappedFile.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) fail(path);
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) fail(path);
+    length = static_cast<size_t>(size.QuadPart);
+    if (length == 0) return;
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) fail(path);
+    bytes = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!bytes) fail(path);
+#else
+    descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) fail(path);
+    struct stat status;
+    if (fstat(descriptor, &status) != 0) fail(path);
+    length = static_cast<size_t>(status.st_size);
+    if (length == 0) return;
+    void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (address == MAP_FAILED) fail(path);
+    madvise(address, length, MADV_SEQUENTIAL);
+    bytes = static_cast<const char*>(address);
+#endif
+}
+
+MappedFile::~MappedFile() {
+    release();
+}
+
+void MappedFile::release() {
+#ifdef _WIN32
+    if (bytes) UnmapViewOfFile(bytes);
+    if (mapping) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+    if (bytes) munmap(const_cast<char*>(bytes), length);
+    if (descriptor >= 0) close(descriptor);
+#endif
+}
+
+// The constructor cleans up itself, since the destructor won't run
+void MappedFile::fail(const std::string& path) {
+    release();
+    throw std::runtime_error("Failed to map " + path);
+}
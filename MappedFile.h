@@ -0,0 +1,38 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+
+#ifndef GRAVITY_MAPPEDFILE_H
+#define GRAVITY_MAPPEDFILE_H
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file, mapped with mmap or MapViewOfFile so large
+// inputs are paged in on demand instead of copied through a read buffer
+class MappedFile {
+public:
+    // Throws std::runtime_error if the file can't be opened or mapped
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+#ifdef _WIN32
+    void* file;
+    void* mapping = nullptr;
+#else
+    int descriptor = -1;
+#endif
+    const char* bytes = nullptr;
+    size_t length = 0;
+
+    void release();
+    void fail(const std::string& path);
+};
+#endif //GRAVITY_MAPPEDFILE_H
@@ -0,0 +1,400 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+#include "Octree.h"
+#include "Physics.h"
+#include "Profiler.h"
+#include "SimdLanes.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    // Interaction lists are kept in units of the softening length, with
+    // G m / L^2 in place of each mass, as in the direct-summation kernels
+    const double UNIT = 1.0 / SOFTENING_LENGTH;
+    const double MASS_SCALE = G * UNIT * UNIT;
+
+    struct InteractionList {
+        std::vector<double> x, y, z, gm;
+
+        void clear() {
+            x.clear();
+            y.clear();
+            z.clear();
+            gm.clear();
+        }
+        void add(const glm::dvec3& position, double mass) {
+            x.push_back(position.x * UNIT);
+            y.push_back(position.y * UNIT);
+            z.push_back(position.z * UNIT);
+            gm.push_back(mass * MASS_SCALE);
+        }
+    };
+
+    // One body against list entries [k, end), Lanes::WIDTH at a time; returns
+    // where it stopped. Entries at the body's own position, the body itself
+    // among them, are left out, as in the single-body walk. With Potential,
+    // acc[3] gathers the sum of gm times the softened potential.
+    template<typename Lanes, bool Potential>
+    size_t sumList(const InteractionList& list, size_t k, size_t end, const glm::dvec3& position, double acc[4],
+                   [[maybe_unused]] uint64_t& softened) {
+        using V = typename Lanes::V;
+        const V zero = Lanes::set(0.0);
+        [[maybe_unused]] const V range2 = Lanes::set(ForceSoftening::NEWTONIAN_RANGE
+                                                     * ForceSoftening::NEWTONIAN_RANGE);
+        V sx = zero, sy = zero, sz = zero;
+        [[maybe_unused]] V sp = zero;
+        for (; k + Lanes::WIDTH <= end; k += Lanes::WIDTH) {
+            const V dx = Lanes::difference(list.x.data() + k, position.x);
+            const V dy = Lanes::difference(list.y.data() + k, position.y);
+            const V dz = Lanes::difference(list.z.data() + k, position.z);
+            const V r2 = Lanes::fmadd(dx, dx, Lanes::fmadd(dy, dy, Lanes::mul(dz, dz)));
+            const auto apart = Lanes::less(zero, r2);
+            if constexpr (Profiler::ENABLED) {
+                softened += Lanes::count(Lanes::less(r2, range2)) - (Lanes::WIDTH - Lanes::count(apart));
+            }
+            const V gm = Lanes::select(apart, Lanes::load(list.gm.data() + k), zero);
+            const V s = Lanes::mul(gm, ForceSoftening::scale<Lanes>(r2));
+            sx = Lanes::fmadd(dx, s, sx);
+            sy = Lanes::fmadd(dy, s, sy);
+            sz = Lanes::fmadd(dz, s, sz);
+            if constexpr (Potential) {
+                sp = Lanes::fmadd(gm, ForceSoftening::potential<Lanes>(r2), sp);
+            }
+        }
+        acc[0] += Lanes::sum(sx);
+        acc[1] += Lanes::sum(sy);
+        acc[2] += Lanes::sum(sz);
+        if constexpr (Potential) acc[3] += Lanes::sum(sp);
+        return k;
+    }
+
+    template<bool Potential>
+    void sumFullList(const InteractionList& list, const glm::dvec3& position, double acc[4], uint64_t& softened) {
+        const size_t k = sumList<SimdLanes<double>, Potential>(list, 0, list.x.size(), position, acc, softened);
+        sumList<ScalarLanes<double>, Potential>(list, k, list.x.size(), position, acc, softened);
+    }
+}
+
+Octree::Octree(double openingAngle, size_t leafCapacity)
+        : openingAngle(openingAngle), leafCapacity(std::max<size_t>(leafCapacity, 1)) {}
+
+void Octree::build(const BodyStore& bodies) {
+    nodes.clear();
+    groups.clear();
+    const size_t n = bodies.size();
+    positions.resize(n);
+    masses.resize(n);
+    order.resize(n);
+    slot.resize(n);
+    if (n == 0) return;
+
+    // While building, positions/masses are indexed by body; the octant
+    // partitioning only shuffles the order permutation
+    glm::dvec3 lo = bodies.getPosition(0);
+    glm::dvec3 hi = lo;
+    for (size_t i = 0; i < n; ++i) {
+        glm::dvec3 p = bodies.getPosition(i);
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+        positions[i] = p;
+        masses[i] = bodies.mass[i];
+        order[i] = i;
+    }
+    glm::dvec3 extent = hi - lo;
+    double size = std::max(extent.x, std::max(extent.y, extent.z)) * 1.0001 + 1.0;
+
+    nodes.reserve(2 * n / leafCapacity + 1);
+    nodes.push_back(Node{(lo + hi) * 0.5, size, glm::dvec3(0.0), 0.0, 0, n, -1, 0});
+    buildNode(0, 0);
+
+    // Gather into tree order so leaf buckets are contiguous in memory
+    std::vector<glm::dvec3> bodyPositions;
+    std::vector<double> bodyMasses;
+    bodyPositions.swap(positions);
+    bodyMasses.swap(masses);
+    positions.resize(n);
+    masses.resize(n);
+    for (size_t k = 0; k < n; ++k) {
+        positions[k] = bodyPositions[order[k]];
+        masses[k] = bodyMasses[order[k]];
+        slot[order[k]] = k;
+    }
+    findGroups(0);
+}
+
+void Octree::findGroups(int index) {
+    const Node& node = nodes[index];
+    if (node.count <= GROUP_SIZE || node.firstChild < 0) {
+        groups.push_back(index);
+        return;
+    }
+    for (int child = node.firstChild; child < node.firstChild + node.childCount; ++child) {
+        findGroups(child);
+    }
+}
+
+void Octree::buildNode(int index, int depth) {
+    const glm::dvec3 center = nodes[index].center;
+    const double size = nodes[index].size;
+    const size_t start = nodes[index].start;
+    const size_t count = nodes[index].count;
+    auto first = order.begin() + start;
+    auto last = first + count;
+
+    if (count <= leafCapacity || depth >= MAX_DEPTH) {
+        glm::dvec3 weighted(0.0);
+        double mass = 0.0;
+        for (auto it = first; it != last; ++it) {
+            weighted += positions[*it] * masses[*it];
+            mass += masses[*it];
+        }
+        nodes[index].mass = mass;
+        nodes[index].centerOfMass = mass > 0.0 ? weighted / mass : center;
+        return;
+    }
+
+    // Split the range into octants: x first, then y, then z, so child k has bits xyz
+    auto below = [this](int axis, double split) {
+        return [this, axis, split](size_t i) { return positions[i][axis] < split; };
+    };
+    std::vector<size_t>::iterator bounds[9];
+    bounds[0] = first;
+    bounds[8] = last;
+    bounds[4] = std::partition(bounds[0], bounds[8], below(0, center.x));
+    bounds[2] = std::partition(bounds[0], bounds[4], below(1, center.y));
+    bounds[6] = std::partition(bounds[4], bounds[8], below(1, center.y));
+    for (int k = 0; k < 8; k += 2) {
+        bounds[k + 1] = std::partition(bounds[k], bounds[k + 2], below(2, center.z));
+    }
+
+    // Children occupy consecutive slots so a node only needs its first child index
+    int firstChild = static_cast<int>(nodes.size());
+    for (int k = 0; k < 8; ++k) {
+        size_t childCount = static_cast<size_t>(bounds[k + 1] - bounds[k]);
+        if (childCount == 0) continue;
+        glm::dvec3 offset((k & 4) ? 0.25 : -0.25, (k & 2) ? 0.25 : -0.25, (k & 1) ? 0.25 : -0.25);
+        nodes.push_back(Node{center + offset * size, size * 0.5, glm::dvec3(0.0), 0.0,
+                             static_cast<size_t>(bounds[k] - order.begin()), childCount, -1, 0});
+    }
+    int childCount = static_cast<int>(nodes.size()) - firstChild;
+    nodes[index].firstChild = firstChild;
+    nodes[index].childCount = childCount;
+
+    glm::dvec3 weighted(0.0);
+    double mass = 0.0;
+    for (int child = firstChild; child < firstChild + childCount; ++child) {
+        buildNode(child, depth + 1);
+        weighted += nodes[child].centerOfMass * nodes[child].mass;
+        mass += nodes[child].mass;
+    }
+    nodes[index].mass = mass;
+    nodes[index].centerOfMass = mass > 0.0 ? weighted / mass : center;
+}
+
+void Octree::computeAccelerations(BodyStore& bodies, size_t count, ThreadPool* pool, double* potentials,
+                                  double* interactions) const {
+    if (pool) {
+        pool->parallelFor(groups.size(), 16, [&](size_t begin, size_t end) {
+            for (size_t group = begin; group < end; ++group) {
+                computeGroup(group, bodies, count, potentials, interactions);
+            }
+        });
+    } else {
+        for (size_t group = 0; group < groups.size(); ++group) {
+            computeGroup(group, bodies, count, potentials, interactions);
+        }
+    }
+}
+
+void Octree::computeGroup(size_t group, BodyStore& bodies, size_t count, double* potentials,
+                          double* interactions) const {
+    const Node& members = nodes[groups[group]];
+    const size_t first = members.start;
+    const size_t last = members.start + members.count;
+    if (std::none_of(order.begin() + first, order.begin() + last, [count](size_t i) { return i < count; })) {
+        return;
+    }
+
+    Bounds box{positions[first], positions[first]};
+    for (size_t k = first + 1; k < last; ++k) {
+        box.lo = glm::min(box.lo, positions[k]);
+        box.hi = glm::max(box.hi, positions[k]);
+    }
+
+    // The group's own node is never accepted, so its bodies are on the list
+    thread_local InteractionList list;
+    list.clear();
+    const double theta2 = openingAngle * openingAngle;
+    int stack[8 * MAX_DEPTH + 8];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        const glm::dvec3 gap = glm::max(glm::max(box.lo - node.centerOfMass, node.centerOfMass - box.hi),
+                                        glm::dvec3(0.0));
+        if (node.size * node.size < theta2 * glm::dot(gap, gap)) {
+            list.add(node.centerOfMass, node.mass);
+            continue;
+        }
+        if (node.firstChild < 0) {
+            for (size_t k = node.start; k < node.start + node.count; ++k) {
+                list.add(positions[k], masses[k]);
+            }
+            continue;
+        }
+        for (int child = node.firstChild; child < node.firstChild + node.childCount; ++child) {
+            stack[top++] = child;
+        }
+    }
+
+    uint64_t softened = 0;
+    for (size_t k = first; k < last; ++k) {
+        const size_t i = order[k];
+        if (i >= count) continue;
+        double acc[4] = {0.0, 0.0, 0.0, 0.0};
+        if (potentials) {
+            sumFullList<true>(list, positions[k] * UNIT, acc, softened);
+            potentials[i] = acc[3] * SOFTENING_LENGTH;
+        } else {
+            sumFullList<false>(list, positions[k] * UNIT, acc, softened);
+        }
+        bodies.ax[i] = acc[0];
+        bodies.ay[i] = acc[1];
+        bodies.az[i] = acc[2];
+        if (interactions) interactions[i] = static_cast<double>(list.x.size() - 1);
+    }
+    PROFILE_COUNT(PairInteractions, (list.x.size() - 1) * members.count);
+    PROFILE_COUNT(SoftenedTerms, softened);
+}
+
+glm::dvec3 Octree::computeAcceleration(size_t bodyIndex, double* potential, uint64_t* interactionCount) const {
+    glm::dvec3 acceleration(0.0);
+    double phi = 0.0;
+    if (potential) *potential = 0.0;
+    if (interactionCount) *interactionCount = 0;
+    if (nodes.empty()) return acceleration;
+
+    const size_t self = slot[bodyIndex];
+    const glm::dvec3 position = positions[self];
+    const double theta2 = openingAngle * openingAngle;
+
+    int stack[8 * MAX_DEPTH + 8];
+    int top = 0;
+    stack[top++] = 0;
+    uint64_t interactions = 0;
+    [[maybe_unused]] uint64_t softened = 0;
+
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        bool containsSelf = self >= node.start && self < node.start + node.count;
+
+        if (!containsSelf) {
+            glm::dvec3 direction = node.centerOfMass - position;
+            double distance2 = glm::dot(direction, direction);
+            if (node.size * node.size < theta2 * distance2) {
+                acceleration += direction * (G * node.mass * softenedInverseCube(distance2));
+                if (potential) phi += G * node.mass * softenedPotential(distance2);
+                ++interactions;
+                softened += distance2 < NEWTONIAN_DISTANCE * NEWTONIAN_DISTANCE;
+                continue;
+            }
+        }
+
+        if (node.firstChild < 0) {
+            for (size_t k = node.start; k < node.start + node.count; ++k) {
+                if (k == self) continue;
+                glm::dvec3 direction = positions[k] - position;
+                double distance2 = glm::dot(direction, direction);
+                if (distance2 <= 0.0) continue;
+                acceleration += direction * (G * masses[k] * softenedInverseCube(distance2));
+                if (potential) phi += G * masses[k] * softenedPotential(distance2);
+                softened += distance2 < NEWTONIAN_DISTANCE * NEWTONIAN_DISTANCE;
+            }
+            interactions += node.count - (containsSelf ? 1 : 0);
+            continue;
+        }
+
+        for (int child = node.firstChild; child < node.firstChild + node.childCount; ++child) {
+            stack[top++] = child;
+        }
+    }
+    PROFILE_COUNT(PairInteractions, interactions);
+    PROFILE_COUNT(SoftenedTerms, softened);
+    if (potential) *potential = phi;
+    if (interactionCount) *interactionCount = interactions;
+    return acceleration;
+}
+
+std::vector<Octree::Bounds> Octree::getCover(size_t maxCells) const {
+    std::vector<int> cells;
+    if (!nodes.empty()) cells.push_back(0);
+    for (;;) {
+        // Split the largest cell that has children and still fits
+        int largest = -1;
+        for (size_t k = 0; k < cells.size(); ++k) {
+            const Node& node = nodes[cells[k]];
+            if (node.firstChild >= 0 && cells.size() + node.childCount - 1 <= maxCells
+                && (largest < 0 || node.size > nodes[cells[largest]].size)) {
+                largest = static_cast<int>(k);
+            }
+        }
+        if (largest < 0) break;
+        const Node node = nodes[cells[largest]];
+        cells[largest] = node.firstChild;
+        for (int child = node.firstChild + 1; child < node.firstChild + node.childCount; ++child) {
+            cells.push_back(child);
+        }
+    }
+    // The bodies' own bounds, not the cells': those reach into the space
+    // between the bodies, which for a domain is usually someone else's
+    std::vector<Bounds> cover;
+    cover.reserve(cells.size());
+    for (int cell : cells) {
+        const Node& node = nodes[cell];
+        Bounds bounds{positions[node.start], positions[node.start]};
+        for (size_t k = node.start + 1; k < node.start + node.count; ++k) {
+            bounds.lo = glm::min(bounds.lo, positions[k]);
+            bounds.hi = glm::max(bounds.hi, positions[k]);
+        }
+        cover.push_back(bounds);
+    }
+    return cover;
+}
+
+void Octree::exportEssential(const std::vector<Bounds>& region, std::vector<glm::dvec3>& points,
+                             std::vector<double>& pointMasses) const {
+    points.clear();
+    pointMasses.clear();
+    if (nodes.empty() || region.empty()) return;
+    const double theta2 = openingAngle * openingAngle;
+
+    int stack[8 * MAX_DEPTH + 8];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        // Closest any point of the region comes to the centre of mass
+        double gap2 = std::numeric_limits<double>::infinity();
+        for (const Bounds& box : region) {
+            const glm::dvec3 gap = glm::max(glm::max(box.lo - node.centerOfMass, node.centerOfMass - box.hi),
+                                            glm::dvec3(0.0));
+            gap2 = std::min(gap2, glm::dot(gap, gap));
+        }
+        if (node.size * node.size < theta2 * gap2) {
+            points.push_back(node.centerOfMass);
+            pointMasses.push_back(node.mass);
+            continue;
+        }
+        if (node.firstChild < 0) {
+            points.insert(points.end(), positions.begin() + node.start, positions.begin() + node.start + node.count);
+            pointMasses.insert(pointMasses.end(), masses.begin() + node.start,
+                               masses.begin() + node.start + node.count);
+            continue;
+        }
+        for (int child = node.firstChild; child < node.firstChild + node.childCount; ++child) {
+            stack[top++] = child;
+        }
+    }
+}
@@ -0,0 +1,86 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+
+#ifndef GRAVITY_OCTREE_H
+#define GRAVITY_OCTREE_H
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "BodyStore.h"
+#include "ThreadPool.h"
+
+// Barnes-Hut octree. Bodies are copied into tree order so that every node
+// covers a contiguous range, and leaves hold small buckets instead of
+// single bodies to keep the tree shallow.
+class Octree {
+public:
+    explicit Octree(double openingAngle = 0.5, size_t leafCapacity = 8);
+
+    void build(const BodyStore& bodies);
+    // Overwrites the accelerations of the first count bodies of bodies, which
+    // must be the store the tree was built from or one that starts with the
+    // same bodies. The tree is walked once per group of up to GROUP_SIZE
+    // nearby bodies: a cell counts as a point mass when it passes the opening
+    // test for every point of the group's bounding box, and the cells and
+    // bodies found make one interaction list that is summed for each body of
+    // the group with SIMD lanes. With potentials or interactions, stores
+    // each body's potential (J/kg) or the length of its list there, for the
+    // first count bodies. Results do not depend on the thread count.
+    void computeAccelerations(BodyStore& bodies, size_t count, ThreadPool* pool = nullptr,
+                              double* potentials = nullptr, double* interactions = nullptr) const;
+    // One body's own walk, for evaluating a few bodies. With potential, also
+    // stores the potential (J/kg) at the body from the same walk; with
+    // interactions, the number of cells and bodies it took
+    glm::dvec3 computeAcceleration(size_t bodyIndex, double* potential = nullptr,
+                                   uint64_t* interactions = nullptr) const;
+    struct Bounds {
+        glm::dvec3 lo;
+        glm::dvec3 hi;
+    };
+    // Bounding boxes of the bodies of at most maxCells cells that hold every
+    // body between them, found by splitting the largest cell first. A much
+    // tighter outline than one bounding box when the bodies are clustered.
+    std::vector<Bounds> getCover(size_t maxCells) const;
+    // The locally essential tree for a remote region, the union of some
+    // boxes: every cell that passes the opening test for all points of the
+    // region, as a point mass at its centre of mass, and the bodies of the
+    // leaves that do not. A walk over these points from inside the region
+    // accepts the same cells as a walk over this tree.
+    void exportEssential(const std::vector<Bounds>& region, std::vector<glm::dvec3>& points,
+                         std::vector<double>& pointMasses) const;
+
+    void setOpeningAngle(double theta) { openingAngle = theta; }
+    double getOpeningAngle() const { return openingAngle; }
+
+private:
+    struct Node {
+        glm::dvec3 center;       // Geometric center of the cell
+        double size;             // Side length of the cell
+        glm::dvec3 centerOfMass;
+        double mass;
+        size_t start;            // First body (in tree order) covered by this node
+        size_t count;
+        int firstChild;          // -1 for leaves
+        int childCount;
+    };
+
+    void buildNode(int index, int depth);
+    void findGroups(int index);
+    void computeGroup(size_t group, BodyStore& bodies, size_t count, double* potentials,
+                      double* interactions) const;
+
+    std::vector<Node> nodes;
+    std::vector<glm::dvec3> positions;   // Tree order
+    std::vector<double> masses;          // Tree order
+    std::vector<size_t> order;           // Tree order -> body index
+    std::vector<size_t> slot;            // Body index -> tree order
+    std::vector<int> groups;             // Largest nodes of at most GROUP_SIZE bodies
+    double openingAngle;
+    size_t leafCapacity;
+
+    static const int MAX_DEPTH = 32;
+    static const size_t GROUP_SIZE = 64;
+};
+#endif //GRAVITY_OCTREE_H
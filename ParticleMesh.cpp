@@ -0,0 +1,587 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+#include "ParticleMesh.h"
+#include "Physics.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace {
+    // Potential at the centre of a uniform cube of unit side, mass and G; the
+    // Green's function's value for a mesh point's own mass
+    const double CUBE_SELF_POTENTIAL = 2.3800774;
+
+    void run(ThreadPool* pool, size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+        if (pool) {
+            pool->parallelFor(count, grain, body);
+        } else {
+            body(0, count);
+        }
+    }
+}
+
+ParticleMesh::ParticleMesh(size_t size, MassAssignment assignment) : size(0), assignment(assignment) {
+    setSize(size);
+}
+
+void ParticleMesh::setSize(size_t requested) {
+    size_t rounded = MIN_SIZE;
+    while (rounded < requested && rounded < MAX_SIZE) {
+        rounded *= 2;
+    }
+    if (rounded == size) return;
+    size = rounded;
+    potential.clear();
+    for (auto& component : field) {
+        component.clear();
+    }
+    padded.clear();
+    green.clear();
+
+    // Transforms run over the padded side
+    const size_t m = 2 * size;
+    int bits = 0;
+    while ((size_t(1) << bits) < m) {
+        ++bits;
+    }
+    reversed.resize(m);
+    for (size_t i = 0; i < m; ++i) {
+        size_t r = 0;
+        for (int b = 0; b < bits; ++b) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        reversed[i] = r;
+    }
+    twiddles.resize(m / 2);
+    for (size_t k = 0; k < m / 2; ++k) {
+        double angle = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(m);
+        twiddles[k] = std::complex<double>(std::cos(angle), std::sin(angle));
+    }
+}
+
+void ParticleMesh::solve(const BodyStore& bodies, ThreadPool* pool) {
+    solve(bodies.size(), [&bodies](size_t i) { return bodies.getPosition(i); }, bodies.mass.data(), pool);
+}
+
+void ParticleMesh::solve(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses,
+                         ThreadPool* pool) {
+    solve(std::min(positions.size(), masses.size()), [&positions](size_t i) { return positions[i]; },
+          masses.data(), pool);
+}
+
+template <typename Position>
+void ParticleMesh::solve(size_t count, Position position, const double* masses, ThreadPool* pool) {
+    placement.assign(count, CoreMesh);
+    directPositions.clear();
+    directMasses.clear();
+    outerUsed = false;
+
+    // A few dominant bodies are cheaper to add directly than to smooth. With
+    // more than MAX_DIRECT of them, none dominates.
+    double total = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        total += masses[i];
+    }
+    std::vector<size_t> heavy;
+    for (size_t i = 0; i < count && total > 0.0; ++i) {
+        if (masses[i] >= HEAVY_FRACTION * total) heavy.push_back(i);
+    }
+    if (heavy.size() > MAX_DIRECT) heavy.clear();
+    for (size_t i : heavy) {
+        placement[i] = Direct;
+        directPositions.push_back(position(i));
+        directMasses.push_back(masses[i]);
+    }
+
+    // The core is the cube around the centre of mass of the mesh bodies that
+    // holds CORE_FRACTION of them, by count so that the shape of the system
+    // decides rather than its heaviest members
+    glm::dvec3 weighted(0.0);
+    double meshMass = 0.0;
+    size_t meshCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (placement[i] == Direct) continue;
+        weighted += position(i) * masses[i];
+        meshMass += masses[i];
+        ++meshCount;
+    }
+    bool split = false;
+    if (meshCount > 1 && meshMass > 0.0) {
+        const glm::dvec3 center = weighted / meshMass;
+        std::vector<double> reach;
+        reach.reserve(meshCount);
+        for (size_t i = 0; i < count; ++i) {
+            if (placement[i] == Direct) continue;
+            const glm::dvec3 d = glm::abs(position(i) - center);
+            reach.push_back(std::max(d.x, std::max(d.y, d.z)));
+        }
+        const double widest = *std::max_element(reach.begin(), reach.end());
+        auto quantile = reach.begin() + static_cast<std::ptrdiff_t>(CORE_FRACTION * static_cast<double>(meshCount - 1));
+        std::nth_element(reach.begin(), quantile, reach.end());
+        const double halfWidth = *quantile;
+        split = halfWidth > 0.0 && widest > 2.0 * halfWidth;
+        for (size_t i = 0; i < count && split; ++i) {
+            if (placement[i] == Direct) continue;
+            const glm::dvec3 d = glm::abs(position(i) - center);
+            if (std::max(d.x, std::max(d.y, d.z)) > halfWidth) placement[i] = OuterMesh;
+        }
+    }
+
+    if (heavy.empty() && !split) {
+        solveMesh(count, position, masses, pool);
+        return;
+    }
+    std::vector<glm::dvec3> corePositions, outerPositions;
+    std::vector<double> coreMasses, outerMasses;
+    for (size_t i = 0; i < count; ++i) {
+        if (placement[i] == CoreMesh) {
+            corePositions.push_back(position(i));
+            coreMasses.push_back(masses[i]);
+        } else if (placement[i] == OuterMesh) {
+            outerPositions.push_back(position(i));
+            outerMasses.push_back(masses[i]);
+        }
+    }
+    solveMesh(corePositions.size(), [&corePositions](size_t i) { return corePositions[i]; }, coreMasses.data(),
+              pool);
+    if (split) {
+        if (!outer) outer = std::make_unique<ParticleMesh>(size / 2, assignment);
+        outer->setSize(size / 2);
+        outer->setAssignment(assignment);
+        outer->solveMesh(outerPositions.size(), [&outerPositions](size_t i) { return outerPositions[i]; },
+                         outerMasses.data(), pool);
+        outerUsed = true;
+    }
+}
+
+template <typename Position>
+void ParticleMesh::solveMesh(size_t count, Position position, const double* masses, ThreadPool* pool) {
+    const size_t n = size;
+    potential.assign(n * n * n, 0.0);
+    for (auto& component : field) {
+        component.assign(n * n * n, 0.0);
+    }
+    totalMass = 0.0;
+    centerOfMass = glm::dvec3(0.0);
+    if (count == 0) return;
+
+    // A cube around every body with two spare cells on each side, so the
+    // widest stencil stays on the mesh
+    glm::dvec3 lo = position(0);
+    glm::dvec3 hi = lo;
+    glm::dvec3 weighted(0.0);
+    for (size_t i = 0; i < count; ++i) {
+        glm::dvec3 p = position(i);
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+        weighted += p * masses[i];
+        totalMass += masses[i];
+    }
+    centerOfMass = totalMass > 0.0 ? weighted / totalMass : (lo + hi) * 0.5;
+    glm::dvec3 extent = hi - lo;
+    double largest = std::max(extent.x, std::max(extent.y, extent.z));
+    cellSize = largest > 0.0 ? largest * 1.0001 / static_cast<double>(n - 5) : 1.0;
+    origin = (lo + hi) * 0.5 - glm::dvec3(cellSize * static_cast<double>(n - 1) * 0.5);
+
+    prepareGreen(pool);
+    {
+        PROFILE_SCOPE("mesh deposit");
+        deposit(count, position, masses, pool);
+    }
+    {
+        PROFILE_SCOPE("mesh convolution");
+        convolve(pool);
+    }
+    differentiate(pool);
+}
+
+// Bodies are sorted into z slabs by the first mesh plane they touch. A slab
+// writes to at most three planes, so slabs three apart never overlap: they
+// run in parallel in three rounds, and every mesh point is summed in the
+// same order for any thread count.
+template <typename Position>
+void ParticleMesh::deposit(size_t count, Position position, const double* masses, ThreadPool* pool) {
+    const size_t n = size;
+    const size_t m = 2 * n;
+    std::fill(padded.begin(), padded.end(), std::complex<double>(0.0));
+
+    std::vector<size_t> slabStart(n + 1, 0);
+    std::vector<uint32_t> slabOf(count);
+    for (size_t i = 0; i < count; ++i) {
+        Stencil s = stencil((position(i).z - origin.z) / cellSize);
+        slabOf[i] = static_cast<uint32_t>(s.first);
+        ++slabStart[s.first + 1];
+    }
+    for (size_t s = 0; s < n; ++s) {
+        slabStart[s + 1] += slabStart[s];
+    }
+    std::vector<size_t> order(count);
+    std::vector<size_t> fill(slabStart.begin(), slabStart.end() - 1);
+    for (size_t i = 0; i < count; ++i) {
+        order[fill[slabOf[i]]++] = i;
+    }
+
+    for (size_t round = 0; round < 3; ++round) {
+        const size_t slabs = (n - round + 2) / 3;
+        run(pool, slabs, 1, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                const size_t slab = round + 3 * k;
+                for (size_t j = slabStart[slab]; j < slabStart[slab + 1]; ++j) {
+                    const size_t i = order[j];
+                    const glm::dvec3 u = (position(i) - origin) / cellSize;
+                    const Stencil sx = stencil(u.x), sy = stencil(u.y), sz = stencil(u.z);
+                    for (int c = 0; c < sz.count; ++c) {
+                        for (int b = 0; b < sy.count; ++b) {
+                            const double w = masses[i] * sz.weight[c] * sy.weight[b];
+                            std::complex<double>* row = &padded[(static_cast<size_t>(sz.first + c) * m
+                                                                 + static_cast<size_t>(sy.first + b)) * m];
+                            for (int a = 0; a < sx.count; ++a) {
+                                row[sx.first + a] += w * sx.weight[a];
+                            }
+                        }
+                    }
+                }
+            }
+        });
+    }
+}
+
+// The padded mesh is zero outside [0, size)^3, so the forward transform can
+// skip lines that are still all zero, and the inverse only needs to finish
+// the lines that end up inside
+void ParticleMesh::convolve(ThreadPool* pool) {
+    const size_t n = size;
+    const size_t m = 2 * n;
+    transformLines(0, n, n, false, pool);
+    transformLines(1, m, n, false, pool);
+    transformLines(2, m, m, false, pool);
+    const double scale = G / cellSize;
+    run(pool, m * m * m, size_t(1) << 16, [this, scale](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            padded[i] *= green[i] * scale;
+        }
+    });
+    transformLines(2, m, m, true, pool);
+    transformLines(1, m, n, true, pool);
+    transformLines(0, n, n, true, pool);
+    run(pool, n, 1, [this, n, m](size_t begin, size_t end) {
+        for (size_t z = begin; z < end; ++z) {
+            for (size_t y = 0; y < n; ++y) {
+                for (size_t x = 0; x < n; ++x) {
+                    potential[(z * n + y) * n + x] = padded[(z * m + y) * m + x].real();
+                }
+            }
+        }
+    });
+}
+
+// Fourth-order central differences, falling back to second order and then
+// one-sided differences at the faces
+void ParticleMesh::differentiate(ThreadPool* pool) {
+    const size_t n = size;
+    const double h = cellSize;
+    run(pool, n, 1, [this, n, h](size_t begin, size_t end) {
+        const size_t strides[3] = {1, n, n * n};
+        for (size_t z = begin; z < end; ++z) {
+            for (size_t y = 0; y < n; ++y) {
+                for (size_t x = 0; x < n; ++x) {
+                    const size_t i = (z * n + y) * n + x;
+                    const size_t coordinate[3] = {x, y, z};
+                    for (int axis = 0; axis < 3; ++axis) {
+                        const size_t c = coordinate[axis];
+                        const size_t s = strides[axis];
+                        double gradient;
+                        if (c >= 2 && c + 2 < n) {
+                            gradient = (potential[i - 2 * s] - 8.0 * potential[i - s] + 8.0 * potential[i + s]
+                                        - potential[i + 2 * s]) / (12.0 * h);
+                        } else if (c >= 1 && c + 1 < n) {
+                            gradient = (potential[i + s] - potential[i - s]) / (2.0 * h);
+                        } else if (c == 0) {
+                            gradient = (potential[i + s] - potential[i]) / h;
+                        } else {
+                            gradient = (potential[i] - potential[i - s]) / h;
+                        }
+                        field[axis][i] = -gradient;
+                    }
+                }
+            }
+        }
+    });
+}
+
+// -1 / r on the padded mesh for unit spacing, with each axis wrapped so the
+// second half holds negative offsets, transformed once per mesh size
+void ParticleMesh::prepareGreen(ThreadPool* pool) {
+    const size_t m = 2 * size;
+    if (green.size() == m * m * m) return;
+    padded.assign(m * m * m, std::complex<double>(0.0));
+    run(pool, m, 1, [this, m](size_t begin, size_t end) {
+        for (size_t z = begin; z < end; ++z) {
+            const double dz = static_cast<double>(std::min(z, m - z));
+            for (size_t y = 0; y < m; ++y) {
+                const double dy = static_cast<double>(std::min(y, m - y));
+                for (size_t x = 0; x < m; ++x) {
+                    const double dx = static_cast<double>(std::min(x, m - x));
+                    const double r = std::sqrt(dx * dx + dy * dy + dz * dz);
+                    padded[(z * m + y) * m + x] = r > 0.0 ? -1.0 / r : -CUBE_SELF_POTENTIAL;
+                }
+            }
+        }
+    });
+    transformLines(0, m, m, false, pool);
+    transformLines(1, m, m, false, pool);
+    transformLines(2, m, m, false, pool);
+    // The function is real and even, so its transform is real. The inverse
+    // transform's 1 / m^3 is folded in here.
+    green.resize(m * m * m);
+    const double normalisation = 1.0 / static_cast<double>(m * m * m);
+    for (size_t i = 0; i < green.size(); ++i) {
+        green[i] = padded[i].real() * normalisation;
+    }
+}
+
+// Iterative radix-2 transform of one line of 2 size points
+void ParticleMesh::transform(std::complex<double>* data, bool inverse) const {
+    const size_t m = reversed.size();
+    for (size_t i = 0; i < m; ++i) {
+        if (i < reversed[i]) std::swap(data[i], data[reversed[i]]);
+    }
+    for (size_t length = 2; length <= m; length *= 2) {
+        const size_t half = length / 2;
+        const size_t step = m / length;
+        for (size_t start = 0; start < m; start += length) {
+            for (size_t k = 0; k < half; ++k) {
+                const std::complex<double> w = twiddles[k * step];
+                const double wi = inverse ? -w.imag() : w.imag();
+                const std::complex<double> a = data[start + k];
+                const std::complex<double> b = data[start + k + half];
+                // Written out: std::complex's operator* checks for infinities
+                const std::complex<double> t(b.real() * w.real() - b.imag() * wi, b.real() * wi + b.imag() * w.real());
+                data[start + k] = a + t;
+                data[start + k + half] = a - t;
+            }
+        }
+    }
+}
+
+// Transforms every line along axis whose other two coordinates, in x, y, z
+// order, are below firstLimit and secondLimit
+void ParticleMesh::transformLines(int axis, size_t firstLimit, size_t secondLimit, bool inverse,
+                                  ThreadPool* pool) {
+    const size_t m = 2 * size;
+    const size_t stride = axis == 0 ? 1 : (axis == 1 ? m : m * m);
+    run(pool, firstLimit * secondLimit, 16, [&](size_t begin, size_t end) {
+        std::vector<std::complex<double>> line(stride == 1 ? 0 : m);
+        for (size_t l = begin; l < end; ++l) {
+            const size_t a = l % firstLimit;
+            const size_t b = l / firstLimit;
+            const size_t base = axis == 0 ? (b * m + a) * m : (axis == 1 ? b * m * m + a : b * m + a);
+            if (stride == 1) {
+                transform(&padded[base], inverse);
+                continue;
+            }
+            for (size_t k = 0; k < m; ++k) {
+                line[k] = padded[base + k * stride];
+            }
+            transform(line.data(), inverse);
+            for (size_t k = 0; k < m; ++k) {
+                padded[base + k * stride] = line[k];
+            }
+        }
+    });
+}
+
+ParticleMesh::Stencil ParticleMesh::stencil(double u) const {
+    Stencil s{};
+    if (assignment == MassAssignment::CloudInCell) {
+        const double cell = std::floor(u);
+        const double d = u - cell;
+        s.first = static_cast<int>(cell);
+        s.count = 2;
+        s.weight[0] = 1.0 - d;
+        s.weight[1] = d;
+    } else {
+        const double cell = std::floor(u + 0.5);
+        const double d = u - cell;
+        s.first = static_cast<int>(cell) - 1;
+        s.count = 3;
+        s.weight[0] = 0.5 * (0.5 - d) * (0.5 - d);
+        s.weight[1] = 0.75 - d * d;
+        s.weight[2] = 0.5 * (0.5 + d) * (0.5 + d);
+    }
+    return s;
+}
+
+// Whether a stencil at u stays on the mesh
+bool ParticleMesh::inside(const glm::dvec3& u) const {
+    const double limit = static_cast<double>(size) - 2.0;
+    return !potential.empty() && u.x >= 1.0 && u.y >= 1.0 && u.z >= 1.0 && u.x <= limit && u.y <= limit
+           && u.z <= limit;
+}
+
+glm::dvec3 ParticleMesh::interpolateField(const glm::dvec3& position) const {
+    const size_t n = size;
+    const glm::dvec3 u = (position - origin) / cellSize;
+    const Stencil sx = stencil(u.x), sy = stencil(u.y), sz = stencil(u.z);
+    glm::dvec3 result(0.0);
+    for (int c = 0; c < sz.count; ++c) {
+        for (int b = 0; b < sy.count; ++b) {
+            const double w = sz.weight[c] * sy.weight[b];
+            const size_t row = (static_cast<size_t>(sz.first + c) * n + static_cast<size_t>(sy.first + b)) * n;
+            for (int a = 0; a < sx.count; ++a) {
+                const size_t i = row + static_cast<size_t>(sx.first + a);
+                const double weight = w * sx.weight[a];
+                result += weight * glm::dvec3(field[0][i], field[1][i], field[2][i]);
+            }
+        }
+    }
+    return result;
+}
+
+glm::dvec3 ParticleMesh::fieldAt(const glm::dvec3& position) const {
+    glm::dvec3 result = meshFieldAt(position);
+    if (outerUsed) result += outer->meshFieldAt(position);
+    for (size_t k = 0; k < directMasses.size(); ++k) {
+        const glm::dvec3 direction = directPositions[k] - position;
+        const double distance2 = glm::dot(direction, direction);
+        if (distance2 > 0.0) result += direction * (G * directMasses[k] * softenedInverseCube(distance2));
+    }
+    return result;
+}
+
+double ParticleMesh::potentialAt(const glm::dvec3& position) const {
+    double result = meshPotentialAt(position);
+    if (outerUsed) result += outer->meshPotentialAt(position);
+    for (size_t k = 0; k < directMasses.size(); ++k) {
+        const glm::dvec3 direction = directPositions[k] - position;
+        const double distance2 = glm::dot(direction, direction);
+        if (distance2 > 0.0) result += G * directMasses[k] * softenedPotential(distance2);
+    }
+    return result;
+}
+
+glm::dvec3 ParticleMesh::meshFieldAt(const glm::dvec3& position) const {
+    if (inside((position - origin) / cellSize)) {
+        return interpolateField(position);
+    }
+    const glm::dvec3 offset = centerOfMass - position;
+    const double distance = glm::length(offset);
+    return distance > 0.0 ? offset * (G * totalMass / (distance * distance * distance)) : glm::dvec3(0.0);
+}
+
+double ParticleMesh::meshPotentialAt(const glm::dvec3& position) const {
+    const size_t n = size;
+    const glm::dvec3 u = (position - origin) / cellSize;
+    if (!inside(u)) {
+        const double distance = glm::length(centerOfMass - position);
+        return distance > 0.0 ? -G * totalMass / distance : 0.0;
+    }
+    const Stencil sx = stencil(u.x), sy = stencil(u.y), sz = stencil(u.z);
+    double result = 0.0;
+    for (int c = 0; c < sz.count; ++c) {
+        for (int b = 0; b < sy.count; ++b) {
+            const size_t row = (static_cast<size_t>(sz.first + c) * n + static_cast<size_t>(sy.first + b)) * n;
+            for (int a = 0; a < sx.count; ++a) {
+                result += sz.weight[c] * sy.weight[b] * sx.weight[a] * potential[row + sx.first + a];
+            }
+        }
+    }
+    return result;
+}
+
+// Potential per G m / cellSize that a body at mesh coordinates u feels from
+// its own deposited mass. The assignment weights are a product over the axes,
+// so the weight of each offset between two of its mesh points is a product of
+// per-axis autocorrelations, and 125 offsets cover every pair of a 27-point
+// stencil.
+double ParticleMesh::selfPotential(const glm::dvec3& u) const {
+    static const auto table = [] {
+        std::array<double, 125> g{};
+        for (int z = -2; z <= 2; ++z) {
+            for (int y = -2; y <= 2; ++y) {
+                for (int x = -2; x <= 2; ++x) {
+                    const double r = std::sqrt(static_cast<double>(x * x + y * y + z * z));
+                    g[((z + 2) * 5 + y + 2) * 5 + x + 2] = r > 0.0 ? -1.0 / r : -CUBE_SELF_POTENTIAL;
+                }
+            }
+        }
+        return g;
+    }();
+    double correlation[3][5];
+    for (int axis = 0; axis < 3; ++axis) {
+        const Stencil s = stencil(u[axis]);
+        for (int d = -2; d <= 2; ++d) {
+            double sum = 0.0;
+            for (int a = std::max(0, d); a < s.count && a - d < s.count; ++a) {
+                sum += s.weight[a] * s.weight[a - d];
+            }
+            correlation[axis][d + 2] = sum;
+        }
+    }
+    double result = 0.0;
+    for (int z = 0; z < 5; ++z) {
+        for (int y = 0; y < 5; ++y) {
+            const double w = correlation[2][z] * correlation[1][y];
+            for (int x = 0; x < 5; ++x) {
+                result += w * correlation[0][x] * table[(z * 5 + y) * 5 + x];
+            }
+        }
+    }
+    return result;
+}
+
+double ParticleMesh::meshSelfPotential(const glm::dvec3& position, double mass) const {
+    const glm::dvec3 u = (position - origin) / cellSize;
+    return inside(u) ? G * mass / cellSize * selfPotential(u) : 0.0;
+}
+
+void ParticleMesh::computeAccelerations(BodyStore& bodies, ThreadPool* pool, double* potentialEnergy) const {
+    PROFILE_SCOPE("mesh interpolation");
+    run(pool, bodies.size(), 4096, [this, &bodies](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const glm::dvec3 acceleration = fieldAt(bodies.getPosition(i));
+            bodies.ax[i] = acceleration.x;
+            bodies.ay[i] = acceleration.y;
+            bodies.az[i] = acceleration.z;
+        }
+    });
+    if (!potentialEnergy) return;
+    // One partial sum per chunk of the same fixed size, added in order
+    const size_t chunk = 4096;
+    std::vector<double> partial((bodies.size() + chunk - 1) / chunk, 0.0);
+    run(pool, partial.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            double sum = 0.0;
+            for (size_t i = c * chunk; i < std::min((c + 1) * chunk, bodies.size()); ++i) {
+                const glm::dvec3 position = bodies.getPosition(i);
+                double phi = potentialAt(position);
+                const uint8_t where = i < placement.size() ? placement[i] : static_cast<uint8_t>(CoreMesh);
+                if (where == CoreMesh) {
+                    phi -= meshSelfPotential(position, bodies.mass[i]);
+                } else if (where == OuterMesh) {
+                    phi -= outer->meshSelfPotential(position, bodies.mass[i]);
+                }
+                sum += bodies.mass[i] * phi;
+            }
+            partial[c] = sum;
+        }
+    });
+    double energy = 0.0;
+    for (double p : partial) energy += p;
+    *potentialEnergy = 0.5 * energy;
+}
+
+void ParticleMesh::computeAccelerations(BodyStore& bodies, const std::vector<size_t>& targets,
+                                        ThreadPool* pool) const {
+    PROFILE_SCOPE("mesh interpolation");
+    run(pool, targets.size(), 4096, [this, &bodies, &targets](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            const glm::dvec3 acceleration = fieldAt(bodies.getPosition(targets[k]));
+            bodies.ax[targets[k]] = acceleration.x;
+            bodies.ay[targets[k]] = acceleration.y;
+            bodies.az[targets[k]] = acceleration.z;
+        }
+    });
+}
@@ -0,0 +1,138 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+
+#ifndef GRAVITY_PARTICLEMESH_H
+#define GRAVITY_PARTICLEMESH_H
+#pragma once
+#include <complex>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "BodyStore.h"
+#include "ThreadPool.h"
+
+// How mass is spread onto the mesh and forces are read back from it. The
+// same kernel is used both ways, so a body exerts no force on itself.
+enum class MassAssignment {
+    CloudInCell,           // Linear in each axis, 8 mesh points per body
+    TriangularShapedCloud  // Quadratic in each axis, 27 mesh points per body; smoother forces
+};
+
+// Particle-mesh gravity. Masses are deposited on a cubic mesh, Poisson's
+// equation is solved by convolving with the Green's function of an isolated
+// system (zero padding to twice the mesh size, so there are no periodic
+// images), and the field is the finite-difference gradient of the potential.
+// A solve costs O(N + G log G) for G mesh points.
+//
+// Forces are smoothed over a couple of mesh cells, so one mesh around every
+// body would let a few distant bodies or one dominant mass ruin the forces
+// of a concentrated system. Instead:
+// - bodies of at least HEAVY_FRACTION of the total mass, at most MAX_DIRECT
+//   of them, stay off the mesh and pull every body directly, softened like
+//   the other solvers;
+// - the mesh covers the cube around the centre of mass that holds
+//   CORE_FRACTION of the other bodies, and the bodies outside it go on a
+//   second mesh of half the side around all of them. Every body feels both
+//   meshes; outside the core mesh, its mass pulls as a point at its centre
+//   of mass. When the outer bodies would not even double the side, there is
+//   only the one mesh.
+// After a solve, the field and potential can be read anywhere in O(1 + D)
+// for D direct bodies.
+//
+// The mesh side n is a power of two between MIN_SIZE and MAX_SIZE. The
+// padded work area dominates the memory: about 224 n^3 bytes, 60 MB at the
+// default of 64 and 470 MB at 128, and an eighth more with an outer mesh.
+class ParticleMesh {
+public:
+    static const size_t MIN_SIZE = 8;
+    static const size_t MAX_SIZE = 256;
+    static constexpr double HEAVY_FRACTION = 0.01;
+    static const size_t MAX_DIRECT = 16;
+    static constexpr double CORE_FRACTION = 0.9;
+
+    explicit ParticleMesh(size_t size = 64, MassAssignment assignment = MassAssignment::TriangularShapedCloud);
+
+    void solve(const BodyStore& bodies, ThreadPool* pool = nullptr);
+    void solve(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses,
+               ThreadPool* pool = nullptr);
+
+    // Overwrites ax/ay/az with the field of the last solve, which must have
+    // been for these bodies. With potentialEnergy, the total potential energy
+    // (J) is read from the same mesh, less each body's interaction with its
+    // own smoothed mass, and stored there.
+    void computeAccelerations(BodyStore& bodies, ThreadPool* pool = nullptr, double* potentialEnergy = nullptr) const;
+    void computeAccelerations(BodyStore& bodies, const std::vector<size_t>& targets, ThreadPool* pool = nullptr) const;
+
+    // Gravitational acceleration (m/s^2) and potential (J/kg) at a point
+    glm::dvec3 fieldAt(const glm::dvec3& position) const;
+    double potentialAt(const glm::dvec3& position) const;
+
+    // Rounded up to a power of two and clamped to [MIN_SIZE, MAX_SIZE]
+    void setSize(size_t size);
+    size_t getSize() const { return size; }
+    void setAssignment(MassAssignment scheme) { assignment = scheme; }
+    MassAssignment getAssignment() const { return assignment; }
+    // Position of mesh point (0, 0, 0) and the spacing of the core mesh, from the last solve
+    glm::dvec3 getOrigin() const { return origin; }
+    double getCellSize() const { return cellSize; }
+
+private:
+    // Mesh points and weights of the assignment kernel along one axis
+    struct Stencil {
+        int first;
+        int count;
+        double weight[3];
+    };
+
+    // Where a body of the last solve was put
+    enum Placement : uint8_t {
+        CoreMesh,
+        OuterMesh,
+        Direct
+    };
+
+    template <typename Position>
+    void solve(size_t count, Position position, const double* masses, ThreadPool* pool);
+    // This mesh alone, around the given bodies
+    template <typename Position>
+    void solveMesh(size_t count, Position position, const double* masses, ThreadPool* pool);
+    template <typename Position>
+    void deposit(size_t count, Position position, const double* masses, ThreadPool* pool);
+    void convolve(ThreadPool* pool);
+    void differentiate(ThreadPool* pool);
+    void prepareGreen(ThreadPool* pool);
+    void transform(std::complex<double>* data, bool inverse) const;
+    void transformLines(int axis, size_t firstLimit, size_t secondLimit, bool inverse, ThreadPool* pool);
+    Stencil stencil(double u) const;
+    bool inside(const glm::dvec3& u) const;
+    glm::dvec3 interpolateField(const glm::dvec3& position) const;
+    // This mesh alone, or the point mass of its bodies outside it
+    glm::dvec3 meshFieldAt(const glm::dvec3& position) const;
+    double meshPotentialAt(const glm::dvec3& position) const;
+    double selfPotential(const glm::dvec3& u) const;
+    // Potential (J/kg) a body deposited on this mesh feels from its own smoothed mass
+    double meshSelfPotential(const glm::dvec3& position, double mass) const;
+
+    size_t size;
+    MassAssignment assignment;
+    glm::dvec3 origin{0.0};
+    double cellSize = 1.0;
+    double totalMass = 0.0;
+    glm::dvec3 centerOfMass{0.0};
+
+    std::vector<double> potential;   // size^3, x fastest
+    std::vector<double> field[3];    // size^3, -grad potential
+    std::vector<std::complex<double>> padded;  // (2 size)^3 work area for the convolution
+    std::vector<double> green;       // Transform of the Green's function for unit spacing, already normalised
+    std::vector<std::complex<double>> twiddles;
+    std::vector<size_t> reversed;    // Bit reversal permutation of 2 size points
+
+    std::unique_ptr<ParticleMesh> outer;  // Bodies outside the core, when outerUsed
+    bool outerUsed = false;
+    std::vector<glm::dvec3> directPositions;
+    std::vector<double> directMasses;
+    std::vector<uint8_t> placement;       // Per body of the last solve
+};
+#endif //GRAVITY_PARTICLEMESH_H
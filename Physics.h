@@ -0,0 +1,191 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+
+#ifndef GRAVITY_PHYSICS_H
+#define GRAVITY_PHYSICS_H
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+// Gravitational constant (m^3 kg^-1 s^-2), shared by every solver and generator
+constexpr double G = 6.67430e-11;
+
+// Length below which the force stops following Newton's law (m)
+constexpr double SOFTENING_LENGTH = 1e9;
+
+// Arithmetic the softening policies are written against. The force kernels
+// supply SIMD types with the same members, so one definition of each policy
+// serves both.
+template<typename T>
+struct ScalarMath {
+    using V = T;
+    using Mask = bool;
+
+    static V set(double value) { return static_cast<T>(value); }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+    static V div(V a, V b) { return a / b; }
+    static V fmadd(V a, V b, V c) { return a * b + c; }
+    static V sqrt(V a) { return std::sqrt(a); }
+    static V max(V a, V b) { return std::max(a, b); }
+    static V min(V a, V b) { return std::min(a, b); }
+    static Mask less(V a, V b) { return a < b; }
+    static V select(Mask mask, V a, V b) { return mask ? a : b; }
+};
+
+// Softening policies. Each works in units of the softening length: scale(r2)
+// takes the squared separation and returns s such that a body of mass m at
+// offset d pulls with acceleration G m d s. Unsoftened, s = r^-3.
+// potential(r2) is the matching potential per G m, -1/r unsoftened.
+// NEWTONIAN_RANGE is the separation beyond which s is (close to) Newton's.
+
+// The original hard limit: the force is held at its value at r = 1 inside
+// that distance. Cheap, but the force has a kink and the potential is not
+// smooth there.
+struct ClampSoftening {
+    static constexpr double NEWTONIAN_RANGE = 1.0;
+
+    template<typename M>
+    static typename M::V scale(typename M::V r2) {
+        const auto r = M::sqrt(r2);
+        const auto clamped = M::max(r, M::set(1.0));
+        // Keeps coincident bodies at zero force instead of NaN
+        const auto tiny = M::set(1e-30);
+        return M::div(M::set(1.0), M::mul(M::max(r, tiny), M::mul(clamped, clamped)));
+    }
+
+    // Inside r = 1 the force is constant, so the potential is linear
+    template<typename M>
+    static typename M::V potential(typename M::V r2) {
+        const auto r = M::sqrt(r2);
+        return M::select(M::less(r, M::set(1.0)), M::sub(r, M::set(2.0)),
+                         M::div(M::set(-1.0), M::max(r, M::set(1.0))));
+    }
+};
+
+// Plummer's potential -G m / sqrt(r^2 + 1). Smooth everywhere, but never
+// exactly Newtonian; the force is within 1.5% of it beyond 10 lengths.
+struct PlummerSoftening {
+    static constexpr double NEWTONIAN_RANGE = 10.0;
+
+    template<typename M>
+    static typename M::V scale(typename M::V r2) {
+        const auto q = M::add(r2, M::set(1.0));
+        return M::div(M::set(1.0), M::mul(q, M::sqrt(q)));
+    }
+
+    template<typename M>
+    static typename M::V potential(typename M::V r2) {
+        return M::div(M::set(-1.0), M::sqrt(M::add(r2, M::set(1.0))));
+    }
+};
+
+// The cubic spline kernel of Monaghan and Lattanzio, as in GADGET. The
+// support h = 2.8 gives the same central potential as Plummer softening, and
+// the force is exactly Newtonian beyond h.
+struct SplineSoftening {
+    static constexpr double NEWTONIAN_RANGE = 2.8;
+
+    template<typename M>
+    static typename M::V scale(typename M::V r2) {
+        constexpr double h = NEWTONIAN_RANGE;
+        const auto r = M::max(M::sqrt(r2), M::set(1e-30));
+        const auto inverse = M::div(M::set(1.0), r);
+        const auto inverseCube = M::mul(inverse, M::mul(inverse, inverse));
+        const auto u = M::mul(r, M::set(1.0 / h));
+        const auto u2 = M::mul(u, u);
+        // u < 1/2: (32/3 + u^2 (32 u - 38.4)) / h^3
+        const auto inner = M::mul(M::fmadd(u2, M::fmadd(u, M::set(32.0), M::set(-38.4)), M::set(32.0 / 3.0)),
+                                  M::set(1.0 / (h * h * h)));
+        // 1/2 <= u < 1: (64/3 - 48 u + 38.4 u^2 - 32/3 u^3) / h^3 - 1 / (15 r^3)
+        const auto polynomial = M::fmadd(u, M::fmadd(u, M::fmadd(u, M::set(-32.0 / 3.0), M::set(38.4)),
+                                                     M::set(-48.0)),
+                                         M::set(64.0 / 3.0));
+        const auto outer = M::fmadd(polynomial, M::set(1.0 / (h * h * h)), M::mul(inverseCube, M::set(-1.0 / 15.0)));
+        return M::select(M::less(u, M::set(0.5)), inner,
+                         M::select(M::less(u, M::set(1.0)), outer, inverseCube));
+    }
+
+    template<typename M>
+    static typename M::V potential(typename M::V r2) {
+        constexpr double h = NEWTONIAN_RANGE;
+        const auto r = M::max(M::sqrt(r2), M::set(1e-30));
+        const auto u = M::mul(r, M::set(1.0 / h));
+        const auto u2 = M::mul(u, u);
+        // u < 1/2: (-2.8 + u^2 (16/3 + u^2 (6.4 u - 9.6))) / h
+        const auto inner = M::fmadd(u2, M::fmadd(u2, M::fmadd(u, M::set(6.4), M::set(-9.6)), M::set(16.0 / 3.0)),
+                                    M::set(-2.8));
+        // 1/2 <= u < 1: (-3.2 + 1 / (15 u) + u^2 (32/3 + u (-16 + u (9.6 - 32/15 u)))) / h
+        const auto polynomial = M::fmadd(u, M::fmadd(u, M::fmadd(u, M::set(-32.0 / 15.0), M::set(9.6)),
+                                                     M::set(-16.0)),
+                                         M::set(32.0 / 3.0));
+        const auto outer = M::add(M::fmadd(u2, polynomial, M::set(-3.2)),
+                                  M::div(M::set(1.0 / 15.0), M::max(u, M::set(0.5))));
+        return M::select(M::less(u, M::set(1.0)),
+                         M::mul(M::select(M::less(u, M::set(0.5)), inner, outer), M::set(1.0 / h)),
+                         M::div(M::set(-1.0), r));
+    }
+};
+
+// Precision policies for direct summation. Positions are what separations
+// are taken from; pair terms (distance, softening, the force factor) are
+// computed in Pair; each body's acceleration is summed in Accumulator.
+// Floats double the SIMD width. Their range limits the kernels to
+// separations below about 1e12 softening lengths.
+struct DoublePrecision {
+    using Position = double;
+    using Pair = double;
+    using Accumulator = double;
+};
+
+// Separations in double, so nearby bodies far from the origin keep their
+// detail, with float pair terms
+struct MixedPrecision {
+    using Position = double;
+    using Pair = float;
+    using Accumulator = double;
+};
+
+struct FloatPrecision {
+    using Position = float;
+    using Pair = float;
+    using Accumulator = float;
+};
+
+// The policies the simulator is built with, chosen by the GRAVITY_PRECISION
+// and GRAVITY_SOFTENING CMake options
+#if defined(GRAVITY_PRECISION_FLOAT)
+using ForcePrecision = FloatPrecision;
+#elif defined(GRAVITY_PRECISION_MIXED)
+using ForcePrecision = MixedPrecision;
+#else
+using ForcePrecision = DoublePrecision;
+#endif
+
+#if defined(GRAVITY_SOFTENING_PLUMMER)
+using ForceSoftening = PlummerSoftening;
+#elif defined(GRAVITY_SOFTENING_SPLINE)
+using ForceSoftening = SplineSoftening;
+#else
+using ForceSoftening = ClampSoftening;
+#endif
+
+// Softened r^-3 for a separation r in metres, for the tree solvers and
+// single pairs: a body of mass m at offset d pulls with G m d * this
+inline double softenedInverseCube(double r2) {
+    constexpr double unit = 1.0 / SOFTENING_LENGTH;
+    return ForceSoftening::scale<ScalarMath<double>>(r2 * (unit * unit)) * (unit * unit * unit);
+}
+
+// The matching potential per G m (1/m), -1/r unsoftened
+inline double softenedPotential(double r2) {
+    constexpr double unit = 1.0 / SOFTENING_LENGTH;
+    return ForceSoftening::potential<ScalarMath<double>>(r2 * (unit * unit)) * unit;
+}
+
+// Separations beyond which softenedInverseCube is Newton's r^-3 (m)
+constexpr double NEWTONIAN_DISTANCE = ForceSoftening::NEWTONIAN_RANGE * SOFTENING_LENGTH;
+
+#endif //GRAVITY_PHYSICS_H
@@ -0,0 +1,263 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    const size_t COUNTERS = static_cast<size_t>(Counter::Count);
+    const char* const COUNTER_NAMES[COUNTERS] = {"pair interactions", "collision tests", "merges",
+                                                 "softened terms", "culled bodies", "body vertices"};
+
+    struct Stat {
+        const char* name;
+        uint64_t calls = 0;
+        uint64_t total = 0;
+        uint64_t max = 0;
+    };
+
+    struct Event {
+        const char* name;
+        uint64_t start;
+        uint64_t duration;
+    };
+
+    struct CounterSample {
+        uint64_t time;
+        uint64_t totals[COUNTERS];
+    };
+
+    struct ThreadLog {
+        std::mutex mutex;
+        size_t index = 0;
+        std::string name;
+        std::vector<Stat> stats;
+        std::vector<Event> events;
+        uint64_t droppedEvents = 0;
+        std::atomic<uint64_t> counters[COUNTERS] = {};  // Only written by the owning thread
+    };
+
+    struct Registry {
+        const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ThreadLog>> logs;
+        std::atomic<bool> tracing{false};
+        std::atomic<size_t> maxEvents{size_t(1) << 20};
+        std::vector<CounterSample> samples;
+        uint64_t windowStart = 0;
+        uint64_t reported[COUNTERS] = {};  // Counter totals at the previous summary
+    };
+
+    Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    // The log outlives its thread, the registry keeps a reference for reporting
+    ThreadLog& threadLog() {
+        thread_local std::shared_ptr<ThreadLog> log = [] {
+            auto created = std::make_shared<ThreadLog>();
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            created->index = r.logs.size();
+            r.logs.push_back(created);
+            return created;
+        }();
+        return *log;
+    }
+
+    // Call with the registry mutex held
+    void counterTotals(const Registry& r, uint64_t totals[COUNTERS]) {
+        std::fill(totals, totals + COUNTERS, 0);
+        for (const auto& log : r.logs) {
+            for (size_t c = 0; c < COUNTERS; ++c) {
+                totals[c] += log->counters[c].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::string escapeJson(const std::string& text) {
+        std::string result;
+        for (char c : text) {
+            if (c == '"' || c == '\\') result += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20) result += c;
+        }
+        return result;
+    }
+}
+
+uint64_t Profiler::now() {
+    auto elapsed = std::chrono::steady_clock::now() - registry().epoch;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+void Profiler::record(const char* name, uint64_t start, uint64_t end) {
+    ThreadLog& log = threadLog();
+    const uint64_t duration = end - start;
+    std::lock_guard<std::mutex> lock(log.mutex);
+    auto stat = std::find_if(log.stats.begin(), log.stats.end(), [name](const Stat& s) { return s.name == name; });
+    if (stat == log.stats.end()) {
+        log.stats.push_back(Stat{name});
+        stat = log.stats.end() - 1;
+    }
+    ++stat->calls;
+    stat->total += duration;
+    stat->max = std::max(stat->max, duration);
+
+    Registry& r = registry();
+    if (r.tracing.load(std::memory_order_relaxed)) {
+        if (log.events.size() < r.maxEvents.load(std::memory_order_relaxed)) {
+            log.events.push_back(Event{name, start, duration});
+        } else {
+            ++log.droppedEvents;
+        }
+    }
+}
+
+void Profiler::count(Counter counter, uint64_t amount) {
+    std::atomic<uint64_t>& slot = threadLog().counters[static_cast<size_t>(counter)];
+    slot.store(slot.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+void Profiler::sampleCounters() {
+    Registry& r = registry();
+    if (!r.tracing.load(std::memory_order_relaxed)) return;
+    CounterSample sample;
+    sample.time = now();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    counterTotals(r, sample.totals);
+    if (r.samples.size() < r.maxEvents.load(std::memory_order_relaxed)) {
+        r.samples.push_back(sample);
+    }
+}
+
+void Profiler::setTracing(bool enabled, size_t maxEvents) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (enabled) {
+        for (const auto& log : r.logs) {
+            std::lock_guard<std::mutex> logLock(log->mutex);
+            log->events.clear();
+            log->droppedEvents = 0;
+        }
+        r.samples.clear();
+        r.maxEvents = maxEvents;
+    }
+    r.tracing = enabled;
+}
+
+void Profiler::setThreadName(const std::string& name) {
+    ThreadLog& log = threadLog();
+    std::lock_guard<std::mutex> lock(log.mutex);
+    log.name = name;
+}
+
+void Profiler::writeChromeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Failed to open " + path + " for writing");
+    }
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separator = [&out, &first]() -> std::ostream& {
+        out << (first ? "" : ",\n");
+        first = false;
+        return out;
+    };
+
+    uint64_t dropped = 0;
+    for (const auto& log : r.logs) {
+        std::lock_guard<std::mutex> logLock(log->mutex);
+        const size_t tid = log->index + 1;
+        std::string name = log->name.empty() ? "thread " + std::to_string(tid) : log->name;
+        separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+                    << ",\"args\":{\"name\":\"" << escapeJson(name) << "\"}}";
+        for (const Event& event : log->events) {
+            separator() << "{\"name\":\"" << escapeJson(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                        << ",\"ts\":" << event.start / 1e3 << ",\"dur\":" << event.duration / 1e3 << "}";
+        }
+        dropped += log->droppedEvents;
+    }
+
+    // Each sample shows what was counted since the one before
+    for (size_t k = 1; k < r.samples.size(); ++k) {
+        const CounterSample& sample = r.samples[k];
+        for (size_t c = 0; c < COUNTERS; ++c) {
+            separator() << "{\"name\":\"" << COUNTER_NAMES[c] << "\",\"ph\":\"C\",\"pid\":1,\"ts\":"
+                        << sample.time / 1e3 << ",\"args\":{\"count\":"
+                        << sample.totals[c] - r.samples[k - 1].totals[c] << "}}";
+        }
+    }
+    out << "\n],\"otherData\":{\"droppedEvents\":" << dropped << "}}\n";
+    if (!out) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+void Profiler::printSummary(std::ostream& out) {
+    Registry& r = registry();
+    std::vector<Stat> merged;
+    uint64_t totals[COUNTERS];
+    const uint64_t end = now();
+    uint64_t window;
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (const auto& log : r.logs) {
+            std::lock_guard<std::mutex> logLock(log->mutex);
+            for (const Stat& stat : log->stats) {
+                // The same literal can have a different address in each translation unit
+                auto it = std::find_if(merged.begin(), merged.end(), [&stat](const Stat& s) {
+                    return std::strcmp(s.name, stat.name) == 0;
+                });
+                if (it == merged.end()) {
+                    merged.push_back(Stat{stat.name});
+                    it = merged.end() - 1;
+                }
+                it->calls += stat.calls;
+                it->total += stat.total;
+                it->max = std::max(it->max, stat.max);
+            }
+            log->stats.clear();
+        }
+        counterTotals(r, totals);
+        window = end - r.windowStart;
+        r.windowStart = end;
+        for (size_t c = 0; c < COUNTERS; ++c) {
+            std::swap(totals[c], r.reported[c]);
+            totals[c] = r.reported[c] - totals[c];
+        }
+    }
+    std::sort(merged.begin(), merged.end(), [](const Stat& a, const Stat& b) { return a.total > b.total; });
+
+    const double seconds = window / 1e9;
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed << std::setprecision(3) << "Profile over the last " << seconds << " s:\n"
+        << std::left << std::setw(28) << "  scope" << std::right << std::setw(10) << "calls" << std::setw(12)
+        << "total ms" << std::setw(12) << "mean ms" << std::setw(12) << "max ms" << std::setw(9) << "wall%" << "\n";
+    for (const Stat& stat : merged) {
+        out << "  " << std::left << std::setw(26) << stat.name << std::right << std::setw(10) << stat.calls
+            << std::setw(12) << stat.total / 1e6 << std::setw(12) << stat.total / 1e6 / stat.calls
+            << std::setw(12) << stat.max / 1e6 << std::setw(8) << std::setprecision(1)
+            << (window > 0 ? 100.0 * stat.total / window : 0.0) << "%" << std::setprecision(3) << "\n";
+    }
+    out << std::setprecision(0);
+    for (size_t c = 0; c < COUNTERS; ++c) {
+        out << "  " << std::left << std::setw(26) << COUNTER_NAMES[c] << std::right << std::setw(22)
+            << totals[c] << std::setw(16) << (seconds > 0.0 ? totals[c] / seconds : 0.0) << "/s\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+    out.flush();
+}
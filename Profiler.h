@@ -0,0 +1,86 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+
+#ifndef GRAVITY_PROFILER_H
+#define GRAVITY_PROFILER_H
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Events counted by the hot paths. Each thread counts into its own slots, so
+// counting never contends.
+enum class Counter {
+    PairInteractions,   // Force terms: each pair once for direct summation, each body-body or body-cell term for
+                        // Barnes-Hut, each body pair or cell-cell translation for the multipole solver
+    CollisionTests,     // Pairs the sweep hands to the exact overlap test
+    Merges,             // Bodies absorbed by collisions
+    SoftenedTerms,      // Force terms closer than the softening policy's Newtonian range
+    CulledBodies,       // Bodies outside the view frustum, not drawn
+    BodyVertices,       // Vertices submitted to draw the visible bodies
+    Count
+};
+
+// Phase timers and counters for finding out where a step or a frame goes.
+// Instrumentation is compiled in only when GRAVITY_PROFILE is defined (the
+// CMake option of the same name); otherwise PROFILE_SCOPE and PROFILE_COUNT
+// expand to nothing and cost nothing.
+//
+// Each thread keeps its own totals and trace buffer behind a mutex that only
+// the reporting side contends for. Timers belong around phases, not inner
+// loops: a scope costs two clock reads and an uncontended lock.
+class Profiler {
+public:
+#ifdef GRAVITY_PROFILE
+    static constexpr bool ENABLED = true;
+#else
+    static constexpr bool ENABLED = false;
+#endif
+
+    // Nanoseconds on a steady clock, counted from the first use of the profiler
+    static uint64_t now();
+    static void record(const char* name, uint64_t start, uint64_t end);
+    static void count(Counter counter, uint64_t amount);
+    // Adds the current counter totals to the trace as a sample
+    static void sampleCounters();
+
+    // Keeps every scope from now on for writeChromeTrace, up to maxEvents per
+    // thread; later ones are dropped and counted
+    static void setTracing(bool enabled, size_t maxEvents = size_t(1) << 20);
+    // Names the calling thread in the trace
+    static void setThreadName(const std::string& name);
+    // Writes the kept scopes and counter samples in the Chrome trace event
+    // format, for chrome://tracing or Perfetto. Throws std::runtime_error on failure.
+    static void writeChromeTrace(const std::string& path);
+    // Prints calls, total, mean and maximum time per scope and the counter
+    // totals since the previous summary, then starts a new window
+    static void printSummary(std::ostream& out);
+};
+
+// Times the enclosing scope under name, which must be a string literal
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char* name) : name(name), start(Profiler::now()) {}
+    ~ScopedTimer() { Profiler::record(name, start, Profiler::now()); }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#ifdef GRAVITY_PROFILE
+#define PROFILE_SCOPE(name) ScopedTimer PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_COUNT(counter, amount) Profiler::count(Counter::counter, (amount))
+#define PROFILE_SAMPLE_COUNTERS() Profiler::sampleCounters()
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_COUNT(counter, amount) ((void)0)
+#define PROFILE_SAMPLE_COUNTERS() ((void)0)
+#endif
+
+#endif //GRAVITY_PROFILER_H
@@ -2,12 +2,204 @@
 // Created by Quinta on 7/12/2024.
 //
 #include "Renderer.h"
+#include "Profiler.h"
+#include "Shader.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
 #include <vector>
 #include <cmath>
+#include <limits>
 #include <stdexcept>
 
+namespace {
+    const float FIELD_OF_VIEW = 45.0f;  // Degrees, vertical
+    const float NEAR_PLANE = 1e8f;
+    const float FAR_PLANE = 1e14f;
+    const float MIN_SCALE = 5e9f;   // Minimum scale to ensure visibility
+    const float MAX_SCALE = 5e10f;  // Maximum scale to prevent overly large objects
+    // Pixels. Sprites are only used for very large N, where full-size spheres
+    // would cover the screen many times over and hide the structure anyway
+    const float MAX_SPRITE_SIZE = 8.0f;
+    // Sectors of each sphere mesh, with half as many stacks; see Renderer::sphereMeshes
+    const int MESH_SECTORS[] = {16, 32, 64, 128};
+
+    const double GRID_SIZE = 5e13;      // Side of the grid, centred on the origin
+    const size_t GRID_RESOLUTION = 321; // Field points a side
+    const size_t GRID_LINE_STEP = 4;    // Field points between drawn lines, for 80 squares a side
+    const float GRID_GREY = 0.2f;
+    // How far the sheet sinks at the deepest point of the potential
+    const float SHEET_DEPTH = 6e11f;
+    // Field strengths this many decades below the strongest fade to nothing
+    const float FIELD_DECADES = 4.0f;
+
+    // Colours of the solar system scenario, which adds its bodies in this
+    // order. Bodies are looked up by stable id so sorting never repaints them.
+    const glm::vec3 PALETTE[] = {
+        {1.0f, 1.0f, 0.0f},  // Sun: Yellow
+        {0.5f, 0.5f, 0.5f},  // Mercury: Gray
+        {0.9f, 0.7f, 0.4f},  // Venus: Light Orange
+        {0.0f, 0.5f, 1.0f},  // Earth: Blue
+        {1.0f, 0.0f, 0.0f},  // Mars: Red
+        {0.8f, 0.6f, 0.2f},  // Jupiter: Light Brown
+        {0.9f, 0.9f, 0.7f},  // Saturn: Light Yellow
+        {0.0f, 0.5f, 0.5f},  // Uranus: Cyan
+        {0.0f, 0.0f, 1.0f},  // Neptune: Dark Blue
+        {0.5f, 0.5f, 0.5f},  // Pluto: Gray
+    };
+    const glm::vec3 DEFAULT_COLOUR(1.0f, 1.0f, 1.0f);  // White for any additional bodies
+
+    glm::vec3 bodyColour(uint64_t id) {
+        return id < sizeof(PALETTE) / sizeof(PALETTE[0]) ? PALETTE[id] : DEFAULT_COLOUR;
+    }
+
+    uint32_t packColour(const glm::vec3& colour, float alpha = 1.0f) {
+        auto channel = [](float c) { return static_cast<uint32_t>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f); };
+        return channel(colour.x) | channel(colour.y) << 8 | channel(colour.z) << 16 | channel(alpha) << 24;
+    }
+
+    // 0 to 1 over the top FIELD_DECADES of field strength
+    float fieldLevel(float strength, float maxStrength) {
+        if (!(strength > 0.0f) || !(maxStrength > 0.0f)) return 0.0f;
+        return std::clamp(1.0f + std::log10(strength / maxStrength) / FIELD_DECADES, 0.0f, 1.0f);
+    }
+
+    // Dark blue through red to yellow
+    glm::vec3 heatColour(float level) {
+        return {std::min(1.0f, 2.0f * level), std::max(0.0f, 2.0f * level - 1.0f), 0.4f * (1.0f - level)};
+    }
+
+    // Scale is interpolated between MIN_SCALE and MAX_SCALE by log10 of the mass
+    float bodyScale(double mass, double logMinMass, double logRange) {
+        double normalizedLogMass = logRange > 0.0 ? (std::log10(mass) - logMinMass) / logRange : 0.0;
+        return MIN_SCALE + static_cast<float>(normalizedLogMass) * (MAX_SCALE - MIN_SCALE);
+    }
+
+    const char* SPHERE_VERTEX_SHADER = R"(#version 330 core
+layout(location = 0) in vec3 vertex;
+layout(location = 1) in vec3 position;
+layout(location = 2) in float radius;
+layout(location = 3) in vec4 colour;
+uniform mat4 viewProjection;
+out vec4 bodyColour;
+void main() {
+    gl_Position = viewProjection * vec4(position + vertex * radius, 1.0);
+    bodyColour = colour;
+}
+)";
+
+    // Point sprites sized to the sphere's projected diameter, between one pixel and maxPointSize
+    const char* SPRITE_VERTEX_SHADER = R"(#version 330 core
+layout(location = 1) in vec3 position;
+layout(location = 2) in float radius;
+layout(location = 3) in vec4 colour;
+uniform mat4 viewProjection;
+uniform float pixelsPerUnit;
+uniform float maxPointSize;
+out vec4 bodyColour;
+void main() {
+    gl_Position = viewProjection * vec4(position, 1.0);
+    gl_PointSize = clamp(2.0 * radius * pixelsPerUnit / gl_Position.w, 1.0, maxPointSize);
+    bodyColour = colour;
+}
+)";
+
+    // Impostors: a camera-facing quad in view space, just large enough to
+    // cover the sphere's silhouette, which up close is wider than the radius.
+    // The margin covers the stretch of spheres away from the view axis.
+    const char* IMPOSTOR_VERTEX_SHADER = R"(#version 330 core
+layout(location = 0) in vec2 corner;
+layout(location = 1) in vec3 position;
+layout(location = 2) in float radius;
+layout(location = 3) in vec4 colour;
+uniform mat4 view;
+uniform mat4 projection;
+out vec3 viewPoint;
+flat out vec3 viewCenter;
+flat out float sphereRadius;
+flat out vec4 bodyColour;
+void main() {
+    vec3 center = (view * vec4(position, 1.0)).xyz;
+    float distance2 = dot(center, center);
+    float halfSize = 1.25 * radius * sqrt(distance2 / max(distance2 - radius * radius, 1e-6 * distance2));
+    viewPoint = center + vec3(corner * halfSize, 0.0);
+    viewCenter = center;
+    sphereRadius = radius;
+    bodyColour = colour;
+    gl_Position = projection * vec4(viewPoint, 1.0);
+}
+)";
+
+    // Casts the eye ray through the fragment at the sphere and writes the
+    // depth of the hit, so impostors intersect meshes and each other
+    // correctly. The miss test uses the ray's distance from the centre rather
+    // than b^2 - c, which would cancel to nothing for small, distant spheres.
+    const char* IMPOSTOR_FRAGMENT_SHADER = R"(#version 330 core
+in vec3 viewPoint;
+flat in vec3 viewCenter;
+flat in float sphereRadius;
+flat in vec4 bodyColour;
+uniform mat4 projection;
+out vec4 fragColour;
+void main() {
+    vec3 direction = normalize(viewPoint);
+    float along = dot(direction, viewCenter);
+    vec3 offset = viewCenter - along * direction;
+    float discriminant = sphereRadius * sphereRadius - dot(offset, offset);
+    if (discriminant < 0.0) discard;
+    vec4 clip = projection * vec4(direction * (along - sqrt(discriminant)), 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+    fragColour = bodyColour;
+}
+)";
+
+    const char* SPHERE_FRAGMENT_SHADER = R"(#version 330 core
+in vec4 bodyColour;
+out vec4 fragColour;
+void main() {
+    fragColour = bodyColour;
+}
+)";
+
+    const char* SPRITE_FRAGMENT_SHADER = R"(#version 330 core
+in vec4 bodyColour;
+out vec4 fragColour;
+void main() {
+    vec2 offset = gl_PointCoord * 2.0 - 1.0;
+    if (dot(offset, offset) > 1.0) discard;
+    fragColour = bodyColour;
+}
+)";
+}
+
 Renderer::Renderer(int width, int height)
-        : cameraPos(3e11f, 2e11f, 3e11f),
+        : window(nullptr),
+          width(width),
+          height(height),
+          instancing(false),
+          sphereProgram(0),
+          spriteProgram(0),
+          impostorProgram(0),
+          instanceVBO(0),
+          spriteVAO(0),
+          impostorVAO(0),
+          quadVBO(0),
+          instanceCapacity(0),
+          spriteThreshold(10000),
+          levelStart(),
+          trajectorySequence(0),
+          fieldGrid(GRID_SIZE, GRID_RESOLUTION),
+          gridStyle(GridStyle::Sheet),
+          gridSequence(0),
+          gridStale(true),
+          gridVBO(0),
+          gridLineEBO(0),
+          gridFillEBO(0),
+          gridLineIndexCount(0),
+          gridFillIndexCount(0),
+          cameraPos(3e11f, 2e11f, 3e11f),
           cameraFront(glm::normalize(glm::vec3(0.0f) - glm::vec3(3e11f, 2e11f, 3e11f))),
           cameraUp(0.0f, 1.0f, 0.0f),
           cameraSpeed(1e9f),
@@ -39,7 +231,17 @@ Renderer::Renderer(int width, int height)
     glDisable(GL_LIGHT0);
     glEnable(GL_COLOR_MATERIAL);
 
-    createSphereMesh(1.0f, 20, 20);
+    for (size_t k = 0; k < std::size(MESH_SECTORS); ++k) {
+        sphereMeshes[k] = createSphereMesh(MESH_SECTORS[k], MESH_SECTORS[k] / 2);
+    }
+    if (GLEW_VERSION_3_3) {
+        createBodyPipeline();
+    }
+    createGrid();
+    if (TrajectoryBuffer::isSupported()) {
+        trajectoryBuffer = std::make_unique<TrajectoryBuffer>();
+        trajectoryBuffer->initialize();
+    }
 
     // Set up camera
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
@@ -49,20 +251,39 @@ Renderer::Renderer(int width, int height)
 }
 
 Renderer::~Renderer() {
-    glDeleteVertexArrays(1, &sphereVAO);
-    glDeleteBuffers(1, &sphereVBO);
-    glDeleteBuffers(1, &sphereEBO);
+    trajectoryBuffer.reset();
+    if (instancing) {
+        glDeleteVertexArrays(1, &spriteVAO);
+        glDeleteVertexArrays(1, &impostorVAO);
+        glDeleteBuffers(1, &instanceVBO);
+        glDeleteBuffers(1, &quadVBO);
+        glDeleteProgram(sphereProgram);
+        glDeleteProgram(spriteProgram);
+        glDeleteProgram(impostorProgram);
+    }
+    for (SphereMesh& mesh : sphereMeshes) {
+        if (instancing) {
+            glDeleteVertexArrays(1, &mesh.instanceVAO);
+        }
+        glDeleteVertexArrays(1, &mesh.vao);
+        glDeleteBuffers(1, &mesh.vbo);
+        glDeleteBuffers(1, &mesh.ebo);
+    }
+    glDeleteBuffers(1, &gridVBO);
+    glDeleteBuffers(1, &gridLineEBO);
+    glDeleteBuffers(1, &gridFillEBO);
     glfwDestroyWindow(window);
     glfwTerminate();
 }
 
-void Renderer::render(const Simulator& simulator) {
+void Renderer::render(const Snapshot& snapshot) {
+    PROFILE_SCOPE("Renderer::render");
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glClearColor(0.0f, 0.0f, 0.1f, 1.0f);
 
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
-    gluPerspective(45.0, 1600.0 / 1200.0, 1e8, 1e14);
+    gluPerspective(FIELD_OF_VIEW, static_cast<double>(width) / height, NEAR_PLANE, FAR_PLANE);
 
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
@@ -70,26 +291,58 @@ void Renderer::render(const Simulator& simulator) {
     gluLookAt(cameraPos.x, cameraPos.y, cameraPos.z,
               center.x, center.y, center.z,
               cameraUp.x, cameraUp.y, cameraUp.z);
-    drawGrid(simulator);
+    drawGrid(snapshot);
 
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    drawTrajectories(simulator.getBodies());
+    if (trajectoryBuffer) {
+        PROFILE_SCOPE("drawTrajectories");
+        // Only a new simulation state adds a point to the trails
+        if (snapshot.sequence != trajectorySequence) {
+            trajectoryBuffer->append(snapshot);
+            trajectorySequence = snapshot.sequence;
+        }
+        trajectoryBuffer->draw(viewProjection());
+    } else {
+        drawTrajectories(snapshot);
+    }
     glDisable(GL_BLEND);
 
-    const auto& bodies = simulator.getBodies();
+    drawBodies(snapshot);
+}
+
+glm::mat4 Renderer::viewMatrix() const {
+    return glm::lookAt(cameraPos, glm::vec3(0.0f), cameraUp);
+}
+
+glm::mat4 Renderer::projectionMatrix() const {
+    return glm::perspective(glm::radians(FIELD_OF_VIEW), static_cast<float>(width) / height, NEAR_PLANE, FAR_PLANE);
+}
+
+glm::mat4 Renderer::viewProjection() const {
+    return projectionMatrix() * viewMatrix();
+}
+
+const Renderer::SphereMesh& Renderer::meshFor(BodyLod lod) const {
+    if (lod <= BodyLod::Impostor) return sphereMeshes[0];
+    return sphereMeshes[static_cast<size_t>(lod) - static_cast<size_t>(BodyLod::Sphere32) + 1];
+}
+
+// Culls the bodies against the view frustum and groups the visible ones by
+// level of detail, so each level is one instanced draw over its own range of
+// the instance buffer. Vertex work then follows what is on screen: a body
+// under a pixel costs one vertex and a distant crowd many times less than
+// full meshes.
+void Renderer::drawBodies(const Snapshot& bodies) {
+    PROFILE_SCOPE("drawBodies");
+    if (bodies.empty()) return;
     double maxMass = 0;
     double minMass = std::numeric_limits<double>::max();
 
     // Find the maximum and minimum masses
-    for (const auto& body : bodies) {
-        maxMass = std::max(maxMass, body.getMass());
-        minMass = std::min(minMass, body.getMass());
-    }
-
     for (size_t i = 0; i < bodies.size(); ++i) {
-        const auto& body = bodies[i];
-        glm::dvec3 pos = body.getPosition();
+        maxMass = std::max(maxMass, bodies.mass[i]);
+        minMass = std::min(minMass, bodies.mass[i]);
     }
 
     // Calculate the log range
@@ -97,37 +350,192 @@ void Renderer::render(const Simulator& simulator) {
     double logMaxMass = std::log10(maxMass);
     double logRange = logMaxMass - logMinMass;
 
-    for (size_t i = 0; i < bodies.size(); ++i) {
-        const auto& body = bodies[i];
-
-        // Calculate the scale factor based on mass
-        double logMass = std::log10(body.getMass());
-        double normalizedLogMass = (logMass - logMinMass) / logRange;
-        float minScale = 5e9f;  // Minimum scale to ensure visibility
-        float maxScale = 5e10f; // Maximum scale to prevent overly large objects
-        float scaleFactor = minScale + static_cast<float>(normalizedLogMass) * (maxScale - minScale);
-
-        glm::dvec3 pos = body.getPosition();
-        glm::vec3 renderPos(static_cast<float>(pos.x), static_cast<float>(pos.y), static_cast<float>(pos.z));
-
-        // Set color based on body index
-        switch(i) {
-            case 0: glColor3f(1.0f, 1.0f, 0.0f); break;  // Sun: Yellow
-            case 1: glColor3f(0.5f, 0.5f, 0.5f); break;  // Mercury: Gray
-            case 2: glColor3f(0.9f, 0.7f, 0.4f); break;  // Venus: Light Orange
-            case 3: glColor3f(0.0f, 0.5f, 1.0f); break;  // Earth: Blue
-            case 4: glColor3f(1.0f, 0.0f, 0.0f); break;  // Mars: Red
-            case 5: glColor3f(0.8f, 0.6f, 0.2f); break;  // Jupiter: Light Brown
-            case 6: glColor3f(0.9f, 0.9f, 0.7f); break;  // Saturn: Light Yellow
-            case 7: glColor3f(0.0f, 0.5f, 0.5f); break;  // Uranus: Cyan
-            case 8: glColor3f(0.0f, 0.0f, 1.0f); break;  // Neptune: Dark Blue
-            case 9: glColor3f(0.5f, 0.5f, 0.5f); break;  // Pluto: Gray
-
-            default: glColor3f(1.0f, 1.0f, 1.0f); break; // White for any additional bodies
+    const size_t n = bodies.size();
+    const size_t levelCount = static_cast<size_t>(BodyLod::Count);
+    const glm::mat4 projectionView = viewProjection();
+    const Frustum frustum(projectionView);
+    const float pixelsPerUnit = height / (2.0f * std::tan(glm::radians(FIELD_OF_VIEW) / 2.0f));
+    size_t counts[static_cast<size_t>(BodyLod::Count) + 1] = {};
+    unsorted.resize(n);
+    levels.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        BodyInstance& instance = unsorted[i];
+        instance.position = glm::vec3(bodies.position[i]);
+        instance.radius = bodyScale(bodies.mass[i], logMinMass, logRange);
+        instance.colour = packColour(bodyColour(bodies.id[i]));
+        BodyLod lod = BodyLod::Count;
+        if (frustum.intersects(instance.position, instance.radius)) {
+            lod = chooseLod(projectedDiameter(projectionView, pixelsPerUnit, instance.position, instance.radius),
+                            lodThresholds);
+        }
+        levels[i] = static_cast<uint8_t>(lod);
+        ++counts[static_cast<size_t>(lod)];
+    }
+    levelStart[0] = 0;
+    for (size_t l = 0; l < levelCount; ++l) {
+        levelStart[l + 1] = levelStart[l] + counts[l];
+    }
+    const size_t visible = levelStart[levelCount];
+    instances.resize(visible);
+    size_t next[static_cast<size_t>(BodyLod::Count)];
+    std::copy(levelStart, levelStart + levelCount, next);
+    for (size_t i = 0; i < n; ++i) {
+        if (levels[i] < levelCount) {
+            instances[next[levels[i]]++] = unsorted[i];
         }
+    }
+    PROFILE_COUNT(CulledBodies, n - visible);
 
-        drawSphere(renderPos, scaleFactor);
+    if (!instancing) {
+        drawBodiesImmediate();
+        return;
     }
+
+    // Orphan last frame's storage so the driver never waits for the GPU to
+    // finish reading it
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    instanceCapacity = std::max(instanceCapacity, visible);
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(BodyInstance), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, visible * sizeof(BodyInstance), instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    uint64_t vertices = 0;
+    auto drawSprites = [&](size_t first, size_t count) {
+        if (count == 0) return;
+        glUseProgram(spriteProgram);
+        glUniformMatrix4fv(glGetUniformLocation(spriteProgram, "viewProjection"), 1, GL_FALSE,
+                           glm::value_ptr(projectionView));
+        glUniform1f(glGetUniformLocation(spriteProgram, "pixelsPerUnit"), pixelsPerUnit);
+        glUniform1f(glGetUniformLocation(spriteProgram, "maxPointSize"), MAX_SPRITE_SIZE);
+        glEnable(GL_PROGRAM_POINT_SIZE);
+        glEnable(GL_POINT_SPRITE);
+        glBindVertexArray(spriteVAO);
+        pointInstanceAttributes(first, 0);
+        glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(count));
+        glDisable(GL_POINT_SPRITE);
+        glDisable(GL_PROGRAM_POINT_SIZE);
+        vertices += count;
+    };
+
+    if (visible > spriteThreshold) {
+        drawSprites(0, visible);
+    } else {
+        auto range = [this](BodyLod lod) {
+            const size_t l = static_cast<size_t>(lod);
+            return std::make_pair(levelStart[l], levelStart[l + 1] - levelStart[l]);
+        };
+        auto points = range(BodyLod::Point);
+        drawSprites(points.first, points.second);
+
+        auto impostors = range(BodyLod::Impostor);
+        if (impostors.second > 0) {
+            glUseProgram(impostorProgram);
+            glUniformMatrix4fv(glGetUniformLocation(impostorProgram, "view"), 1, GL_FALSE,
+                               glm::value_ptr(viewMatrix()));
+            glUniformMatrix4fv(glGetUniformLocation(impostorProgram, "projection"), 1, GL_FALSE,
+                               glm::value_ptr(projectionMatrix()));
+            glBindVertexArray(impostorVAO);
+            pointInstanceAttributes(impostors.first, 1);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(impostors.second));
+            vertices += 4 * impostors.second;
+        }
+
+        glUseProgram(sphereProgram);
+        glUniformMatrix4fv(glGetUniformLocation(sphereProgram, "viewProjection"), 1, GL_FALSE,
+                           glm::value_ptr(projectionView));
+        for (BodyLod lod : {BodyLod::Sphere32, BodyLod::Sphere64, BodyLod::Sphere128}) {
+            auto spheres = range(lod);
+            if (spheres.second == 0) continue;
+            const SphereMesh& mesh = meshFor(lod);
+            glBindVertexArray(mesh.instanceVAO);
+            pointInstanceAttributes(spheres.first, 1);
+            glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, nullptr,
+                                    static_cast<GLsizei>(spheres.second));
+            vertices += static_cast<uint64_t>(mesh.vertexCount) * spheres.second;
+        }
+    }
+    PROFILE_COUNT(BodyVertices, vertices);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+// Without shaders there are no impostors, so they get the coarsest mesh
+void Renderer::drawBodiesImmediate() {
+    const size_t pointsEnd = levelStart[static_cast<size_t>(BodyLod::Point) + 1];
+    glBegin(GL_POINTS);
+    for (size_t k = 0; k < pointsEnd; ++k) {
+        const BodyInstance& instance = instances[k];
+        glColor4ubv(reinterpret_cast<const GLubyte*>(&instance.colour));
+        glVertex3f(instance.position.x, instance.position.y, instance.position.z);
+    }
+    glEnd();
+
+    for (size_t l = static_cast<size_t>(BodyLod::Impostor); l < static_cast<size_t>(BodyLod::Count); ++l) {
+        const SphereMesh& mesh = meshFor(static_cast<BodyLod>(l));
+        for (size_t k = levelStart[l]; k < levelStart[l + 1]; ++k) {
+            const BodyInstance& instance = instances[k];
+            glColor4ubv(reinterpret_cast<const GLubyte*>(&instance.colour));
+            drawSphere(mesh, instance.position, instance.radius);
+        }
+    }
+}
+
+void Renderer::createBodyPipeline() {
+    sphereProgram = createShaderProgram(SPHERE_VERTEX_SHADER, SPHERE_FRAGMENT_SHADER);
+    spriteProgram = createShaderProgram(SPRITE_VERTEX_SHADER, SPRITE_FRAGMENT_SHADER);
+    impostorProgram = createShaderProgram(IMPOSTOR_VERTEX_SHADER, IMPOSTOR_FRAGMENT_SHADER);
+    glGenBuffers(1, &instanceVBO);
+    glGenVertexArrays(1, &spriteVAO);
+    glGenVertexArrays(1, &impostorVAO);
+
+    // Attributes 1-3 come from the instance buffer; drawBodies points them at
+    // the range of each level before drawing it
+    for (SphereMesh& mesh : sphereMeshes) {
+        glGenVertexArrays(1, &mesh.instanceVAO);
+        glBindVertexArray(mesh.instanceVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+        pointInstanceAttributes(0, 1);
+    }
+
+    const GLfloat corners[] = {-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
+    glGenBuffers(1, &quadVBO);
+    glBindVertexArray(impostorVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (void*)0);
+    pointInstanceAttributes(0, 1);
+
+    glBindVertexArray(spriteVAO);
+    pointInstanceAttributes(0, 0);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    instancing = true;
+}
+
+// Points attributes 1-3 of the bound vertex array at the instance buffer from
+// instance first on: once per instance for meshes and impostors, once per
+// vertex for sprites
+void Renderer::pointInstanceAttributes(size_t first, GLuint divisor) {
+    const size_t base = first * sizeof(BodyInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(BodyInstance),
+                          reinterpret_cast<void*>(base + offsetof(BodyInstance, position)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(BodyInstance),
+                          reinterpret_cast<void*>(base + offsetof(BodyInstance, radius)));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(BodyInstance),
+                          reinterpret_cast<void*>(base + offsetof(BodyInstance, colour)));
+    glVertexAttribDivisor(1, divisor);
+    glVertexAttribDivisor(2, divisor);
+    glVertexAttribDivisor(3, divisor);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 bool Renderer::shouldClose() {
@@ -139,19 +547,20 @@ void Renderer::swapBuffers() {
     glfwPollEvents();
 }
 
-void Renderer::drawSphere(const glm::vec3& position, float radius) {
+void Renderer::drawSphere(const SphereMesh& mesh, const glm::vec3& position, float radius) {
     glPushMatrix();
     glTranslatef(position.x, position.y, position.z);
     glScalef(radius, radius, radius);
 
-    glBindVertexArray(sphereVAO);
-    glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(mesh.vao);
+    glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
 
     glPopMatrix();
 }
 
-void Renderer::createSphereMesh(float radius, int sectors, int stacks) {
+Renderer::SphereMesh Renderer::createSphereMesh(int sectors, int stacks) {
+    const float radius = 1.0f;
     std::vector<GLfloat> vertices;
     std::vector<GLuint> indices;
 
@@ -203,16 +612,17 @@ void Renderer::createSphereMesh(float radius, int sectors, int stacks) {
         }
     }
 
-    glGenVertexArrays(1, &sphereVAO);
-    glGenBuffers(1, &sphereVBO);
-    glGenBuffers(1, &sphereEBO);
+    SphereMesh mesh;
+    glGenVertexArrays(1, &mesh.vao);
+    glGenBuffers(1, &mesh.vbo);
+    glGenBuffers(1, &mesh.ebo);
 
-    glBindVertexArray(sphereVAO);
+    glBindVertexArray(mesh.vao);
 
-    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
     glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
 
     glEnableVertexAttribArray(0);
@@ -220,8 +630,9 @@ void Renderer::createSphereMesh(float radius, int sectors, int stacks) {
 
     glBindVertexArray(0);
 
-    sphereVertexCount = vertices.size() / 3;
-    sphereIndexCount = indices.size();
+    mesh.vertexCount = static_cast<GLsizei>(vertices.size() / 3);
+    mesh.indexCount = static_cast<GLsizei>(indices.size());
+    return mesh;
 }
 
 void Renderer::drawDebugTriangle() {
@@ -243,50 +654,142 @@ void Renderer::drawDebugTriangle() {
     glEnd();
 }
 
-float Renderer::calculateGravityFieldStrength(const glm::vec3& point, const std::vector<CelestialBody>& bodies) {
-    float fieldStrength = 0.0f;
-    const float G = 6.67430e-11f; // Gravitational constant
-    const float scalingFactor = 1e20f; // Greatly increased scaling factor
-    for (const auto& body : bodies) {
-        glm::dvec3 bodyPos = body.getPosition();
-        float distance = glm::length(glm::vec3(bodyPos) - point);
-        if (distance < 1e9f) distance = 1e9f; // Prevent division by zero
-        fieldStrength += scalingFactor * G * static_cast<float>(body.getMass()) / (distance * distance);
+void Renderer::setGridStyle(GridStyle style) {
+    gridStyle = style;
+    gridStale = true;
+}
+
+void Renderer::setFieldThreadCount(size_t threads) {
+    fieldPool = threads > 1 ? std::make_unique<ThreadPool>(threads) : nullptr;
+}
+
+// Two vertices per field point, the first set for the lines and the second
+// for the heatmap's fill, which only differ in colour. The indices never
+// change.
+void Renderer::createGrid() {
+    const size_t n = GRID_RESOLUTION;
+    std::vector<GLuint> lines;
+    for (size_t a = 0; a < n; a += GRID_LINE_STEP) {
+        for (size_t b = 0; b + 1 < n; ++b) {
+            // Along row a, then along column a
+            lines.insert(lines.end(), {GLuint(a * n + b), GLuint(a * n + b + 1)});
+            lines.insert(lines.end(), {GLuint(b * n + a), GLuint((b + 1) * n + a)});
+        }
     }
-    return fieldStrength;
+    std::vector<GLuint> fill;
+    for (size_t j = 0; j + 1 < n; ++j) {
+        for (size_t i = 0; i + 1 < n; ++i) {
+            const GLuint corner = GLuint(n * n + j * n + i);
+            fill.insert(fill.end(), {corner, GLuint(corner + 1), GLuint(corner + n),
+                                     GLuint(corner + 1), GLuint(corner + n + 1), GLuint(corner + n)});
+        }
+    }
+    gridLineIndexCount = static_cast<GLsizei>(lines.size());
+    gridFillIndexCount = static_cast<GLsizei>(fill.size());
+    gridVertices.resize(2 * n * n);
+
+    glGenBuffers(1, &gridVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
+    glBufferData(GL_ARRAY_BUFFER, gridVertices.size() * sizeof(GridVertex), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glGenBuffers(1, &gridLineEBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gridLineEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, lines.size() * sizeof(GLuint), lines.data(), GL_STATIC_DRAW);
+    glGenBuffers(1, &gridFillEBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gridFillEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, fill.size() * sizeof(GLuint), fill.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
-void Renderer::drawGrid(const Simulator& simulator) {
-    const float gridSize = 5e13f;
-    const int gridLines = 80;
-    const float lineSpacing = gridSize / gridLines;
+// Checks each new snapshot against the field the vertices were made from.
+// Between recomputations a frame draws the buffer as it is.
+void Renderer::updateGrid(const Snapshot& snapshot) {
+    if (gridStyle != GridStyle::Flat && snapshot.sequence != gridSequence) {
+        gridSequence = snapshot.sequence;
+        if (fieldGrid.update(snapshot.position, snapshot.mass, fieldPool.get())) {
+            gridStale = true;
+        }
+    }
+    if (!gridStale) return;
+
+    const size_t n = GRID_RESOLUTION;
+    const float spacing = static_cast<float>(fieldGrid.getSpacing());
+    const float half = static_cast<float>(GRID_SIZE / 2.0);
+    const bool field = gridStyle != GridStyle::Flat && !fieldGrid.getPotential().empty();
+    const float depthScale = field && fieldGrid.getMinPotential() < 0.0f
+                             ? SHEET_DEPTH / -fieldGrid.getMinPotential() : 0.0f;
+    const uint32_t grey = packColour(glm::vec3(GRID_GREY));
+    for (size_t j = 0; j < n; ++j) {
+        for (size_t i = 0; i < n; ++i) {
+            const size_t k = j * n + i;
+            GridVertex& line = gridVertices[k];
+            GridVertex& fill = gridVertices[n * n + k];
+            line.position = glm::vec3(-half + spacing * i, 0.0f, -half + spacing * j);
+            line.colour = grey;
+            fill.position = line.position;
+            fill.colour = 0;
+            if (!field) continue;
+
+            const float level = fieldLevel(fieldGrid.getFieldStrength()[k], fieldGrid.getMaxFieldStrength());
+            if (gridStyle == GridStyle::Sheet) {
+                line.position.y = depthScale * fieldGrid.getPotential()[k];
+                line.colour = packColour(glm::mix(glm::vec3(GRID_GREY), glm::vec3(0.4f, 0.7f, 1.0f), level));
+            } else {
+                fill.colour = packColour(heatColour(level), 0.6f * level);
+            }
+        }
+    }
 
-    glBegin(GL_LINES);
-    glColor3f(0.2f, 0.2f, 0.2f);  // Lighter gray for better visibility
+    glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, gridVertices.size() * sizeof(GridVertex), gridVertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    gridStale = false;
+}
 
-    for (int i = -gridLines/2; i <= gridLines/2; ++i) {
-        float pos = i * lineSpacing;
-        glVertex3f(-gridSize/2, 0, pos);
-        glVertex3f(gridSize/2, 0, pos);
-        glVertex3f(pos, 0, -gridSize/2);
-        glVertex3f(pos, 0, gridSize/2);
+void Renderer::drawGrid(const Snapshot& snapshot) {
+    PROFILE_SCOPE("drawGrid");
+    updateGrid(snapshot);
+
+    glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(GridVertex), reinterpret_cast<void*>(offsetof(GridVertex, position)));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(GridVertex), reinterpret_cast<void*>(offsetof(GridVertex, colour)));
+
+    if (gridStyle == GridStyle::Heatmap) {
+        // Translucent, and without hiding the trails and bodies under the plane
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_FALSE);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gridFillEBO);
+        glDrawElements(GL_TRIANGLES, gridFillIndexCount, GL_UNSIGNED_INT, nullptr);
+        glDepthMask(GL_TRUE);
+        glDisable(GL_BLEND);
     }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gridLineEBO);
+    glDrawElements(GL_LINES, gridLineIndexCount, GL_UNSIGNED_INT, nullptr);
 
-    glEnd();
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void Renderer::drawTrajectories(const std::vector<CelestialBody>& bodies) {
+void Renderer::drawTrajectories(const Snapshot& snapshot) {
+    PROFILE_SCOPE("drawTrajectories");
+    if (!snapshot.hasTrajectories()) return;
     glBegin(GL_LINES);
-    for (const auto& body : bodies) {
-        const auto& trajectory = body.getTrajectory();
-        if (trajectory.size() < 2) continue;
+    for (size_t b = 0; b < snapshot.size(); ++b) {
+        const glm::vec3* trajectory = snapshot.trajectoryPoints.data() + snapshot.trajectoryStart[b];
+        const size_t count = snapshot.trajectoryStart[b + 1] - snapshot.trajectoryStart[b];
+        if (count < 2) continue;
 
-        for (size_t i = 1; i < trajectory.size(); ++i) {
-            glm::vec3 p1(trajectory[i-1]);
-            glm::vec3 p2(trajectory[i]);
+        for (size_t i = 1; i < count; ++i) {
+            const glm::vec3& p1 = trajectory[i-1];
+            const glm::vec3& p2 = trajectory[i];
 
             // Fade out older parts of the trajectory
-            float alpha = static_cast<float>(i) / trajectory.size();
+            float alpha = static_cast<float>(i) / count;
             glColor4f(1.0f, 1.0f, 1.0f, alpha * 0.5f);
 
             glVertex3f(p1.x, p1.y, p1.z);
@@ -8,33 +8,111 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
-#include "Simulator.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "FieldGrid.h"
+#include "SimulationThread.h"
+#include "TrajectoryBuffer.h"
+#include "ThreadPool.h"
+#include "Visibility.h"
+
+// What the reference grid shows of the gravity of the snapshot
+enum class GridStyle {
+    Flat,     // Plain lines
+    Sheet,    // Lines sunk by the potential, a rubber sheet
+    Heatmap   // Flat lines over a fill coloured by field strength
+};
 
 class Renderer {
 public:
     Renderer(int width, int height);
     ~Renderer();
 
-    void render(const Simulator& simulator);
+    void render(const Snapshot& snapshot);
     bool shouldClose();
     void swapBuffers();
     void processInput();
+    // Above this many visible bodies, draw them all as point sprites (default 10,000)
+    void setSpriteThreshold(size_t bodies) { spriteThreshold = bodies; }
+    // Projected sizes at which bodies switch between points, impostors and sphere meshes
+    void setLodThresholds(const LodThresholds& thresholds) { lodThresholds = thresholds; }
+    // Whether render() draws trails from the snapshot's trajectories. When the
+    // GPU keeps its own trails, snapshots can leave them out.
+    bool needsTrajectories() const { return !trajectoryBuffer; }
+    void setGridStyle(GridStyle style);
+    GridStyle getGridStyle() const { return gridStyle; }
+    // Threads that recompute the grid's field (default 1, on the render thread)
+    void setFieldThreadCount(size_t threads);
 
     static void cursorPosCallback(GLFWwindow* window, double xpos, double ypos);
     static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 
 private:
+    // Per-body data streamed to the GPU once per frame
+    struct BodyInstance {
+        glm::vec3 position;
+        float radius;     // Drawn radius, from the log-mass scale
+        uint32_t colour;  // RGBA8
+    };
+
+    // A unit sphere, with a second vertex array that adds the instance attributes
+    struct SphereMesh {
+        GLuint vao = 0, vbo = 0, ebo = 0;
+        GLuint instanceVAO = 0;
+        GLsizei vertexCount = 0, indexCount = 0;
+    };
+
     GLFWwindow* window;
-    void drawSphere(const glm::vec3& position, float radius);
-    void createSphereMesh(float radius, int sectors, int stacks);
+    int width, height;
+    void drawSphere(const SphereMesh& mesh, const glm::vec3& position, float radius);
+    SphereMesh createSphereMesh(int sectors, int stacks);
     void drawDebugTriangle();
+    void createBodyPipeline();
+    void drawBodies(const Snapshot& bodies);
+    void drawBodiesImmediate();
+    void pointInstanceAttributes(size_t first, GLuint divisor);
+    glm::mat4 viewMatrix() const;
+    glm::mat4 projectionMatrix() const;
+    glm::mat4 viewProjection() const;
+
+    // Coarsest first: the immediate path's stand-in for impostors, then one per sphere level
+    SphereMesh sphereMeshes[4];
+    const SphereMesh& meshFor(BodyLod lod) const;
+
+    bool instancing;  // OpenGL 3.3 is available, otherwise bodies use the immediate path
+    GLuint sphereProgram, spriteProgram, impostorProgram;
+    GLuint instanceVBO, spriteVAO, impostorVAO, quadVBO;
+    size_t instanceCapacity;
+    size_t spriteThreshold;
+    LodThresholds lodThresholds;
+    std::vector<BodyInstance> instances;  // Visible bodies grouped by level
+    size_t levelStart[static_cast<size_t>(BodyLod::Count) + 1];  // Level l is [levelStart[l], levelStart[l + 1])
+    std::vector<BodyInstance> unsorted;   // Every body, before culling
+    std::vector<uint8_t> levels;          // Per body, its BodyLod or BodyLod::Count when culled
+
+    struct GridVertex {
+        glm::vec3 position;
+        uint32_t colour;  // RGBA8
+    };
 
-    GLuint sphereVAO, sphereVBO, sphereEBO;
-    int sphereVertexCount, sphereIndexCount;
+    void createGrid();
+    void updateGrid(const Snapshot& snapshot);
+    void drawGrid(const Snapshot& snapshot);
+    void drawTrajectories(const Snapshot& snapshot);
+    std::unique_ptr<TrajectoryBuffer> trajectoryBuffer;  // Null when the GPU can't keep trails
+    uint64_t trajectorySequence;  // Last snapshot sent to trajectoryBuffer
 
-    void drawGrid(const Simulator& simulator);
-    float calculateGravityFieldStrength(const glm::vec3& point, const std::vector<CelestialBody>& bodies);
-    void drawTrajectories(const std::vector<CelestialBody>& bodies);
+    // The grid's vertices stay on the GPU and are only rewritten when the
+    // field is recomputed, which fieldGrid does once bodies have moved
+    FieldGrid fieldGrid;
+    std::unique_ptr<ThreadPool> fieldPool;
+    GridStyle gridStyle;
+    uint64_t gridSequence;  // Snapshot the grid was last checked against
+    bool gridStale;         // The vertices don't show the current style or field
+    GLuint gridVBO, gridLineEBO, gridFillEBO;
+    GLsizei gridLineIndexCount, gridFillIndexCount;
+    std::vector<GridVertex> gridVertices;
 
     glm::vec3 cameraPos;
     glm::vec3 cameraFront;
@@ -0,0 +1,321 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+#include "Scenario.h"
+#include "Physics.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+
+namespace {
+    const double SUN_MASS = 1.989e30;
+    const double AU = 149.6e9;
+
+    // Bodies per generator block, each block draws from its own RNG stream
+    const size_t GENERATOR_BLOCK = size_t(1) << 14;
+
+    double densityRadius(double mass, double density) {
+        return std::cbrt(mass / (4.0 / 3.0 * M_PI * density));
+    }
+
+    // Circular orbit of the given radius around the origin, tilted by inclination about the x axis
+    void addOrbitingBody(BodyTable& table, double centralMass, double mass, double distance, double phase,
+                         double inclination, double radius) {
+        glm::dvec3 position(distance * std::cos(phase), distance * std::sin(phase), 0.0);
+        double speed = std::sqrt(G * centralMass / distance);
+        glm::dvec3 velocity(-speed * std::sin(phase), speed * std::cos(phase), 0.0);
+
+        double c = std::cos(inclination), s = std::sin(inclination);
+        position = glm::dvec3(position.x, position.y * c, position.y * s);
+        velocity = glm::dvec3(velocity.x, velocity.y * c, velocity.y * s);
+        table.add(mass, position, velocity, radius);
+    }
+
+    // SplitMix64 finaliser, so neighbouring blocks get unrelated streams
+    uint64_t blockSeed(unsigned seed, size_t block) {
+        uint64_t z = (static_cast<uint64_t>(seed) << 32) + block + 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    // Resizes table to count bodies and fills them block by block
+    void generateBlocks(BodyTable& table, size_t count, unsigned seed, ThreadPool* pool,
+                        const std::function<void(std::mt19937_64&, size_t, size_t)>& fill) {
+        table.resize(count);
+        auto block = [&](size_t begin, size_t end) {
+            std::mt19937_64 rng(blockSeed(seed, begin / GENERATOR_BLOCK));
+            fill(rng, begin, end);
+        };
+        if (pool) {
+            pool->parallelFor(count, GENERATOR_BLOCK, block);
+        } else {
+            for (size_t begin = 0; begin < count; begin += GENERATOR_BLOCK) {
+                block(begin, std::min(count, begin + GENERATOR_BLOCK));
+            }
+        }
+    }
+
+    glm::dvec3 randomDirection(std::mt19937_64& rng) {
+        std::uniform_real_distribution<double> cosTheta(-1.0, 1.0);
+        std::uniform_real_distribution<double> phi(0.0, 2.0 * M_PI);
+        double c = cosTheta(rng);
+        double s = std::sqrt(std::max(0.0, 1.0 - c * c));
+        double p = phi(rng);
+        return glm::dvec3(s * std::cos(p), s * std::sin(p), c);
+    }
+
+    // Moves the centre of mass to the origin and brings it to rest
+    void removeCentreOfMassMotion(BodyTable& table) {
+        glm::dvec3 position(0.0), velocity(0.0);
+        double mass = 0.0;
+        for (size_t i = 0; i < table.size(); ++i) {
+            position += table.mass[i] * glm::dvec3(table.x[i], table.y[i], table.z[i]);
+            velocity += table.mass[i] * glm::dvec3(table.vx[i], table.vy[i], table.vz[i]);
+            mass += table.mass[i];
+        }
+        if (mass <= 0.0) return;
+        position /= mass;
+        velocity /= mass;
+        for (size_t i = 0; i < table.size(); ++i) {
+            table.x[i] -= position.x;
+            table.y[i] -= position.y;
+            table.z[i] -= position.z;
+            table.vx[i] -= velocity.x;
+            table.vy[i] -= velocity.y;
+            table.vz[i] -= velocity.z;
+        }
+    }
+
+    bool isPath(const std::string& name) {
+        return name.find_first_of("./\\") != std::string::npos;
+    }
+}
+
+glm::dvec3 calculateOrbitalVelocity(double centralMass, double distance) {
+    double speed = std::sqrt(G * centralMass / distance);
+    return glm::dvec3(0, speed, 0);  // Assuming orbit in the XZ plane
+}
+
+void addSolarSystem(Simulator& simulator) {
+    double sunMass = SUN_MASS;
+
+    // Sun (at the center)
+    simulator.addBody(CelestialBody(sunMass, glm::dvec3(0, 0, 0), glm::dvec3(0, 0, 0), 6.96e8));
+
+    // Mercury
+    double mercuryDist = 57.9e9;
+    simulator.addBody(CelestialBody(3.285e23, glm::dvec3(mercuryDist, 0, 0), calculateOrbitalVelocity(sunMass, mercuryDist), 2.44e6));
+
+    // Venus
+    double venusDist = 108.2e9;
+    simulator.addBody(CelestialBody(4.867e24, glm::dvec3(venusDist, 0, 0), calculateOrbitalVelocity(sunMass, venusDist), 6.05e6));
+
+    // Earth
+    double earthDist = 149.6e9;
+    simulator.addBody(CelestialBody(5.972e24, glm::dvec3(earthDist, 0, 0), calculateOrbitalVelocity(sunMass, earthDist), 6.37e6));
+
+    // Mars
+    double marsDist = 227.9e9;
+    simulator.addBody(CelestialBody(6.39e23, glm::dvec3(marsDist, 0, 0), calculateOrbitalVelocity(sunMass, marsDist), 3.39e6));
+
+    // Jupiter
+    double jupiterDist = 778.5e9;
+    simulator.addBody(CelestialBody(1.898e27, glm::dvec3(jupiterDist, 0, 0), calculateOrbitalVelocity(sunMass, jupiterDist), 69.91e6));
+
+    // Saturn
+    double saturnDist = 1.429e12;
+    simulator.addBody(CelestialBody(5.683e26, glm::dvec3(saturnDist, 0, 0), calculateOrbitalVelocity(sunMass, saturnDist), 58.23e6));
+
+    // Uranus
+    double uranusDist = 2.871e12;
+    simulator.addBody(CelestialBody(8.681e25, glm::dvec3(uranusDist, 0, 0), calculateOrbitalVelocity(sunMass, uranusDist ), 25.36e6));
+
+    // Neptune
+    double neptuneDist = 4.495e12;
+    simulator.addBody(CelestialBody(1.024e26, glm::dvec3(neptuneDist, 0, 0), calculateOrbitalVelocity(sunMass, neptuneDist), 24.62e6));
+
+    // Pluto
+    double plutoDist = 5.906e12;
+    simulator.addBody(CelestialBody(1.309e22, glm::dvec3(plutoDist, 0, 0), calculateOrbitalVelocity(sunMass, plutoDist), 1.18e6));
+}
+
+void addAsteroidBelt(Simulator& simulator, size_t bodyCount, unsigned seed) {
+    addSolarSystem(simulator);
+
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> distance(2.2 * AU, 3.2 * AU);
+    std::uniform_real_distribution<double> phase(0.0, 2.0 * M_PI);
+    std::normal_distribution<double> inclination(0.0, 0.1);
+    std::uniform_real_distribution<double> logMass(15.0, 20.0);
+    BodyTable asteroids;
+    asteroids.reserve(bodyCount);
+    for (size_t i = 0; i < bodyCount; ++i) {
+        double mass = std::pow(10.0, logMass(rng));
+        double radius = densityRadius(mass, 2000.0);  // Rocky, about 2 g/cm^3
+        addOrbitingBody(asteroids, SUN_MASS, mass, distance(rng), phase(rng), inclination(rng), radius);
+    }
+    simulator.addBodies(asteroids);
+}
+
+void addDebrisCloud(Simulator& simulator, size_t bodyCount, unsigned seed) {
+    simulator.addBody(CelestialBody(SUN_MASS, glm::dvec3(0.0), glm::dvec3(0.0), 6.96e8));
+
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> distance(0.5 * AU, 5.0 * AU);
+    std::uniform_real_distribution<double> phase(0.0, 2.0 * M_PI);
+    std::uniform_real_distribution<double> inclination(-M_PI / 2.0, M_PI / 2.0);
+    std::uniform_real_distribution<double> logMass(12.0, 18.0);
+    BodyTable debris;
+    debris.reserve(bodyCount);
+    for (size_t i = 0; i < bodyCount; ++i) {
+        double mass = std::pow(10.0, logMass(rng));
+        double radius = densityRadius(mass, 1000.0);  // Icy, about 1 g/cm^3
+        addOrbitingBody(debris, SUN_MASS, mass, distance(rng), phase(rng), inclination(rng), radius);
+    }
+    simulator.addBodies(debris);
+}
+
+BodyTable generatePlummerSphere(size_t bodyCount, double totalMass, double scaleRadius, unsigned seed,
+                                ThreadPool* pool) {
+    const double mass = totalMass / static_cast<double>(bodyCount);
+    const double radius = densityRadius(mass, 1410.0);  // The Sun's mean density
+    const double velocityScale = std::sqrt(G * totalMass / scaleRadius);
+
+    BodyTable table;
+    generateBlocks(table, bodyCount, seed, pool, [&](std::mt19937_64& rng, size_t begin, size_t end) {
+        std::uniform_real_distribution<double> enclosedMass(0.0, 0.999);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::uniform_real_distribution<double> density(0.0, 0.1);
+        for (size_t i = begin; i < end; ++i) {
+            // Radius from the inverse of the cumulative mass profile, in units of the scale radius
+            double m = std::cbrt(enclosedMass(rng));
+            double r = m / std::sqrt(1.0 - m * m);
+            // Speed as a fraction q of the local escape speed, by rejection from g(q) = q^2 (1 - q^2)^3.5
+            double q, t, g;
+            do {
+                q = unit(rng);
+                t = 1.0 - q * q;
+                g = density(rng);
+            } while (g > q * q * t * t * t * std::sqrt(t));
+            double speed = q * std::sqrt(2.0 / std::sqrt(1.0 + r * r));
+
+            glm::dvec3 position = randomDirection(rng) * (r * scaleRadius);
+            glm::dvec3 velocity = randomDirection(rng) * (speed * velocityScale);
+            table.set(i, mass, position, velocity, radius);
+        }
+    });
+    removeCentreOfMassMotion(table);
+    return table;
+}
+
+BodyTable generateExponentialDisk(size_t bodyCount, double centralMass, double diskMass, double scaleLength,
+                                  double scaleHeight, unsigned seed, ThreadPool* pool) {
+    const double mass = diskMass / static_cast<double>(bodyCount);
+    const double radius = densityRadius(mass, 2000.0);
+
+    BodyTable table;
+    generateBlocks(table, bodyCount, seed, pool, [&](std::mt19937_64& rng, size_t begin, size_t end) {
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::uniform_real_distribution<double> phase(0.0, 2.0 * M_PI);
+        for (size_t i = begin; i < end; ++i) {
+            // R exp(-R / Rd) is a Gamma(2, Rd) distribution, the sum of two exponentials
+            double distance;
+            do {
+                distance = -scaleLength * std::log((1.0 - unit(rng)) * (1.0 - unit(rng)));
+            } while (distance < 0.1 * scaleLength || distance > 10.0 * scaleLength);
+            double u;
+            do {
+                u = unit(rng);
+            } while (u == 0.0);
+            double height = scaleHeight * std::atanh(2.0 * u - 1.0);
+            double angle = phase(rng);
+
+            double x = distance / scaleLength;
+            double enclosed = centralMass + diskMass * (1.0 - (1.0 + x) * std::exp(-x));
+            double speed = std::sqrt(G * enclosed / distance);
+            glm::dvec3 position(distance * std::cos(angle), distance * std::sin(angle), height);
+            glm::dvec3 velocity(-speed * std::sin(angle), speed * std::cos(angle), 0.0);
+            table.set(i, mass, position, velocity, radius);
+        }
+    });
+    return table;
+}
+
+BodyTable generateKeplerBelt(size_t bodyCount, double centralMass, double totalMass, double innerAxis,
+                             double outerAxis, double maxEccentricity, double inclinationSpread, unsigned seed,
+                             ThreadPool* pool) {
+    const double mass = totalMass / static_cast<double>(bodyCount);
+    const double radius = densityRadius(mass, 2000.0);
+    const double mu = G * centralMass;
+
+    BodyTable table;
+    generateBlocks(table, bodyCount, seed, pool, [&](std::mt19937_64& rng, size_t begin, size_t end) {
+        std::uniform_real_distribution<double> axis(innerAxis, outerAxis);
+        std::uniform_real_distribution<double> eccentricity(0.0, maxEccentricity);
+        std::normal_distribution<double> inclination(0.0, inclinationSpread);
+        std::uniform_real_distribution<double> angle(0.0, 2.0 * M_PI);
+        for (size_t i = begin; i < end; ++i) {
+            double a = axis(rng);
+            double e = eccentricity(rng);
+            double incl = inclination(rng);
+            double node = angle(rng);
+            double periapsis = angle(rng);
+            double meanAnomaly = angle(rng);
+
+            // Kepler's equation M = E - e sin E by Newton's method
+            double E = meanAnomaly + e * std::sin(meanAnomaly);
+            for (int k = 0; k < 16; ++k) {
+                double delta = (E - e * std::sin(E) - meanAnomaly) / (1.0 - e * std::cos(E));
+                E -= delta;
+                if (std::abs(delta) < 1e-14) break;
+            }
+            double cosE = std::cos(E), sinE = std::sin(E);
+            double b = a * std::sqrt(1.0 - e * e);
+            double rate = std::sqrt(mu / (a * a * a)) / (1.0 - e * cosE);  // dE/dt
+
+            // In the orbital plane with periapsis on +x, then rotated by the periapsis
+            // argument about z, the inclination about x and the node about z
+            double cw = std::cos(periapsis), sw = std::sin(periapsis);
+            double ci = std::cos(incl), si = std::sin(incl);
+            double cn = std::cos(node), sn = std::sin(node);
+            glm::dvec3 p(cn * cw - sn * ci * sw, sn * cw + cn * ci * sw, si * sw);   // Towards periapsis
+            glm::dvec3 q(-cn * sw - sn * ci * cw, -sn * sw + cn * ci * cw, si * cw); // 90 degrees ahead
+            glm::dvec3 position = p * (a * (cosE - e)) + q * (b * sinE);
+            glm::dvec3 velocity = p * (-a * sinE * rate) + q * (b * cosE * rate);
+            table.set(i, mass, position, velocity, radius);
+        }
+    });
+    return table;
+}
+
+bool loadScenario(Simulator& simulator, const std::string& name, size_t bodyCount, unsigned seed) {
+    ThreadPool* pool = simulator.getThreadPool();
+    if (name == "solar") {
+        addSolarSystem(simulator);
+    } else if (name == "belt") {
+        addAsteroidBelt(simulator, bodyCount, seed);
+    } else if (name == "cloud") {
+        addDebrisCloud(simulator, bodyCount, seed);
+    } else if (name == "plummer") {
+        // A star cluster has no central body to hold in place
+        simulator.setPinHeaviestBody(false);
+        simulator.addBodies(generatePlummerSphere(bodyCount, 1000.0 * SUN_MASS, 10.0 * AU, seed, pool));
+    } else if (name == "disk") {
+        simulator.reserve(bodyCount + 1);
+        simulator.addBody(CelestialBody(SUN_MASS, glm::dvec3(0.0), glm::dvec3(0.0), 6.96e8));
+        simulator.addBodies(generateExponentialDisk(bodyCount, SUN_MASS, 0.01 * SUN_MASS, 5.0 * AU, 0.05 * AU,
+                                                    seed, pool));
+    } else if (name == "kepler") {
+        simulator.reserve(bodyCount + 10);
+        addSolarSystem(simulator);
+        // About the mass of the main asteroid belt
+        simulator.addBodies(generateKeplerBelt(bodyCount, SUN_MASS, 3e21, 2.2 * AU, 3.2 * AU, 0.2, 0.1, seed, pool));
+    } else if (isPath(name)) {
+        simulator.addBodies(readBodyTable(name, pool));
+    } else {
+        return false;
+    }
+    return true;
+}
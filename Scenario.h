@@ -0,0 +1,51 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+
+#ifndef GRAVITY_SCENARIO_H
+#define GRAVITY_SCENARIO_H
+#pragma once
+#include <string>
+#include "BodyTable.h"
+#include "Simulator.h"
+
+glm::dvec3 calculateOrbitalVelocity(double centralMass, double distance);
+
+// The Sun and the nine planets, all starting on the +x axis
+void addSolarSystem(Simulator& simulator);
+// The solar system plus bodyCount asteroids on circular orbits between 2.2 and 3.2 AU
+void addAsteroidBelt(Simulator& simulator, size_t bodyCount, unsigned seed);
+// A central star with bodyCount debris particles on randomly inclined orbits
+void addDebrisCloud(Simulator& simulator, size_t bodyCount, unsigned seed);
+
+// Generators for large initial conditions. Bodies are drawn in fixed blocks,
+// each from its own RNG stream seeded by the seed and the block index, so the
+// result depends only on the seed and never on the thread count or pool.
+
+// Plummer sphere of bodyCount equal-mass stars in virial equilibrium, sampled
+// as in Aarseth, Henon & Wielen (1974) and cut off at 99.9% of the mass.
+// Centred on the origin with zero total momentum.
+BodyTable generatePlummerSphere(size_t bodyCount, double totalMass, double scaleRadius, unsigned seed,
+                                ThreadPool* pool = nullptr);
+// Cold disk of bodyCount equal-mass bodies in the xy plane around a central mass
+// at the origin, which is not included. Surface density falls as exp(-R / scaleLength)
+// between 0.1 and 10 scale lengths, the vertical profile is sech^2(z / scaleHeight),
+// and every body starts on a circular orbit around the mass inside its radius.
+BodyTable generateExponentialDisk(size_t bodyCount, double centralMass, double diskMass, double scaleLength,
+                                  double scaleHeight, unsigned seed, ThreadPool* pool = nullptr);
+// bodyCount equal-mass bodies on Kepler orbits around a central mass at the origin,
+// which is not included. Semi-major axes are uniform in [innerAxis, outerAxis],
+// eccentricities uniform up to maxEccentricity, inclinations normal with the
+// given spread in radians, and the angles and mean anomaly uniform.
+BodyTable generateKeplerBelt(size_t bodyCount, double centralMass, double totalMass, double innerAxis,
+                             double outerAxis, double maxEccentricity, double inclinationSpread, unsigned seed,
+                             ThreadPool* pool = nullptr);
+
+// Adds the named scenario: "solar", "belt", "cloud", "plummer", "disk" or
+// "kepler", or the path of a body table file (see readBodyTable), which must
+// contain a '.' or '/'. Generators and loaders run on the simulator's thread
+// pool. Returns false for unknown names, throws std::runtime_error if a file
+// can't be read.
+bool loadScenario(Simulator& simulator, const std::string& name, size_t bodyCount, unsigned seed);
+
+#endif //GRAVITY_SCENARIO_H
@@ -0,0 +1,56 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+#include "Shader.h"
+#include <stdexcept>
+#include <string>
+
+namespace {
+    GLuint compileShader(GLenum type, const char* source) {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+
+        GLint status = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (status != GL_TRUE) {
+            GLint length = 0;
+            glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+            std::string log(static_cast<size_t>(length > 0 ? length : 1), '\0');
+            glGetShaderInfoLog(shader, length, nullptr, &log[0]);
+            glDeleteShader(shader);
+            throw std::runtime_error("Failed to compile shader: " + log);
+        }
+        return shader;
+    }
+}
+
+GLuint createShaderProgram(const char* vertexSource, const char* fragmentSource) {
+    GLuint vertex = compileShader(GL_VERTEX_SHADER, vertexSource);
+    GLuint fragment;
+    try {
+        fragment = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    } catch (...) {
+        glDeleteShader(vertex);
+        throw;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::string log(static_cast<size_t>(length > 0 ? length : 1), '\0');
+        glGetProgramInfoLog(program, length, nullptr, &log[0]);
+        glDeleteProgram(program);
+        throw std::runtime_error("Failed to link shader program: " + log);
+    }
+    return program;
+}
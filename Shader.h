@@ -0,0 +1,14 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+
+#ifndef GRAVITY_SHADER_H
+#define GRAVITY_SHADER_H
+#pragma once
+#include <GL/glew.h>
+
+// Compiles and links a vertex and fragment shader into a program. Throws
+// std::runtime_error with the driver's log if either stage fails.
+GLuint createShaderProgram(const char* vertexSource, const char* fragmentSource);
+
+#endif //GRAVITY_SHADER_H
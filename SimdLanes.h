@@ -0,0 +1,175 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+
+#ifndef GRAVITY_SIMDLANES_H
+#define GRAVITY_SIMDLANES_H
+#pragma once
+#include <cstddef>
+#include <type_traits>
+#include "Physics.h"
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// Vector types for the force kernels: ScalarMath plus loads, stores and
+// reductions. DoubleLanes and FloatLanes are as wide as the build's target
+// allows (AVX-512, AVX2, or a single lane without SIMD); SimdLanes<T> picks
+// the one for T.
+
+// One lane: the scalar loop for remainders, and for builds without SIMD
+template<typename T>
+struct ScalarLanes : ScalarMath<T> {
+    static constexpr size_t WIDTH = 1;
+
+    static T load(const T* p) { return *p; }
+    static void store(T* p, T v) { *p = v; }
+    template<typename Position>
+    static T difference(const Position* p, Position origin) { return static_cast<T>(*p - origin); }
+    // p -= a * b
+    template<typename Accumulator>
+    static void subtract(Accumulator* p, T a, T b) { *p -= a * b; }
+    static double sum(T v) { return v; }
+    static unsigned count(bool mask) { return mask; }
+};
+
+// SIMD lanes with the members of ScalarLanes. Float lanes take their
+// separations either from floats or, for mixed precision, as the
+// difference of doubles.
+#if defined(__AVX512F__)
+struct DoubleLanes {
+    using V = __m512d;
+    using Mask = __mmask8;
+    static constexpr size_t WIDTH = 8;
+
+    static V set(double value) { return _mm512_set1_pd(value); }
+    static V add(V a, V b) { return _mm512_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm512_div_pd(a, b); }
+    static V fmadd(V a, V b, V c) { return _mm512_fmadd_pd(a, b, c); }
+    static V sqrt(V a) { return _mm512_sqrt_pd(a); }
+    static V max(V a, V b) { return _mm512_max_pd(a, b); }
+    static V min(V a, V b) { return _mm512_min_pd(a, b); }
+    static Mask less(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+    static V select(Mask mask, V a, V b) { return _mm512_mask_blend_pd(mask, b, a); }
+
+    static V load(const double* p) { return _mm512_loadu_pd(p); }
+    static void store(double* p, V v) { _mm512_storeu_pd(p, v); }
+    static V difference(const double* p, double origin) { return sub(load(p), set(origin)); }
+    static void subtract(double* p, V a, V b) { _mm512_storeu_pd(p, _mm512_fnmadd_pd(a, b, load(p))); }
+    static double sum(V v) { return _mm512_reduce_add_pd(v); }
+    static unsigned count(Mask mask) { return _mm_popcnt_u32(mask); }
+};
+
+struct FloatLanes {
+    using V = __m512;
+    using Mask = __mmask16;
+    static constexpr size_t WIDTH = 16;
+
+    static V set(double value) { return _mm512_set1_ps(static_cast<float>(value)); }
+    static V add(V a, V b) { return _mm512_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm512_div_ps(a, b); }
+    static V fmadd(V a, V b, V c) { return _mm512_fmadd_ps(a, b, c); }
+    static V sqrt(V a) { return _mm512_sqrt_ps(a); }
+    static V max(V a, V b) { return _mm512_max_ps(a, b); }
+    static V min(V a, V b) { return _mm512_min_ps(a, b); }
+    static Mask less(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static V select(Mask mask, V a, V b) { return _mm512_mask_blend_ps(mask, b, a); }
+
+    static V load(const float* p) { return _mm512_loadu_ps(p); }
+    static void store(float* p, V v) { _mm512_storeu_ps(p, v); }
+    static V difference(const float* p, float origin) { return sub(load(p), _mm512_set1_ps(origin)); }
+    static V difference(const double* p, double origin) {
+        const __m512d o = _mm512_set1_pd(origin);
+        const __m256 low = _mm512_cvtpd_ps(_mm512_sub_pd(_mm512_loadu_pd(p), o));
+        const __m256 high = _mm512_cvtpd_ps(_mm512_sub_pd(_mm512_loadu_pd(p + 8), o));
+        return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(low)),
+                                                   _mm256_castps_pd(high), 1));
+    }
+    static void subtract(float* p, V a, V b) { _mm512_storeu_ps(p, _mm512_fnmadd_ps(a, b, load(p))); }
+    static double sum(V v) {
+        const __m512d low = _mm512_cvtps_pd(_mm512_castps512_ps256(v));
+        const __m512d high = _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1)));
+        return _mm512_reduce_add_pd(_mm512_add_pd(low, high));
+    }
+    static unsigned count(Mask mask) { return _mm_popcnt_u32(mask); }
+};
+#elif defined(__AVX2__) && defined(__FMA__)
+inline double horizontalSum(__m256d v) {
+    __m128d low = _mm256_castpd256_pd128(v);
+    __m128d high = _mm256_extractf128_pd(v, 1);
+    low = _mm_add_pd(low, high);
+    return _mm_cvtsd_f64(_mm_add_sd(low, _mm_unpackhi_pd(low, low)));
+}
+
+struct DoubleLanes {
+    using V = __m256d;
+    using Mask = __m256d;
+    static constexpr size_t WIDTH = 4;
+
+    static V set(double value) { return _mm256_set1_pd(value); }
+    static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm256_div_pd(a, b); }
+    static V fmadd(V a, V b, V c) { return _mm256_fmadd_pd(a, b, c); }
+    static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+    static V max(V a, V b) { return _mm256_max_pd(a, b); }
+    static V min(V a, V b) { return _mm256_min_pd(a, b); }
+    static Mask less(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static V select(Mask mask, V a, V b) { return _mm256_blendv_pd(b, a, mask); }
+
+    static V load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, V v) { _mm256_storeu_pd(p, v); }
+    static V difference(const double* p, double origin) { return sub(load(p), set(origin)); }
+    static void subtract(double* p, V a, V b) { _mm256_storeu_pd(p, _mm256_fnmadd_pd(a, b, load(p))); }
+    static double sum(V v) { return horizontalSum(v); }
+    static unsigned count(Mask mask) { return _mm_popcnt_u32(_mm256_movemask_pd(mask)); }
+};
+
+struct FloatLanes {
+    using V = __m256;
+    using Mask = __m256;
+    static constexpr size_t WIDTH = 8;
+
+    static V set(double value) { return _mm256_set1_ps(static_cast<float>(value)); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm256_div_ps(a, b); }
+    static V fmadd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+    static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+    static V max(V a, V b) { return _mm256_max_ps(a, b); }
+    static V min(V a, V b) { return _mm256_min_ps(a, b); }
+    static Mask less(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static V select(Mask mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+
+    static V load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, V v) { _mm256_storeu_ps(p, v); }
+    static V difference(const float* p, float origin) { return sub(load(p), _mm256_set1_ps(origin)); }
+    static V difference(const double* p, double origin) {
+        const __m256d o = _mm256_set1_pd(origin);
+        const __m128 low = _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_loadu_pd(p), o));
+        const __m128 high = _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_loadu_pd(p + 4), o));
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+    }
+    static void subtract(float* p, V a, V b) { _mm256_storeu_ps(p, _mm256_fnmadd_ps(a, b, load(p))); }
+    static double sum(V v) {
+        const __m256d low = _mm256_cvtps_pd(_mm256_castps256_ps128(v));
+        const __m256d high = _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1));
+        return horizontalSum(_mm256_add_pd(low, high));
+    }
+    static unsigned count(Mask mask) { return _mm_popcnt_u32(_mm256_movemask_ps(mask)); }
+};
+#else
+using DoubleLanes = ScalarLanes<double>;
+using FloatLanes = ScalarLanes<float>;
+#endif
+
+template<typename T>
+using SimdLanes = std::conditional_t<std::is_same_v<T, double>, DoubleLanes, FloatLanes>;
+
+#endif //GRAVITY_SIMDLANES_H
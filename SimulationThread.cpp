@@ -0,0 +1,93 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+#include "SimulationThread.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+
+SimulationThread::SimulationThread(Simulator& simulator, double dt) : simulator(simulator), dt(dt) {}
+
+SimulationThread::~SimulationThread() {
+    stop();
+}
+
+void SimulationThread::start() {
+    if (running) return;
+    publish();
+    running = true;
+    thread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop() {
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+const Snapshot& SimulationThread::latest() {
+    snapshots.update();
+    return snapshots.front();
+}
+
+void SimulationThread::run() {
+    Profiler::setThreadName("simulation");
+    using Clock = std::chrono::steady_clock;
+    auto last = Clock::now();
+    double due = 0.0;  // Simulated time owed to the wall clock
+    while (running) {
+        const auto roundStart = Clock::now();
+        const double interval = publishInterval;
+        const double scale = timeScale;
+        due += std::chrono::duration<double>(roundStart - last).count() * scale;
+        last = roundStart;
+
+        const auto deadline = roundStart + std::chrono::duration<double>(interval);
+        size_t steps = 0;
+        while (due >= dt && running) {
+            simulator.update(dt);
+            due -= dt;
+            ++steps;
+            if (Clock::now() >= deadline) break;
+        }
+        if (steps > 0) {
+            publish();
+        }
+        // Still a step behind after a full round: the machine can't keep up,
+        // so drop the backlog rather than chase it
+        due = std::min(due, dt);
+
+        double wait = scale > 0.0 ? std::min((dt - due) / scale, interval) : interval;
+        if (wait > 0.0) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+        }
+    }
+}
+
+void SimulationThread::publish() {
+    PROFILE_SCOPE("publish");
+    Snapshot& snapshot = snapshots.back();
+    const BodyStore& bodies = simulator.getBodies();
+    const size_t n = bodies.size();
+    snapshot.sequence = ++sequence;
+    snapshot.time = simulator.getTime();
+    snapshot.position.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        snapshot.position[i] = bodies.getPosition(i);
+    }
+    snapshot.mass.assign(bodies.mass.begin(), bodies.mass.end());
+    snapshot.id.assign(bodies.id.begin(), bodies.id.end());
+
+    snapshot.trajectoryPoints.clear();
+    snapshot.trajectoryStart.clear();
+    if (captureTrajectories) {
+        snapshot.trajectoryStart.reserve(n + 1);
+        for (size_t i = 0; i < n; ++i) {
+            snapshot.trajectoryStart.push_back(snapshot.trajectoryPoints.size());
+            bodies.trajectory.copy(i, snapshot.trajectoryPoints);
+        }
+        snapshot.trajectoryStart.push_back(snapshot.trajectoryPoints.size());
+    }
+    snapshots.publish();
+}
@@ -0,0 +1,77 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+
+#ifndef GRAVITY_SIMULATIONTHREAD_H
+#define GRAVITY_SIMULATIONTHREAD_H
+#pragma once
+#include <glm/glm.hpp>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "Simulator.h"
+#include "TripleBuffer.h"
+
+// Copy of the state the renderer needs, taken between steps
+struct Snapshot {
+    uint64_t sequence = 0;  // Increases with every published state
+    double time = 0.0;
+    std::vector<glm::dvec3> position;
+    std::vector<double> mass;
+    std::vector<uint64_t> id;
+    // Every body's trajectory, oldest first: body i owns points
+    // [trajectoryStart[i], trajectoryStart[i + 1]). Empty unless requested.
+    std::vector<glm::vec3> trajectoryPoints;
+    std::vector<size_t> trajectoryStart;
+
+    size_t size() const { return mass.size(); }
+    bool empty() const { return mass.empty(); }
+    bool hasTrajectories() const { return !trajectoryStart.empty(); }
+};
+
+// Runs a Simulator on its own thread. Simulated time follows wall time at a
+// set ratio: each round takes as many fixed steps as are due, for at most
+// one publish interval of wall time, then publishes a snapshot. When the
+// steps can't keep up, the simulation runs slower than the ratio instead of
+// building an ever growing backlog.
+//
+// While running, the simulator belongs to this thread. Other threads only
+// see it through latest().
+class SimulationThread {
+public:
+    SimulationThread(Simulator& simulator, double dt);
+    ~SimulationThread();
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    void start();
+    void stop();
+
+    // Simulated seconds per wall second, 0 pauses
+    void setTimeScale(double scale) { timeScale = scale; }
+    double getTimeScale() const { return timeScale; }
+    // Wall time budget of one round of steps, and the interval between snapshots
+    void setPublishInterval(double seconds) { publishInterval = seconds; }
+    // Also copy trajectories into the snapshots (off by default)
+    void setCaptureTrajectories(bool capture) { captureTrajectories = capture; }
+
+    // The newest published state. Never blocks. Only one thread may call it,
+    // and the reference stays valid until its next call.
+    const Snapshot& latest();
+
+private:
+    Simulator& simulator;
+    const double dt;
+    std::atomic<double> timeScale{1.0};
+    std::atomic<double> publishInterval{1.0 / 60.0};
+    std::atomic<bool> captureTrajectories{false};
+    std::atomic<bool> running{false};
+    std::thread thread;
+    TripleBuffer<Snapshot> snapshots;
+    uint64_t sequence = 0;
+
+    void run();
+    void publish();
+};
+#endif //GRAVITY_SIMULATIONTHREAD_H
@@ -2,102 +2,596 @@
 // Created by Quinta on 7/12/2024.
 //
 #include "Simulator.h"
+#include "ForceKernels.h"
+#include "Physics.h"
+#include "Profiler.h"
+#include "StateStream.h"
 #include <glm/glm.hpp>
-#include <iostream>
 #include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
 
 Simulator::Simulator() {}
 
+namespace {
+    // Kick-drift-kick splitting coefficients. A step alternates kicks and drifts,
+    // starting and ending with a kick; the closing kick's forces are reused by
+    // the next step's opening kick, so each drift costs one force evaluation.
+    struct SplittingScheme {
+        std::vector<double> kicks;
+        std::vector<double> drifts;
+    };
+
+    const SplittingScheme& splittingScheme(Integrator integrator) {
+        static const SplittingScheme leapfrog{{0.5, 0.5}, {1.0}};
+        // Yoshida (1990): w1 = 1 / (2 - 2^(1/3)), w0 = 1 - 2 w1
+        static const double w1 = 1.0 / (2.0 - std::cbrt(2.0));
+        static const double w0 = 1.0 - 2.0 * w1;
+        static const SplittingScheme yoshida4{{w1 / 2.0, (w0 + w1) / 2.0, (w0 + w1) / 2.0, w1 / 2.0}, {w1, w0, w1}};
+        return integrator == Integrator::Yoshida4 ? yoshida4 : leapfrog;
+    }
+}
+
 void Simulator::addBody(const CelestialBody& body) {
-    bodies.push_back(body);
+    bodies.add(body);
+    // New bodies start on the finest level and coarsen once their forces are known
+    bodies.level.back() = static_cast<uint8_t>(maxLevel);
+    massOrderDirty = true;
+    accelerationsValid = false;
+}
+
+void Simulator::addBodies(const BodyTable& table) {
+    const size_t first = bodies.size();
+    bodies.append(table);
+    std::fill(bodies.level.begin() + first, bodies.level.end(), static_cast<uint8_t>(maxLevel));
+    massOrderDirty = true;
+    accelerationsValid = false;
+}
+
+void Simulator::setIntegrator(Integrator scheme) {
+    integrator = scheme;
+    accelerationsValid = false;
+}
+
+void Simulator::setBlockTimesteps(bool enabled, int levels, double eta) {
+    blockTimesteps = enabled;
+    maxLevel = std::clamp(levels, 0, 30);
+    timestepAccuracy = eta;
+    std::fill(bodies.level.begin(), bodies.level.end(), static_cast<uint8_t>(maxLevel));
+}
+
+void Simulator::setOutput(StateStream* stream, size_t interval) {
+    output = stream;
+    outputInterval = std::max<size_t>(interval, 1);
+    stepsSinceOutput = 0;
+}
+
+void Simulator::setThreadCount(size_t threads) {
+    if (threads == getThreadCount()) return;
+    pool = threads > 1 ? std::make_unique<ThreadPool>(threads) : nullptr;
+}
+
+void Simulator::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+    if (pool) {
+        pool->parallelFor(count, grain, body);
+    } else if (count > 0) {
+        body(0, count);
+    }
 }
 
 void Simulator::update(double dt) {
+    PROFILE_SCOPE("Simulator::update");
+    const EventCounts eventsBefore = events.getCounts();
     // Sort bodies by mass (descending order)
-    std::sort(bodies.begin(), bodies.end(), [](const CelestialBody& a, const CelestialBody& b) {
-        return a.getMass() > b.getMass();
+    if (massOrderDirty) {
+        sortByMass();
+    }
+    potentialCurrent = false;
+    if (conservationInterval > 0 && !hasConservationReference) {
+        conservationReference = conservation = sampleConservation();
+        conservationDrift = ConservationDrift();
+        hasConservationReference = true;
+    }
+    const bool conservationDue = conservationInterval > 0 && ++stepsSinceConservation >= conservationInterval;
+
+    // Calculate forces and update positions and velocities
+    potentialWanted = conservationDue;
+    integrate(dt);
+    time += dt;
+    if (conservationDue) {
+        stepsSinceConservation = 0;
+        checkConservation();
+    }
+    potentialWanted = false;
+
+    {
+        PROFILE_SCOPE("trajectories");
+        bodies.trajectory.fitToBudget();
+        const size_t first = pinHeaviestBody ? 1 : 0;
+        parallelFor(bodies.size(), 4096, [this, first](size_t begin, size_t end) {
+            for (size_t i = std::max(begin, first); i < end; ++i) {
+                bodies.addToTrajectory(i, bodies.getPosition(i));
+            }
+        });
+    }
+
+    // Check for collisions
+    checkCollisions();
+
+    if (output && ++stepsSinceOutput >= outputInterval) {
+        PROFILE_SCOPE("output");
+        stepsSinceOutput = 0;
+        output->record(*this);
+    }
+    stepEvents = events.getCounts() - eventsBefore;
+    PROFILE_SAMPLE_COUNTERS();
+}
+
+void Simulator::setConservationChecks(size_t interval, double threshold) {
+    conservationInterval = interval;
+    driftThreshold = threshold;
+    stepsSinceConservation = 0;
+    hasConservationReference = false;
+}
+
+// The integrators end a step with a force evaluation at the final positions,
+// which sums the potential when it is wanted. Only the constant-acceleration
+// scheme evaluates before it moves the bodies, and pays for one more here.
+ConservationSample Simulator::sampleConservation() {
+    PROFILE_SCOPE("conservation");
+    if (!potentialCurrent) {
+        potentialWanted = true;
+        computeAccelerations();
+    }
+    const bool pinned = pinHeaviestBody && !bodies.empty();
+    const glm::dvec3 pivot = pinned ? bodies.getPosition(0) : glm::dvec3(0.0);
+    return measureConservation(bodies, potentialEnergy, time, pivot, pinned, pool.get());
+}
+
+void Simulator::checkConservation() {
+    conservation = sampleConservation();
+    conservationDrift = ::conservationDrift(conservationReference, conservation);
+    if (driftThreshold <= 0.0) return;
+    const bool pinned = pinHeaviestBody && !bodies.empty();
+    auto check = [this](ConservedQuantity quantity, double drift) {
+        if (drift > driftThreshold) {
+            events.post({EventType::ConservationDrift, time, static_cast<uint64_t>(quantity), 0, drift});
+        }
+    };
+    check(ConservedQuantity::Energy, conservationDrift.energy);
+    check(ConservedQuantity::AngularMomentum, conservationDrift.angularMomentum);
+    if (!pinned) {
+        check(ConservedQuantity::Momentum, conservationDrift.momentum);
+        check(ConservedQuantity::CenterOfMass, conservationDrift.centerOfMass);
+    }
+}
+
+void Simulator::sortByMass() {
+    PROFILE_SCOPE("sortByMass");
+    std::vector<size_t> order(bodies.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return bodies.mass[a] > bodies.mass[b];
     });
+    bodies.permute(order);
+    massOrderDirty = false;
+}
 
-    // Calculate and apply gravitational forces
-    for (size_t i = 0; i < bodies.size(); ++i) {
-        glm::vec3 totalForce(0.0f);
-        for (size_t j = 0; j < bodies.size(); ++j) {
-            if (i != j) {
-                glm::vec3 force = calculateGravitationalForce(bodies[i], bodies[j]);
-                totalForce += force;
+void Simulator::integrate(double dt) {
+    PROFILE_SCOPE("integrate");
+    if (integrator == Integrator::ConstantAcceleration) {
+        computeAccelerations();
+        const size_t first = pinHeaviestBody ? 1 : 0;
+        parallelFor(bodies.size(), 4096, [this, dt, first](size_t begin, size_t end) {
+            for (size_t i = std::max(begin, first); i < end; ++i) {
+                bodies.x[i] += (bodies.vx[i] + 0.5 * bodies.ax[i] * dt) * dt;
+                bodies.y[i] += (bodies.vy[i] + 0.5 * bodies.ay[i] * dt) * dt;
+                bodies.z[i] += (bodies.vz[i] + 0.5 * bodies.az[i] * dt) * dt;
+                bodies.vx[i] += bodies.ax[i] * dt;
+                bodies.vy[i] += bodies.ay[i] * dt;
+                bodies.vz[i] += bodies.az[i] * dt;
+            }
+        });
+        accelerationsValid = false;
+        potentialCurrent = false;
+        return;
+    }
+    if (blockTimesteps && integrator == Integrator::Leapfrog) {
+        integrateBlocks(dt);
+        return;
+    }
+
+    const SplittingScheme& scheme = splittingScheme(integrator);
+    if (!accelerationsValid) {
+        computeAccelerations();
+    }
+    for (size_t stage = 0; stage < scheme.drifts.size(); ++stage) {
+        kick(scheme.kicks[stage] * dt);
+        drift(scheme.drifts[stage] * dt);
+        computeAccelerations();
+    }
+    kick(scheme.kicks.back() * dt);
+}
+
+// Kick-drift-kick where body i steps with dt / 2^level[i]. The block is walked
+// from one step boundary to the next: everything drifts, the bodies whose step
+// ends there get new forces and their closing half kick, pick a new level, and
+// open their next step with another half kick. Every level divides the block,
+// so all bodies are synchronised again when it ends.
+void Simulator::integrateBlocks(double dt) {
+    const size_t n = bodies.size();
+    const size_t first = pinHeaviestBody ? 1 : 0;
+    const uint64_t substeps = uint64_t(1) << maxLevel;
+    const double unit = dt / static_cast<double>(substeps);
+    auto stepOf = [this, substeps, unit](size_t i) {
+        return static_cast<double>(substeps >> bodies.level[i]) * unit;
+    };
+
+    if (!accelerationsValid) {
+        computeAccelerations();
+    }
+    std::vector<size_t> levelCount(maxLevel + 1, 0);
+    for (size_t i = first; i < n; ++i) {
+        bodies.level[i] = std::min<uint8_t>(bodies.level[i], static_cast<uint8_t>(maxLevel));
+        ++levelCount[bodies.level[i]];
+        double half = 0.5 * stepOf(i);
+        bodies.vx[i] += bodies.ax[i] * half;
+        bodies.vy[i] += bodies.ay[i] * half;
+        bodies.vz[i] += bodies.az[i] * half;
+    }
+
+    std::vector<size_t> active;
+    std::vector<glm::dvec3> previous;
+    uint64_t substep = 0;
+    while (substep < substeps) {
+        // The next boundary is the nearest one among the levels in use
+        uint64_t next = substeps;
+        for (int k = 0; k <= maxLevel; ++k) {
+            if (levelCount[k] == 0) continue;
+            uint64_t period = substeps >> k;
+            next = std::min(next, (substep / period + 1) * period);
+        }
+        drift(static_cast<double>(next - substep) * unit);
+        substep = next;
+
+        active.clear();
+        previous.clear();
+        for (size_t i = first; i < n; ++i) {
+            if (substep % (substeps >> bodies.level[i]) == 0) {
+                active.push_back(i);
+                previous.push_back(bodies.getAcceleration(i));
             }
         }
-        bodies[i].applyForce(totalForce);
+        if (active.size() + first == n) {
+            computeAccelerations();
+        } else {
+            computeAccelerations(active);
+        }
+
+        parallelFor(active.size(), 256, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                const size_t i = active[k];
+                double half = 0.5 * stepOf(i);
+                int level = chooseLevel(i, previous[k], substep);
+                if (substep < substeps) {
+                    half += 0.5 * static_cast<double>(substeps >> level) * unit;
+                }
+                bodies.vx[i] += bodies.ax[i] * half;
+                bodies.vy[i] += bodies.ay[i] * half;
+                bodies.vz[i] += bodies.az[i] * half;
+                bodies.level[i] = static_cast<uint8_t>(level);
+            }
+        });
+        std::fill(levelCount.begin(), levelCount.end(), 0);
+        for (size_t i = first; i < n; ++i) {
+            ++levelCount[bodies.level[i]];
+        }
     }
+    accelerationsValid = true;
+}
 
-    // Update positions and velocities
-    for (size_t i = 1; i < bodies.size(); ++i) { // Start from 1 to skip the Sun
-        bodies[i].update(dt);
-        bodies[i].addToTrajectory(bodies[i].getPosition());
+// Smallest level whose step satisfies dt_i < eta |a| / |da/dt|, with the jerk
+// taken from the change in acceleration over the step just finished. A body
+// may refine freely but coarsens one level at a time, and only onto a
+// boundary of the coarser level so it stays in step with the block.
+int Simulator::chooseLevel(size_t i, const glm::dvec3& previousAcceleration, uint64_t substep) const {
+    const uint64_t substeps = uint64_t(1) << maxLevel;
+    const int current = bodies.level[i];
+    glm::dvec3 acceleration = bodies.getAcceleration(i);
+    double elapsed = static_cast<double>(substeps >> current);
+    double jerk = glm::length(acceleration - previousAcceleration) / elapsed;
+    double limit = jerk > 0.0 ? timestepAccuracy * glm::length(acceleration) / jerk
+                              : static_cast<double>(substeps);
+
+    int level = 0;
+    while (level < maxLevel && static_cast<double>(substeps >> level) > limit) {
+        ++level;
+    }
+    level = std::max(level, current - 1);
+    while (level < current && substep % (substeps >> level) != 0) {
+        ++level;
     }
+    return level;
+}
 
-    // Check for collisions
-    checkCollisions();
+void Simulator::kick(double dt) {
+    const size_t first = pinHeaviestBody ? 1 : 0;
+    parallelFor(bodies.size(), 4096, [this, dt, first](size_t begin, size_t end) {
+        for (size_t i = std::max(begin, first); i < end; ++i) {
+            bodies.vx[i] += bodies.ax[i] * dt;
+            bodies.vy[i] += bodies.ay[i] * dt;
+            bodies.vz[i] += bodies.az[i] * dt;
+        }
+    });
+}
+
+void Simulator::drift(double dt) {
+    potentialCurrent = false;
+    const size_t first = pinHeaviestBody ? 1 : 0;
+    parallelFor(bodies.size(), 4096, [this, dt, first](size_t begin, size_t end) {
+        for (size_t i = std::max(begin, first); i < end; ++i) {
+            bodies.x[i] += bodies.vx[i] * dt;
+            bodies.y[i] += bodies.vy[i] * dt;
+            bodies.z[i] += bodies.vz[i] * dt;
+        }
+    });
+}
+
+void Simulator::setOpeningAngle(double theta) {
+    octree.setOpeningAngle(theta);
+    multipole.setOpeningAngle(theta);
+    accelerationsValid = false;
+}
+
+double Simulator::getOpeningAngle() const {
+    return forceSolver == ForceSolver::FastMultipole ? multipole.getOpeningAngle() : octree.getOpeningAngle();
+}
+
+void Simulator::computeAccelerations() {
+    PROFILE_SCOPE("forces");
+    bodies.clearAccelerations();
+    double* potential = potentialWanted ? &potentialEnergy : nullptr;
+    if (forceSolver == ForceSolver::FastMultipole) {
+        multipole.computeAccelerations(bodies, pool.get(), potential);
+    } else if (forceSolver == ForceSolver::ParticleMesh) {
+        mesh.solve(bodies, pool.get());
+        mesh.computeAccelerations(bodies, pool.get(), potential);
+    } else if (forceSolver == ForceSolver::BarnesHut) {
+        {
+            PROFILE_SCOPE("octree build");
+            octree.build(bodies);
+        }
+        bodyPotentials.resize(potential ? bodies.size() : 0);
+        octree.computeAccelerations(bodies, bodies.size(), pool.get(), potential ? bodyPotentials.data() : nullptr);
+        if (potential) {
+            // Every pair is in both bodies' potentials
+            *potential = 0.0;
+            for (size_t i = 0; i < bodies.size(); ++i) {
+                *potential += 0.5 * bodies.mass[i] * bodyPotentials[i];
+            }
+        }
+    } else {
+        accumulatePairwiseAccelerations(bodies, pool.get(), potential);
+        PROFILE_COUNT(PairInteractions, bodies.size() * (bodies.size() - 1) / 2);
+    }
+    potentialCurrent = potentialWanted;
+    parallelFor(bodies.size(), 4096, [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            rejectNonFiniteForce(i);
+        }
+    });
+    forceEvaluations += bodies.size();
+    accelerationsValid = true;
+}
+
+// The multipole solver has no per-body evaluation, so it computes the whole
+// field and keeps only the targets' share. The mesh still needs every body's
+// mass, but only the targets are read back from it.
+void Simulator::computeAccelerations(const std::vector<size_t>& targets) {
+    PROFILE_SCOPE("forces");
+    if (forceSolver == ForceSolver::FastMultipole) {
+        multipole.computeAccelerations(bodies, targets, pool.get());
+    } else if (forceSolver == ForceSolver::ParticleMesh) {
+        mesh.solve(bodies, pool.get());
+        mesh.computeAccelerations(bodies, targets, pool.get());
+    } else if (forceSolver == ForceSolver::BarnesHut) {
+        {
+            PROFILE_SCOPE("octree build");
+            octree.build(bodies);
+        }
+        parallelFor(targets.size(), 256, [this, &targets](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                glm::dvec3 acceleration = octree.computeAcceleration(targets[k]);
+                bodies.ax[targets[k]] = acceleration.x;
+                bodies.ay[targets[k]] = acceleration.y;
+                bodies.az[targets[k]] = acceleration.z;
+            }
+        });
+    } else {
+        computePairwiseAccelerations(bodies, targets, pool.get());
+        PROFILE_COUNT(PairInteractions, targets.size() * (bodies.size() - 1));
+    }
+    for (size_t i : targets) {
+        rejectNonFiniteForce(i);
+    }
+    forceEvaluations += targets.size();
+}
+
+// A NaN or infinite acceleration would spread to every body it touches in
+// the next steps, so it is dropped and reported instead
+void Simulator::rejectNonFiniteForce(size_t index) {
+    if (std::isfinite(bodies.ax[index]) && std::isfinite(bodies.ay[index]) && std::isfinite(bodies.az[index])) {
+        return;
+    }
+    bodies.ax[index] = bodies.ay[index] = bodies.az[index] = 0.0;
+    events.post({EventType::NonFiniteForce, time, bodies.id[index], 0, 0.0});
+}
+
+ForceError Simulator::checkForces(size_t sampleSize, unsigned seed) {
+    ForceError error{0, 0.0, 0.0, 0.0};
+    const size_t n = bodies.size();
+    if (n < 2 || sampleSize == 0) return error;
+
+    std::vector<size_t> sample;
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> pick(0, n - 1);
+    for (size_t k = 0; k < std::min(sampleSize, n); ++k) {
+        sample.push_back(pick(rng));
+    }
+    std::sort(sample.begin(), sample.end());
+    sample.erase(std::unique(sample.begin(), sample.end()), sample.end());
+
+    // The integrators reuse the current accelerations, so put them back afterwards
+    const std::vector<double> ax = bodies.ax, ay = bodies.ay, az = bodies.az;
+    const uint64_t evaluations = forceEvaluations;
+    const bool valid = accelerationsValid;
+
+    computeAccelerations();
+    std::vector<glm::dvec3> approximate;
+    for (size_t i : sample) {
+        approximate.push_back(bodies.getAcceleration(i));
+    }
+    computePairwiseAccelerations(bodies, sample, pool.get());
+
+    double squared = 0.0, difference = 0.0, magnitude = 0.0;
+    for (size_t k = 0; k < sample.size(); ++k) {
+        const glm::dvec3 exact = bodies.getAcceleration(sample[k]);
+        const double delta = glm::length(approximate[k] - exact);
+        const double size = glm::length(exact);
+        difference += delta * delta;
+        magnitude += size * size;
+        if (size > 0.0) {
+            squared += (delta / size) * (delta / size);
+            error.max = std::max(error.max, delta / size);
+        }
+    }
+    error.samples = sample.size();
+    error.rms = std::sqrt(squared / static_cast<double>(sample.size()));
+    error.normalized = magnitude > 0.0 ? std::sqrt(difference / magnitude) : 0.0;
+
+    bodies.ax = ax;
+    bodies.ay = ay;
+    bodies.az = az;
+    forceEvaluations = evaluations;
+    accelerationsValid = valid;
+    return error;
 }
 
 glm::dvec3 Simulator::calculateGravitationalForce(const CelestialBody& body1, const CelestialBody& body2) {
     glm::dvec3 direction = body2.getPosition() - body1.getPosition();
-    double distance = glm::length(direction);
+    double distance2 = glm::dot(direction, direction);
 
-    // Avoid division by zero and unrealistic forces at very small distances
-    if (distance < 1e9) {
-        std::cout << "Warning: Bodies too close, using minimum distance" << std::endl;
-        distance = 1e9;
+    // Avoid unrealistic forces at very small distances
+    PROFILE_COUNT(PairInteractions, 1);
+    if (distance2 < NEWTONIAN_DISTANCE * NEWTONIAN_DISTANCE) {
+        PROFILE_COUNT(SoftenedTerms, 1);
+        events.post({EventType::SoftenedForce, time, 0, 0, std::sqrt(distance2)});
     }
 
-    // Use the actual G value
-    const double G = 6.67430e-11;
-    double forceMagnitude = G * (body1.getMass() * body2.getMass()) / (distance * distance);
-
-    if (std::isnan(forceMagnitude) || std::isinf(forceMagnitude)) {
+    glm::dvec3 force = direction * (G * body1.getMass() * body2.getMass() * softenedInverseCube(distance2));
+    if (!std::isfinite(force.x) || !std::isfinite(force.y) || !std::isfinite(force.z)) {
+        events.post({EventType::NonFiniteForce, time, NO_BODY, 0, std::sqrt(distance2)});
         return glm::dvec3(0.0);
     }
-
-    return glm::normalize(direction) * forceMagnitude;
+    return force;
 }
 
-void Simulator::handleCollision(CelestialBody& body1, CelestialBody& body2) {
-    double totalMass = body1.getMass() + body2.getMass();
+// Merges body index2 into body index1 in place. index2 is left for the caller
+// to drop, so indices stay valid while a batch of merges is applied.
+void Simulator::handleCollision(size_t index1, size_t index2) {
+    double mass1 = bodies.mass[index1];
+    double mass2 = bodies.mass[index2];
+    double totalMass = mass1 + mass2;
 
     // Calculate center of mass position
-    glm::dvec3 newPosition = (body1.getPosition() * body1.getMass() + body2.getPosition() * body2.getMass()) / totalMass;
+    glm::dvec3 newPosition = (bodies.getPosition(index1) * mass1 + bodies.getPosition(index2) * mass2) / totalMass;
 
     // Calculate new velocity (momentum conservation)
-    glm::dvec3 newVelocity = (body1.getVelocity() * body1.getMass() + body2.getVelocity() * body2.getMass()) / totalMass;
+    glm::dvec3 newVelocity = (bodies.getVelocity(index1) * mass1 + bodies.getVelocity(index2) * mass2) / totalMass;
 
     // Calculate new radius (assuming constant density)
-    double newRadius = std::pow(std::pow(body1.getRadius(), 3) + std::pow(body2.getRadius(), 3), 1.0/3.0);
+    double newRadius = std::pow(std::pow(bodies.radius[index1], 3) + std::pow(bodies.radius[index2], 3), 1.0/3.0);
 
-    // Create new body
-    CelestialBody newBody(totalMass, newPosition, newVelocity, newRadius);
+    // Replace body1 with the merged body
+    bodies.set(index1, CelestialBody(totalMass, newPosition, newVelocity, newRadius));
+    bodies.level[index1] = std::max(bodies.level[index1], bodies.level[index2]);
+}
 
-    // Replace body1 with the new body
-    body1 = newBody;
+// Sweep and prune along x: bodies i and j can only overlap if their x
+// coordinates are within r_i + r_j <= r_i + maxRadius, so each body only looks
+// at the slice of the x-sorted list within that distance. Pairs are then
+// handled in the same order as the all-pairs loop, i ascending and j > i
+// ascending, each against the current state of the growing body i. Absorbed
+// bodies are only marked, and dropped together in one pass at the end.
+void Simulator::checkCollisions() {
+    PROFILE_SCOPE("checkCollisions");
+    const size_t n = bodies.size();
+    collisionTests = 0;
+    if (n < 2) return;
 
-    // Remove body2
-    auto it = std::find_if(bodies.begin(), bodies.end(), [&body2](const CelestialBody& b) {
-        return &b == &body2;
-    });
-    if (it != bodies.end()) {
-        bodies.erase(it);
+    std::vector<std::pair<double, size_t>> sorted(n);
+    double maxRadius = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        sorted[i] = {bodies.x[i], i};
+        maxRadius = std::max(maxRadius, bodies.radius[i]);
     }
-}
+    std::sort(sorted.begin(), sorted.end());
 
-void Simulator::checkCollisions() {
-    for (size_t i = 0; i < bodies.size(); ++i) {
-        for (size_t j = i + 1; j < bodies.size(); ++j) {
-            CelestialBody& body1 = bodies[i];
-            CelestialBody& body2 = bodies[j];
-            glm::dvec3 distanceVec = body1.getPosition() - body2.getPosition();
-            double distance = glm::length(distanceVec);
-            if (distance < (body1.getRadius() + body2.getRadius())) {
-                handleCollision(body1, body2);
+    // Only bodies that have not been body i yet are looked up, and those have
+    // not moved, so the sorted list stays valid while merges happen
+    std::vector<char> absorbed(n, 0);
+    std::vector<size_t> candidates;
+    bool anyMerged = false;
+    uint64_t tests = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (absorbed[i]) continue;
+        size_t after = i;  // Only pairs (i, j > after) are left to test
+        bool merged = true;
+        while (merged) {
+            merged = false;
+            double reach = std::max(bodies.radius[i] + maxRadius, encounterDistance);
+            auto lower = std::lower_bound(sorted.begin(), sorted.end(), std::make_pair(bodies.x[i] - reach, size_t(0)));
+            candidates.clear();
+            for (auto it = lower; it != sorted.end() && it->first <= bodies.x[i] + reach; ++it) {
+                if (it->second > after && !absorbed[it->second]) {
+                    candidates.push_back(it->second);
+                }
+            }
+            std::sort(candidates.begin(), candidates.end());
+
+            for (size_t j : candidates) {
+                ++tests;
+                glm::dvec3 distanceVec = bodies.getPosition(i) - bodies.getPosition(j);
+                double distance = glm::length(distanceVec);
+                if (distance < (bodies.radius[i] + bodies.radius[j])) {
+                    events.post({EventType::Merge, time, bodies.id[i], bodies.id[j], bodies.mass[j]});
+                    handleCollision(i, j);
+                    PROFILE_COUNT(Merges, 1);
+                    absorbed[j] = 1;
+                    maxRadius = std::max(maxRadius, bodies.radius[i]);
+                    // Body i moved and grew, so find its neighbours again
+                    after = j;
+                    merged = true;
+                    anyMerged = true;
+                    break;
+                }
+                if (distance < encounterDistance) {
+                    events.post({EventType::CloseEncounter, time, bodies.id[i], bodies.id[j], distance});
+                }
             }
         }
     }
-}
\ No newline at end of file
+    PROFILE_COUNT(CollisionTests, tests);
+    collisionTests = tests;
+    if (!anyMerged) return;
+
+    std::vector<size_t> survivors;
+    survivors.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (!absorbed[i]) survivors.push_back(i);
+    }
+    bodies.permute(survivors);
+    massOrderDirty = true;
+    accelerationsValid = false;
+}
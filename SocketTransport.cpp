@@ -0,0 +1,179 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+#include "Transport.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    std::runtime_error systemError(const std::string& what) {
+        return std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    // One peer's half of an exchange
+    struct Transfer {
+        char header[8];
+        size_t headerSent = 0;
+        size_t sent = 0;
+        char incomingHeader[8];
+        size_t headerReceived = 0;
+        size_t received = 0;
+        bool sizeKnown = false;
+
+        bool sending(const Transport::Message& message) const { return sent < message.size() || headerSent < 8; }
+        bool receiving(const Transport::Message& message) const {
+            return !sizeKnown || received < message.size();
+        }
+    };
+}
+
+std::unique_ptr<SocketTransport> SocketTransport::fork(size_t processCount) {
+    processCount = std::max<size_t>(processCount, 1);
+    // sockets[a][b] is a's end of the pair between a and b
+    std::vector<std::vector<int>> sockets(processCount, std::vector<int>(processCount, -1));
+    for (size_t a = 0; a < processCount; ++a) {
+        for (size_t b = a + 1; b < processCount; ++b) {
+            int pair[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+                throw systemError("Cannot create a socket pair");
+            }
+            sockets[a][b] = pair[0];
+            sockets[b][a] = pair[1];
+        }
+    }
+
+    std::vector<int> children;
+    size_t rank = 0;
+    for (size_t r = 1; r < processCount; ++r) {
+        const pid_t pid = ::fork();
+        if (pid < 0) {
+            throw systemError("Cannot fork worker " + std::to_string(r));
+        }
+        if (pid == 0) {
+            rank = r;
+            children.clear();
+            break;
+        }
+        children.push_back(static_cast<int>(pid));
+    }
+
+    // Keep this rank's ends, close everything else
+    for (size_t a = 0; a < processCount; ++a) {
+        for (size_t b = 0; b < processCount; ++b) {
+            if (a != rank && sockets[a][b] >= 0) {
+                close(sockets[a][b]);
+            }
+        }
+    }
+    std::vector<int> peers = sockets[rank];
+    for (int socket : peers) {
+        if (socket >= 0) {
+            fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK);
+        }
+    }
+    return std::unique_ptr<SocketTransport>(new SocketTransport(rank, processCount, std::move(peers),
+                                                                std::move(children)));
+}
+
+SocketTransport::SocketTransport(size_t rank, size_t processCount, std::vector<int> peers, std::vector<int> children)
+        : Transport(rank, processCount), peers(std::move(peers)), children(std::move(children)) {}
+
+SocketTransport::~SocketTransport() {
+    for (int socket : peers) {
+        if (socket >= 0) close(socket);
+    }
+    for (int child : children) {
+        waitpid(child, nullptr, 0);
+    }
+}
+
+std::vector<Transport::Message> SocketTransport::exchange(std::vector<Message> outgoing) {
+    const size_t count = getProcessCount();
+    if (outgoing.size() != count) {
+        throw std::runtime_error("exchange needs one message per rank");
+    }
+    std::vector<Message> incoming(count);
+    incoming[getRank()] = std::move(outgoing[getRank()]);
+
+    std::vector<Transfer> transfers(count);
+    for (size_t q = 0; q < count; ++q) {
+        const uint64_t size = outgoing[q].size();
+        std::memcpy(transfers[q].header, &size, 8);
+    }
+
+    std::vector<pollfd> polls;
+    std::vector<size_t> rankOf;
+    for (;;) {
+        polls.clear();
+        rankOf.clear();
+        for (size_t q = 0; q < count; ++q) {
+            if (q == getRank()) continue;
+            short events = 0;
+            if (transfers[q].sending(outgoing[q])) events |= POLLOUT;
+            if (transfers[q].receiving(incoming[q])) events |= POLLIN;
+            if (events) {
+                polls.push_back(pollfd{peers[q], events, 0});
+                rankOf.push_back(q);
+            }
+        }
+        if (polls.empty()) break;
+        if (poll(polls.data(), polls.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            throw systemError("Exchange failed");
+        }
+
+        for (size_t k = 0; k < polls.size(); ++k) {
+            const size_t q = rankOf[k];
+            Transfer& t = transfers[q];
+            const int socket = peers[q];
+            if (polls[k].revents & POLLOUT) {
+                // The header, then the payload, as far as the socket takes them
+                ssize_t written;
+                if (t.headerSent < 8) {
+                    written = send(socket, t.header + t.headerSent, 8 - t.headerSent, MSG_NOSIGNAL);
+                    if (written > 0) t.headerSent += static_cast<size_t>(written);
+                } else {
+                    written = send(socket, outgoing[q].data() + t.sent, outgoing[q].size() - t.sent, MSG_NOSIGNAL);
+                    if (written > 0) t.sent += static_cast<size_t>(written);
+                }
+                if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    throw systemError("Cannot send to rank " + std::to_string(q));
+                }
+                if (written > 0) bytesSent += static_cast<uint64_t>(written);
+            }
+            if (polls[k].revents & (POLLIN | POLLHUP | POLLERR)) {
+                ssize_t got;
+                if (!t.sizeKnown) {
+                    got = recv(socket, t.incomingHeader + t.headerReceived, 8 - t.headerReceived, 0);
+                    if (got > 0) {
+                        t.headerReceived += static_cast<size_t>(got);
+                        if (t.headerReceived == 8) {
+                            uint64_t size;
+                            std::memcpy(&size, t.incomingHeader, 8);
+                            incoming[q].resize(size);
+                            t.sizeKnown = true;
+                        }
+                    }
+                } else {
+                    got = recv(socket, incoming[q].data() + t.received, incoming[q].size() - t.received, 0);
+                    if (got > 0) t.received += static_cast<size_t>(got);
+                }
+                if (got == 0 && t.receiving(incoming[q])) {
+                    throw std::runtime_error("Rank " + std::to_string(q) + " closed its connection");
+                }
+                if (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    throw systemError("Cannot receive from rank " + std::to_string(q));
+                }
+            }
+        }
+    }
+    return incoming;
+}
@@ -0,0 +1,376 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+#include "StateStream.h"
+#include "Simulator.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    const char MAGIC[8] = {'G', 'R', 'A', 'V', 'S', 'T', 'R', 'M'};
+    const uint64_t BYTE_ORDER_TAG = 0x0102030405060708ull;
+    const uint64_t VERSION = 1;
+    const size_t COLUMNS = 8;
+    const uint64_t KEYFRAME_INTERVAL = 64;
+    const uint64_t DELTA_CHUNK = 1;  // Chunk flag: columns are coded against the previous frame
+
+    struct FileHeader {
+        char magic[8];
+        uint64_t byteOrder;
+        uint64_t version;
+        uint64_t compression;
+        uint64_t columns;
+    };
+
+    struct ChunkHeader {
+        uint64_t index;
+        double time;
+        uint64_t bodyCount;
+        uint64_t flags;
+        uint64_t size[COLUMNS];  // Encoded bytes of each column
+    };
+
+    // The double columns of a frame, in file order after the id column
+    template <typename Frame>
+    auto doubleColumns(Frame& frame) {
+        return std::array<decltype(&frame.x), COLUMNS - 1>{&frame.x, &frame.y, &frame.z,
+                                                           &frame.vx, &frame.vy, &frame.vz, &frame.mass};
+    }
+
+    uint64_t byteSwap(uint64_t value) {
+        uint64_t result = 0;
+        for (int k = 0; k < 8; ++k) {
+            result = (result << 8) | (value & 0xff);
+            value >>= 8;
+        }
+        return result;
+    }
+
+    template <typename T>
+    uint64_t bitsOf(T value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, 8);
+        return bits;
+    }
+
+    // Byte k of every value goes to out[k * count + i], least significant
+    // byte first. Each value is XORed with the matching reference value first
+    // if there is one.
+    template <typename T>
+    void shuffleBytes(const T* values, const T* reference, size_t count, std::vector<uint8_t>& out) {
+        out.resize(count * 8);
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t bits = bitsOf(values[i]) ^ (reference ? bitsOf(reference[i]) : 0);
+            for (size_t k = 0; k < 8; ++k) {
+                out[k * count + i] = static_cast<uint8_t>(bits >> (8 * k));
+            }
+        }
+    }
+
+    template <typename T>
+    void unshuffleBytes(const std::vector<uint8_t>& in, const T* reference, size_t count, T* values) {
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t bits = 0;
+            for (size_t k = 0; k < 8; ++k) {
+                bits |= static_cast<uint64_t>(in[k * count + i]) << (8 * k);
+            }
+            bits ^= reference ? bitsOf(reference[i]) : 0;
+            std::memcpy(&values[i], &bits, 8);
+        }
+    }
+
+    // Control byte c < 128: c + 1 literal bytes follow. c >= 128: c - 127 zero bytes.
+    void packZeroRuns(const std::vector<uint8_t>& in, std::vector<uint8_t>& out) {
+        const size_t n = in.size();
+        size_t i = 0;
+        while (i < n) {
+            size_t run = 0;
+            while (i + run < n && run < 128 && in[i + run] == 0) ++run;
+            if (run >= 2 || (run == 1 && i + 1 == n)) {
+                out.push_back(static_cast<uint8_t>(127 + run));
+                i += run;
+                continue;
+            }
+            // Literals up to the next pair of zeros
+            size_t start = i;
+            while (i < n && i - start < 128 && !(in[i] == 0 && i + 1 < n && in[i + 1] == 0)) ++i;
+            out.push_back(static_cast<uint8_t>(i - start - 1));
+            out.insert(out.end(), in.begin() + start, in.begin() + i);
+        }
+    }
+
+    bool unpackZeroRuns(const std::vector<uint8_t>& in, size_t expected, std::vector<uint8_t>& out) {
+        out.clear();
+        out.reserve(expected);
+        size_t i = 0;
+        while (i < in.size()) {
+            uint8_t control = in[i++];
+            if (control >= 128) {
+                out.insert(out.end(), control - 127, 0);
+            } else {
+                size_t length = control + 1u;
+                if (i + length > in.size()) return false;
+                out.insert(out.end(), in.begin() + i, in.begin() + i + length);
+                i += length;
+            }
+        }
+        return out.size() == expected;
+    }
+
+    template <typename T>
+    void encodeColumn(const std::vector<T>& values, const std::vector<T>* reference,
+                      std::vector<uint8_t>& scratch, std::vector<uint8_t>& out) {
+        shuffleBytes(values.data(), reference ? reference->data() : nullptr, values.size(), scratch);
+        packZeroRuns(scratch, out);
+    }
+
+    template <typename T>
+    void decodeColumn(const std::vector<uint8_t>& encoded, bool compressed, bool swapped, size_t count,
+                      const std::vector<T>* reference, std::vector<uint8_t>& scratch, std::vector<T>& out) {
+        out.resize(count);
+        if (!compressed) {
+            if (encoded.size() != count * 8) throw std::runtime_error("Corrupt state stream chunk");
+            if (count > 0) std::memcpy(out.data(), encoded.data(), count * 8);
+            if (swapped) {
+                for (T& value : out) {
+                    uint64_t bits = byteSwap(bitsOf(value));
+                    std::memcpy(&value, &bits, 8);
+                }
+            }
+            return;
+        }
+        if (!unpackZeroRuns(encoded, count * 8, scratch)) throw std::runtime_error("Corrupt state stream chunk");
+        unshuffleBytes(scratch, reference ? reference->data() : nullptr, count, out.data());
+    }
+}
+
+StateStream::StateStream(const std::string& path, Compression compression, size_t queueDepth)
+        : file(std::fopen(path.c_str(), "wb")), compression(compression), queueDepth(std::max<size_t>(queueDepth, 1)) {
+    if (!file) {
+        throw std::runtime_error("Failed to open " + path + " for writing");
+    }
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.byteOrder = BYTE_ORDER_TAG;
+    header.version = VERSION;
+    header.compression = static_cast<uint64_t>(compression);
+    header.columns = COLUMNS;
+    try {
+        writeBytes(&header, sizeof(header));
+    } catch (...) {
+        std::fclose(file);
+        throw;
+    }
+    writer = std::thread(&StateStream::writerLoop, this);
+}
+
+StateStream::~StateStream() {
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+void StateStream::record(const Simulator& simulator) {
+    std::unique_ptr<StateFrame> frame;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (error) std::rethrow_exception(error);
+        if (closing) throw std::logic_error("StateStream::record after close");
+        if (queue.size() >= queueDepth) {
+            if (dropWhenFull) {
+                ++framesRecorded;
+                ++framesDropped;
+                return;
+            }
+            freed.wait(lock, [this]() { return queue.size() < queueDepth || error; });
+            if (error) std::rethrow_exception(error);
+        }
+        if (!spare.empty()) {
+            frame = std::move(spare.back());
+            spare.pop_back();
+        }
+    }
+    if (!frame) {
+        frame = std::make_unique<StateFrame>();
+    }
+
+    // Only this copy runs on the stepping thread
+    const BodyStore& bodies = simulator.getBodies();
+    frame->index = framesRecorded++;
+    frame->time = simulator.getTime();
+    frame->id.assign(bodies.id.begin(), bodies.id.end());
+    const std::array<const std::vector<double>*, COLUMNS - 1> sources{&bodies.x, &bodies.y, &bodies.z,
+                                                                      &bodies.vx, &bodies.vy, &bodies.vz, &bodies.mass};
+    auto columns = doubleColumns(*frame);
+    for (size_t c = 0; c < columns.size(); ++c) {
+        columns[c]->assign(sources[c]->begin(), sources[c]->end());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(frame));
+    }
+    queued.notify_one();
+}
+
+void StateStream::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    queued.notify_all();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    if (file) {
+        if (std::fclose(file) != 0 && !error) {
+            error = std::make_exception_ptr(std::runtime_error("Failed to write state stream"));
+        }
+        file = nullptr;
+    }
+    if (error) {
+        std::exception_ptr failed = error;
+        error = nullptr;
+        std::rethrow_exception(failed);
+    }
+}
+
+void StateStream::writerLoop() {
+    for (;;) {
+        std::unique_ptr<StateFrame> frame;
+        bool failed;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queued.wait(lock, [this]() { return !queue.empty() || closing; });
+            if (queue.empty()) return;
+            frame = std::move(queue.front());
+            queue.pop_front();
+            failed = error != nullptr;
+        }
+        // After a failure the queue is still drained, so record() never waits forever
+        if (!failed) {
+            try {
+                writeFrame(*frame);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                error = std::current_exception();
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (compression == Compression::Delta) {
+                std::swap(frame, previous);
+            }
+            if (frame) spare.push_back(std::move(frame));
+        }
+        freed.notify_one();
+    }
+}
+
+void StateStream::writeFrame(const StateFrame& frame) {
+    const size_t n = frame.size();
+    ChunkHeader header{};
+    header.index = frame.index;
+    header.time = frame.time;
+    header.bodyCount = n;
+    rawBytes += sizeof(header) + n * 8 * COLUMNS;
+
+    auto columns = doubleColumns(frame);
+    if (compression == Compression::None) {
+        for (size_t c = 0; c < COLUMNS; ++c) header.size[c] = n * 8;
+        writeBytes(&header, sizeof(header));
+        writeBytes(frame.id.data(), n * 8);
+        for (const auto* column : columns) {
+            writeBytes(column->data(), n * 8);
+        }
+        ++framesWritten;
+        return;
+    }
+
+    const bool delta = previous && previous->id == frame.id && framesWritten % KEYFRAME_INTERVAL != 0;
+    header.flags = delta ? DELTA_CHUNK : 0;
+    encoded.clear();
+    encodeColumn(frame.id, delta ? &previous->id : nullptr, scratch, encoded);
+    header.size[0] = encoded.size();
+    auto previousColumns = delta ? doubleColumns(static_cast<const StateFrame&>(*previous)) : columns;
+    for (size_t c = 0; c < columns.size(); ++c) {
+        size_t before = encoded.size();
+        encodeColumn(*columns[c], delta ? previousColumns[c] : nullptr, scratch, encoded);
+        header.size[c + 1] = encoded.size() - before;
+    }
+    writeBytes(&header, sizeof(header));
+    writeBytes(encoded.data(), encoded.size());
+    ++framesWritten;
+}
+
+void StateStream::writeBytes(const void* data, size_t size) {
+    if (size > 0 && std::fwrite(data, 1, size, file) != size) {
+        throw std::runtime_error("Failed to write state stream");
+    }
+    bytesWritten += size;
+}
+
+StateStreamReader::StateStreamReader(const std::string& path) : file(std::fopen(path.c_str(), "rb")) {
+    if (!file) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    FileHeader header;
+    bool valid = std::fread(&header, sizeof(header), 1, file) == 1
+                 && std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0;
+    if (valid && header.byteOrder != BYTE_ORDER_TAG) {
+        swapped = true;
+        valid = header.byteOrder == byteSwap(BYTE_ORDER_TAG);
+        header.version = byteSwap(header.version);
+        header.compression = byteSwap(header.compression);
+        header.columns = byteSwap(header.columns);
+    }
+    valid = valid && header.version == VERSION && header.columns == COLUMNS
+            && header.compression <= static_cast<uint64_t>(StateStream::Compression::Delta);
+    if (!valid) {
+        std::fclose(file);
+        throw std::runtime_error(path + " is not a state stream this build can read");
+    }
+    compressed = header.compression != static_cast<uint64_t>(StateStream::Compression::None);
+}
+
+StateStreamReader::~StateStreamReader() {
+    std::fclose(file);
+}
+
+bool StateStreamReader::next(StateFrame& frame) {
+    ChunkHeader header;
+    size_t got = std::fread(&header, 1, sizeof(header), file);
+    if (got == 0) return false;
+    if (got != sizeof(header)) throw std::runtime_error("Truncated state stream chunk");
+    if (swapped) {
+        auto* fields = reinterpret_cast<uint64_t*>(&header);
+        for (size_t k = 0; k < sizeof(header) / 8; ++k) {
+            fields[k] = byteSwap(fields[k]);
+        }
+    }
+    const size_t n = header.bodyCount;
+    const bool delta = (header.flags & DELTA_CHUNK) != 0;
+    if (delta && previous.size() != n) throw std::runtime_error("State stream delta chunk without its base");
+
+    frame.index = header.index;
+    frame.time = header.time;
+    auto readColumn = [&](size_t c) {
+        encoded.resize(header.size[c]);
+        if (header.size[c] > 0 && std::fread(encoded.data(), 1, encoded.size(), file) != encoded.size()) {
+            throw std::runtime_error("Truncated state stream chunk");
+        }
+    };
+    readColumn(0);
+    decodeColumn(encoded, compressed, swapped, n, delta ? &previous.id : nullptr, scratch, frame.id);
+    auto columns = doubleColumns(frame);
+    auto previousColumns = doubleColumns(previous);
+    for (size_t c = 0; c < columns.size(); ++c) {
+        readColumn(c + 1);
+        decodeColumn(encoded, compressed, swapped, n, delta ? previousColumns[c] : nullptr, scratch, *columns[c]);
+    }
+    previous = frame;
+    return true;
+}
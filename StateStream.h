@@ -0,0 +1,130 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+
+#ifndef GRAVITY_STATESTREAM_H
+#define GRAVITY_STATESTREAM_H
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Simulator;
+
+// One recorded state, one array per column
+struct StateFrame {
+    uint64_t index = 0;  // Frames recorded before this one, dropped ones included
+    double time = 0.0;
+    std::vector<uint64_t> id;
+    std::vector<double> x, y, z;
+    std::vector<double> vx, vy, vz;
+    std::vector<double> mass;
+
+    size_t size() const { return id.size(); }
+};
+
+// Streams the state of a run to a chunked columnar file. Attach it with
+// Simulator::setOutput. record() only copies the body arrays, and a writer
+// thread encodes and writes them, so the step loop doesn't wait on the disk
+// while the queue has room.
+//
+// The file is a header followed by one chunk per frame. A chunk holds the
+// frame's time, body count and the encoded size of each column, then the
+// columns in the order id, x, y, z, vx, vy, vz, mass. A reader can skip any
+// column it doesn't need.
+//
+// With Compression::Delta, each value is XORed with the same body's value in
+// the previous frame when the body ids haven't changed. The bytes are then
+// grouped by significance, and runs of zero bytes are coded as their length.
+// Slowly changing values leave long runs of zero high bytes. Every 64th chunk
+// is a keyframe, coded against zero, so a reader can start there.
+class StateStream {
+public:
+    enum class Compression {
+        None,
+        Delta
+    };
+
+    // Opens path for writing and starts the writer thread. Throws std::runtime_error if the file can't be created.
+    StateStream(const std::string& path, Compression compression = Compression::None, size_t queueDepth = 4);
+    // Finishes the queued frames. Write errors are lost, call close() to see them.
+    ~StateStream();
+    StateStream(const StateStream&) = delete;
+    StateStream& operator=(const StateStream&) = delete;
+
+    // Copies the simulator's current state into the queue. When the queue is
+    // full, waits for the writer, or drops the frame if setDropWhenFull is on.
+    // Throws the first write error.
+    void record(const Simulator& simulator);
+    // Writes out the queued frames and closes the file. Throws the first write error.
+    void close();
+
+    // Drop frames instead of waiting when the writer falls behind (default off)
+    void setDropWhenFull(bool drop) { dropWhenFull = drop; }
+    uint64_t getFramesWritten() const { return framesWritten; }
+    uint64_t getFramesDropped() const { return framesDropped; }
+    // Bytes in the file so far, and what the same frames take uncompressed
+    uint64_t getBytesWritten() const { return bytesWritten; }
+    uint64_t getRawBytes() const { return rawBytes; }
+
+private:
+    FILE* file;
+    const Compression compression;
+    const size_t queueDepth;
+    std::atomic<bool> dropWhenFull{false};
+
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::condition_variable freed;
+    std::deque<std::unique_ptr<StateFrame>> queue;
+    std::vector<std::unique_ptr<StateFrame>> spare;  // Written frames, reused to avoid reallocating
+    bool closing = false;
+    std::exception_ptr error;
+    std::thread writer;
+
+    uint64_t framesRecorded = 0;
+    std::atomic<uint64_t> framesWritten{0};
+    std::atomic<uint64_t> framesDropped{0};
+    std::atomic<uint64_t> bytesWritten{0};
+    std::atomic<uint64_t> rawBytes{0};
+
+    // Writer thread state
+    std::unique_ptr<StateFrame> previous;
+    std::vector<uint8_t> encoded;
+    std::vector<uint8_t> scratch;
+
+    void writerLoop();
+    void writeFrame(const StateFrame& frame);
+    void writeBytes(const void* data, size_t size);
+};
+
+// Reads back a file written by StateStream
+class StateStreamReader {
+public:
+    // Throws std::runtime_error if the file can't be opened or isn't a state stream
+    explicit StateStreamReader(const std::string& path);
+    ~StateStreamReader();
+    StateStreamReader(const StateStreamReader&) = delete;
+    StateStreamReader& operator=(const StateStreamReader&) = delete;
+
+    // Reads the next frame, returns false at the end of the file. Throws
+    // std::runtime_error on a truncated or corrupt chunk.
+    bool next(StateFrame& frame);
+
+private:
+    FILE* file;
+    bool swapped = false;     // Written on a machine of the other byte order
+    bool compressed = false;
+    StateFrame previous;
+    std::vector<uint8_t> encoded;
+    std::vector<uint8_t> scratch;
+};
+#endif //GRAVITY_STATESTREAM_H
@@ -0,0 +1,119 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <string>
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    threadCount = std::max<size_t>(threadCount, 1);
+    for (size_t i = 0; i < threadCount; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+    if (count == 0) return;
+    grain = std::max<size_t>(grain, 1);
+    const size_t chunkCount = (count + grain - 1) / grain;
+
+    if (workers.empty() || chunkCount == 1) {
+        for (size_t begin = 0; begin < count; begin += grain) {
+            body(begin, std::min(begin + grain, count));
+        }
+        return;
+    }
+
+    // Deal contiguous runs of chunks to each queue; owners take from the front
+    // and thieves from the back, so neighbouring chunks tend to stay together
+    const size_t queueCount = queues.size();
+    for (size_t q = 0; q < queueCount; ++q) {
+        std::lock_guard<std::mutex> lock(queues[q]->mutex);
+        for (size_t chunk = q * chunkCount / queueCount; chunk < (q + 1) * chunkCount / queueCount; ++chunk) {
+            queues[q]->chunks.push_back(chunk);
+        }
+    }
+
+    Job current{&body, count, grain};
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        job = &current;
+        activeWorkers = workers.size();
+        ++generation;
+    }
+    wake.notify_all();
+
+    drain(0);
+
+    // Every chunk has been taken once all participants have left drain()
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    done.wait(lock, [this] { return activeWorkers == 0; });
+    job = nullptr;
+}
+
+bool ThreadPool::popLocal(size_t queue, size_t& chunk) {
+    Queue& q = *queues[queue];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.chunks.empty()) return false;
+    chunk = q.chunks.front();
+    q.chunks.pop_front();
+    return true;
+}
+
+bool ThreadPool::steal(size_t thief, size_t& chunk) {
+    const size_t queueCount = queues.size();
+    for (size_t offset = 1; offset < queueCount; ++offset) {
+        Queue& victim = *queues[(thief + offset) % queueCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.chunks.empty()) continue;
+        chunk = victim.chunks.back();
+        victim.chunks.pop_back();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::drain(size_t queue) {
+    size_t chunk;
+    while (popLocal(queue, chunk) || steal(queue, chunk)) {
+        size_t begin = chunk * job->grain;
+        (*job->body)(begin, std::min(begin + job->grain, job->count));
+    }
+}
+
+void ThreadPool::workerLoop(size_t queue) {
+    if constexpr (Profiler::ENABLED) {
+        Profiler::setThreadName("worker " + std::to_string(queue));
+    }
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        drain(queue);
+
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        if (--activeWorkers == 0) {
+            done.notify_all();
+        }
+    }
+}
@@ -0,0 +1,63 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+
+#ifndef GRAVITY_THREADPOOL_H
+#define GRAVITY_THREADPOOL_H
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent pool with one task deque per thread. parallelFor deals chunks
+// out evenly; a thread that runs dry steals from the back of another
+// thread's deque, so clustered workloads still balance. The calling thread
+// takes part in the work, so a pool of N threads spawns N - 1 workers.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t getThreadCount() const { return queues.size(); }
+
+    // Calls body(begin, end) for chunks of [0, count) of at most grain items and
+    // blocks until all of them are done. Chunk boundaries depend only on count
+    // and grain, never on the thread count. Not reentrant.
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+private:
+    struct Job {
+        const std::function<void(size_t, size_t)>* body;
+        size_t count;
+        size_t grain;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> chunks;
+    };
+
+    bool popLocal(size_t queue, size_t& chunk);
+    bool steal(size_t thief, size_t& chunk);
+    void drain(size_t queue);
+    void workerLoop(size_t queue);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    Job* job = nullptr;
+    uint64_t generation = 0;
+    size_t activeWorkers = 0;
+    bool stopping = false;
+};
+#endif //GRAVITY_THREADPOOL_H
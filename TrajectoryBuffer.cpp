@@ -0,0 +1,205 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+#include "TrajectoryBuffer.h"
+#include "Shader.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstddef>
+
+namespace {
+    const size_t MEMORY_BUDGET = size_t(128) << 20;  // Bytes of GPU memory for all trails
+    const size_t MAX_POINTS_PER_BODY = 1024;
+    const size_t MIN_SLOTS = 64;
+    const GLbitfield MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    // Oldest samples fade to transparent, the newest is at half opacity like the immediate path
+    const char* VERTEX_SHADER = R"(#version 330 core
+layout(location = 0) in vec3 position;
+layout(location = 1) in uint sample;
+uniform mat4 viewProjection;
+uniform uint latestSample;
+uniform float historyLength;
+out float alpha;
+void main() {
+    float age = float(latestSample - sample);
+    alpha = 0.5 * max(1.0 - age / historyLength, 0.0);
+    gl_Position = viewProjection * vec4(position, 1.0);
+}
+)";
+
+    const char* FRAGMENT_SHADER = R"(#version 330 core
+in float alpha;
+out vec4 fragColour;
+void main() {
+    fragColour = vec4(1.0, 1.0, 1.0, alpha);
+}
+)";
+}
+
+TrajectoryBuffer::~TrajectoryBuffer() {
+    if (!program) return;
+    waitForGpu();
+    release();
+    glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(program);
+}
+
+bool TrajectoryBuffer::isSupported() {
+    return GLEW_VERSION_3_3 && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage);
+}
+
+void TrajectoryBuffer::initialize() {
+    program = createShaderProgram(VERTEX_SHADER, FRAGMENT_SHADER);
+    glGenVertexArrays(1, &vao);
+}
+
+void TrajectoryBuffer::waitForGpu() {
+    if (fence) {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+void TrajectoryBuffer::release() {
+    if (vbo) {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glDeleteBuffers(1, &vbo);
+        vbo = 0;
+        mapped = nullptr;
+    }
+}
+
+// Replaces the buffer with one holding the given number of rings. The ring
+// length is the largest power of two that fits the budget, so every trail
+// restarts from the CPU-side history.
+void TrajectoryBuffer::allocate(size_t slots) {
+    waitForGpu();
+    release();
+
+    size_t fit = MEMORY_BUDGET / (slots * 2 * sizeof(Vertex));
+    pointsPerBody = 2;
+    while (pointsPerBody * 2 <= std::min(fit, MAX_POINTS_PER_BODY)) {
+        pointsPerBody *= 2;
+    }
+    slotCount = slots;
+
+    const GLsizeiptr bytes = static_cast<GLsizeiptr>(slotCount * 2 * pointsPerBody * sizeof(Vertex));
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, MAP_FLAGS);
+    mapped = static_cast<Vertex*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, MAP_FLAGS));
+
+    glBindVertexArray(vao);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, position)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, sample)));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    written.assign(slotCount, 0);
+    freeSlots.clear();
+    for (size_t s = slotCount; s > 0; --s) {
+        freeSlots.push_back(static_cast<uint32_t>(s - 1));
+    }
+    slotById.clear();
+    lastIds.clear();
+}
+
+void TrajectoryBuffer::write(uint32_t slot, const glm::vec3& position, uint32_t stamp) {
+    const size_t base = slot * 2 * pointsPerBody;
+    const size_t j = written[slot] % pointsPerBody;
+    mapped[base + j] = Vertex{position, stamp};
+    mapped[base + j + pointsPerBody] = Vertex{position, stamp};
+    ++written[slot];
+}
+
+// Starts a new ring, from the newest points of the body's CPU-side history
+// when the snapshot carries it
+void TrajectoryBuffer::seed(uint32_t slot, const Snapshot& snapshot, size_t index) {
+    written[slot] = 0;
+    if (!snapshot.hasTrajectories()) return;
+    const size_t begin = snapshot.trajectoryStart[index];
+    const size_t end = snapshot.trajectoryStart[index + 1];
+    size_t count = std::min(end - begin, pointsPerBody);
+    for (size_t k = end - count; k < end; ++k) {
+        write(slot, snapshot.trajectoryPoints[k], sample - static_cast<uint32_t>(end - k));
+    }
+}
+
+// Slots follow body ids, so sorting and merges in the simulation keep each
+// trail. The mapping is only rebuilt on frames where the ids have changed.
+void TrajectoryBuffer::mapBodies(const Snapshot& snapshot) {
+    if (snapshot.id == lastIds && vbo) return;
+    const size_t n = snapshot.size();
+    if (n > slotCount) {
+        allocate(std::max({n, slotCount * 2, MIN_SLOTS}));
+    }
+
+    std::unordered_map<uint64_t, uint32_t> kept;
+    kept.reserve(n);
+    slotOf.assign(n, 0);
+    std::vector<size_t> added;
+    for (size_t i = 0; i < n; ++i) {
+        auto it = slotById.find(snapshot.id[i]);
+        if (it == slotById.end()) {
+            added.push_back(i);
+        } else {
+            slotOf[i] = it->second;
+            kept.emplace(it->first, it->second);
+            slotById.erase(it);
+        }
+    }
+    for (const auto& entry : slotById) {
+        freeSlots.push_back(entry.second);
+    }
+    slotById.swap(kept);
+    for (size_t i : added) {
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        slotById.emplace(snapshot.id[i], slot);
+        slotOf[i] = slot;
+        seed(slot, snapshot, i);
+    }
+    lastIds = snapshot.id;
+}
+
+void TrajectoryBuffer::append(const Snapshot& snapshot) {
+    // The GPU may still be drawing from the slots about to be overwritten
+    waitForGpu();
+    mapBodies(snapshot);
+    ++sample;
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        write(slotOf[i], glm::vec3(snapshot.position[i]), sample);
+    }
+}
+
+void TrajectoryBuffer::draw(const glm::mat4& viewProjection) {
+    if (!vbo) return;
+    firsts.clear();
+    counts.clear();
+    for (uint32_t slot : slotOf) {
+        const size_t n = written[slot];
+        if (n < 2) continue;
+        const size_t newest = (n - 1) % pointsPerBody;
+        const size_t start = n >= pointsPerBody ? newest + 1 : pointsPerBody;
+        firsts.push_back(static_cast<GLint>(slot * 2 * pointsPerBody + start));
+        counts.push_back(static_cast<GLsizei>(std::min(n, pointsPerBody)));
+    }
+
+    glUseProgram(program);
+    glUniformMatrix4fv(glGetUniformLocation(program, "viewProjection"), 1, GL_FALSE, glm::value_ptr(viewProjection));
+    glUniform1ui(glGetUniformLocation(program, "latestSample"), sample);
+    glUniform1f(glGetUniformLocation(program, "historyLength"), static_cast<float>(pointsPerBody));
+    glBindVertexArray(vao);
+    glMultiDrawArrays(GL_LINE_STRIP, firsts.data(), counts.data(), static_cast<GLsizei>(firsts.size()));
+    glBindVertexArray(0);
+    glUseProgram(0);
+
+    if (fence) glDeleteSync(fence);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
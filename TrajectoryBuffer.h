@@ -0,0 +1,69 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+
+#ifndef GRAVITY_TRAJECTORYBUFFER_H
+#define GRAVITY_TRAJECTORYBUFFER_H
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "SimulationThread.h"
+
+// GPU-resident trails. Every body owns a ring of the last C positions in one
+// persistently mapped vertex buffer, so each new simulation state costs one
+// vertex per body across the bus, and all trails are drawn with a single
+// glMultiDrawArrays call. The fade is computed in the vertex shader from the
+// age of each sample.
+//
+// Each ring is stored twice, back to back (2C vertices), and every point is
+// written to both copies. The newest C points are then always one contiguous
+// line strip, whatever the position of the ring's head.
+class TrajectoryBuffer {
+public:
+    TrajectoryBuffer() = default;
+    ~TrajectoryBuffer();
+    TrajectoryBuffer(const TrajectoryBuffer&) = delete;
+    TrajectoryBuffer& operator=(const TrajectoryBuffer&) = delete;
+
+    // Needs OpenGL 4.4 or ARB_buffer_storage and a current context
+    static bool isSupported();
+    void initialize();
+
+    // Records the position of every body in the snapshot. Call once per new snapshot.
+    void append(const Snapshot& snapshot);
+    void draw(const glm::mat4& viewProjection);
+
+private:
+    struct Vertex {
+        glm::vec3 position;
+        uint32_t sample;  // Value of the sample counter when written, for the fade
+    };
+
+    GLuint program = 0;
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    Vertex* mapped = nullptr;
+    GLsync fence = nullptr;     // Set after each draw, the GPU is done reading once it signals
+    size_t slotCount = 0;
+    size_t pointsPerBody = 0;   // C, a power of two chosen from the memory budget
+    uint32_t sample = 0;
+
+    std::vector<uint64_t> lastIds;                 // Body ids the mapping below was built for
+    std::vector<uint32_t> slotOf;                  // Body index -> slot
+    std::unordered_map<uint64_t, uint32_t> slotById;
+    std::vector<uint32_t> freeSlots;
+    std::vector<uint32_t> written;                 // Points written so far, per slot
+    std::vector<GLint> firsts;
+    std::vector<GLsizei> counts;
+
+    void allocate(size_t slots);
+    void release();
+    void waitForGpu();
+    void mapBodies(const Snapshot& snapshot);
+    void seed(uint32_t slot, const Snapshot& snapshot, size_t index);
+    void write(uint32_t slot, const glm::vec3& position, uint32_t stamp);
+};
+#endif //GRAVITY_TRAJECTORYBUFFER_H
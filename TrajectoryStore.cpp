@@ -0,0 +1,203 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+#include "TrajectoryStore.h"
+#include <algorithm>
+#include <atomic>
+
+namespace {
+    std::atomic<size_t> memoryBudget{size_t(256) << 20};
+    std::atomic<size_t> totalSlots{0};  // Slots allocated by every store in the process
+
+    size_t pointsPerLevelFor(size_t slots) {
+        size_t perLevel = memoryBudget.load() / (std::max<size_t>(slots, 1) * TrajectoryStore::LEVELS * sizeof(glm::vec3));
+        perLevel = std::min(perLevel, TrajectoryStore::MAX_POINTS_PER_LEVEL);
+        size_t rounded = TrajectoryStore::MIN_POINTS_PER_LEVEL;
+        while (rounded * 2 <= perLevel) {
+            rounded *= 2;
+        }
+        return rounded;
+    }
+}
+
+TrajectoryStore::TrajectoryStore() : pointsPerLevel(pointsPerLevelFor(totalSlots.load())) {}
+
+TrajectoryStore::TrajectoryStore(const TrajectoryStore& other)
+        : slots(other.slots), freeSlots(other.freeSlots), slotCount(other.slotCount),
+          pointsPerLevel(other.pointsPerLevel), points(other.points), rings(other.rings), enabled(other.enabled) {
+    totalSlots += slotCount;
+}
+
+TrajectoryStore& TrajectoryStore::operator=(const TrajectoryStore& other) {
+    if (this != &other) {
+        totalSlots -= slotCount;
+        slots = other.slots;
+        freeSlots = other.freeSlots;
+        slotCount = other.slotCount;
+        pointsPerLevel = other.pointsPerLevel;
+        points = other.points;
+        rings = other.rings;
+        enabled = other.enabled;
+        totalSlots += slotCount;
+    }
+    return *this;
+}
+
+TrajectoryStore::~TrajectoryStore() {
+    totalSlots -= slotCount;
+}
+
+void TrajectoryStore::setMemoryBudget(size_t bytes) {
+    memoryBudget = bytes;
+}
+
+size_t TrajectoryStore::getMemoryBudget() {
+    return memoryBudget.load();
+}
+
+void TrajectoryStore::reserve(size_t n) {
+    if (!enabled || n <= slotCount) return;
+    size_t others = totalSlots.load() - slotCount;
+    size_t first = slotCount;
+    relayout(n, pointsPerLevelFor(others + n));
+    for (size_t s = n; s > first; --s) {
+        freeSlots.push_back(static_cast<uint32_t>(s - 1));
+    }
+}
+
+void TrajectoryStore::clear() {
+    for (auto it = slots.rbegin(); it != slots.rend(); ++it) {
+        if (*it != NO_SLOT) freeSlots.push_back(*it);
+    }
+    slots.clear();
+}
+
+uint32_t TrajectoryStore::allocateSlot() {
+    if (!enabled) return NO_SLOT;
+    if (freeSlots.empty()) {
+        reserve(std::max<size_t>(16, slotCount * 2));
+    }
+    uint32_t slot = freeSlots.back();
+    freeSlots.pop_back();
+    std::fill(rings.begin() + slot * LEVELS, rings.begin() + (slot + 1) * LEVELS, Ring());
+    return slot;
+}
+
+void TrajectoryStore::add(const std::vector<glm::dvec3>& history) {
+    slots.push_back(allocateSlot());
+    for (const auto& point : history) {
+        push(slots.size() - 1, glm::vec3(point));
+    }
+}
+
+void TrajectoryStore::addEmpty(size_t count) {
+    if (freeSlots.size() < count) {
+        reserve(std::max(slotCount + count - freeSlots.size(), slotCount * 2));
+    }
+    slots.reserve(slots.size() + count);
+    for (size_t k = 0; k < count; ++k) {
+        slots.push_back(allocateSlot());
+    }
+}
+
+void TrajectoryStore::permute(const std::vector<size_t>& order) {
+    std::vector<char> kept(slots.size(), 0);
+    std::vector<uint32_t> result;
+    result.reserve(order.size());
+    for (size_t k : order) {
+        result.push_back(slots[k]);
+        kept[k] = 1;
+    }
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (!kept[i] && slots[i] != NO_SLOT) freeSlots.push_back(slots[i]);
+    }
+    slots.swap(result);
+}
+
+void TrajectoryStore::push(size_t i, const glm::vec3& position) {
+    if (slots[i] == NO_SLOT) return;
+    const size_t slot = slots[i];
+    glm::vec3 carry = position;
+    for (size_t level = 0; level < LEVELS; ++level) {
+        Ring& ring = rings[slot * LEVELS + level];
+        glm::vec3* buffer = points.data() + (slot * LEVELS + level) * pointsPerLevel;
+        if (ring.count < pointsPerLevel) {
+            buffer[(ring.head + ring.count) % pointsPerLevel] = carry;
+            ++ring.count;
+            return;
+        }
+        glm::vec3 oldest = buffer[ring.head];
+        buffer[ring.head] = carry;
+        ring.head = static_cast<uint32_t>((ring.head + 1) % pointsPerLevel);
+        if (ring.evicted++ % 2 != 0) return;
+        carry = oldest;
+    }
+}
+
+void TrajectoryStore::copy(size_t i, std::vector<glm::vec3>& out) const {
+    if (slots[i] == NO_SLOT) return;
+    const size_t slot = slots[i];
+    for (size_t level = LEVELS; level-- > 0;) {
+        const Ring& ring = rings[slot * LEVELS + level];
+        const glm::vec3* buffer = points.data() + (slot * LEVELS + level) * pointsPerLevel;
+        for (size_t k = 0; k < ring.count; ++k) {
+            out.push_back(buffer[(ring.head + k) % pointsPerLevel]);
+        }
+    }
+}
+
+size_t TrajectoryStore::pointCount(size_t i) const {
+    if (slots[i] == NO_SLOT) return 0;
+    size_t count = 0;
+    for (size_t level = 0; level < LEVELS; ++level) {
+        count += rings[slots[i] * LEVELS + level].count;
+    }
+    return count;
+}
+
+void TrajectoryStore::disable() {
+    if (!enabled) return;
+    enabled = false;
+    totalSlots -= slotCount;
+    slotCount = 0;
+    std::fill(slots.begin(), slots.end(), NO_SLOT);
+    std::vector<uint32_t>().swap(freeSlots);
+    std::vector<glm::vec3>().swap(points);
+    std::vector<Ring>().swap(rings);
+}
+
+void TrajectoryStore::fitToBudget() {
+    if (!enabled) return;
+    size_t target = pointsPerLevelFor(totalSlots.load());
+    if (target != pointsPerLevel) {
+        relayout(slotCount, target);
+    }
+}
+
+size_t TrajectoryStore::memoryUsage() const {
+    return points.capacity() * sizeof(glm::vec3) + rings.capacity() * sizeof(Ring)
+           + (slots.capacity() + freeSlots.capacity()) * sizeof(uint32_t);
+}
+
+// Moves every ring into a pool of the new shape, keeping the newest points
+// when the rings get shorter
+void TrajectoryStore::relayout(size_t newSlotCount, size_t newPointsPerLevel) {
+    std::vector<glm::vec3> newPoints(newSlotCount * LEVELS * newPointsPerLevel);
+    std::vector<Ring> newRings(newSlotCount * LEVELS);
+    for (size_t r = 0; r < slotCount * LEVELS; ++r) {
+        const Ring& ring = rings[r];
+        size_t keep = std::min<size_t>(ring.count, newPointsPerLevel);
+        size_t skip = ring.count - keep;
+        for (size_t k = 0; k < keep; ++k) {
+            newPoints[r * newPointsPerLevel + k] = points[r * pointsPerLevel + (ring.head + skip + k) % pointsPerLevel];
+        }
+        newRings[r].count = static_cast<uint32_t>(keep);
+        newRings[r].evicted = ring.evicted;
+    }
+    totalSlots += newSlotCount;
+    totalSlots -= slotCount;
+    points.swap(newPoints);
+    rings.swap(newRings);
+    slotCount = newSlotCount;
+    pointsPerLevel = newPointsPerLevel;
+}
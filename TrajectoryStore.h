@@ -0,0 +1,87 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+
+#ifndef GRAVITY_TRAJECTORYSTORE_H
+#define GRAVITY_TRAJECTORYSTORE_H
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// Position history for every body of a BodyStore, kept in one preallocated
+// pool. Each body owns LEVELS rings of equal length: level 0 holds the most
+// recent positions at full resolution, and every second point that falls off
+// level k moves on to level k + 1, so the resolution halves at each level
+// further back in time.
+//
+// The ring length comes from a memory budget shared by every store in the
+// process, and is rounded down to a power of two so that it only changes, and
+// the pool is only rebuilt, when the total body count roughly doubles or halves.
+class TrajectoryStore {
+public:
+    static const size_t LEVELS = 4;
+    static const size_t MIN_POINTS_PER_LEVEL = 2;
+    static const size_t MAX_POINTS_PER_LEVEL = 256;
+
+    TrajectoryStore();
+    TrajectoryStore(const TrajectoryStore& other);
+    TrajectoryStore& operator=(const TrajectoryStore& other);
+    ~TrajectoryStore();
+
+    // Upper bound on the trajectory memory of all stores together, 256 MiB by
+    // default. Every store keeps at least MIN_POINTS_PER_LEVEL points per level.
+    static void setMemoryBudget(size_t bytes);
+    static size_t getMemoryBudget();
+
+    size_t size() const { return slots.size(); }
+    void reserve(size_t n);
+    void clear();
+    // Appends a body, seeding its history with the given points, oldest first
+    void add(const std::vector<glm::dvec3>& history);
+    // Appends count bodies with no history, growing the pool geometrically
+    void addEmpty(size_t count);
+    // Same contract as BodyStore::permute
+    void permute(const std::vector<size_t>& order);
+
+    // Records a position for body i. Safe to call concurrently for different bodies.
+    void push(size_t i, const glm::vec3& position);
+    // Appends body i's points to out, oldest first
+    void copy(size_t i, std::vector<glm::vec3>& out) const;
+    size_t pointCount(size_t i) const;
+
+    // Frees the pool and stops recording, for stores whose trajectories are
+    // never drawn. Bodies are still counted and reordered, but push ignores
+    // them and copy finds no points.
+    void disable();
+    bool isEnabled() const { return enabled; }
+
+    // Resizes the rings when the budget or the number of bodies in the process
+    // has changed enough to move the ring length to another power of two
+    void fitToBudget();
+    size_t getPointsPerLevel() const { return pointsPerLevel; }
+    // Steps covered by a full history: the rings together span (2^LEVELS - 1) ring lengths
+    size_t getHistoryLength() const { return pointsPerLevel * ((size_t(1) << LEVELS) - 1); }
+    size_t memoryUsage() const;
+
+private:
+    struct Ring {
+        uint32_t head = 0;     // Oldest point
+        uint32_t count = 0;
+        uint32_t evicted = 0;  // Points pushed out so far, every second one moves on
+    };
+
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    std::vector<uint32_t> slots;       // Body index -> storage slot, NO_SLOT when disabled
+    std::vector<uint32_t> freeSlots;
+    size_t slotCount = 0;              // Slots allocated in points and rings
+    size_t pointsPerLevel;
+    std::vector<glm::vec3> points;     // slotCount * LEVELS * pointsPerLevel
+    std::vector<Ring> rings;           // slotCount * LEVELS
+    bool enabled = true;
+
+    void relayout(size_t newSlotCount, size_t newPointsPerLevel);
+    uint32_t allocateSlot();
+};
+#endif //GRAVITY_TRAJECTORYSTORE_H
@@ -0,0 +1,8 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+#include "Transport.h"
+
+std::vector<Transport::Message> Transport::allGather(const Message& message) {
+    return exchange(std::vector<Message>(processCount, message));
+}
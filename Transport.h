@@ -0,0 +1,84 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+
+#ifndef GRAVITY_TRANSPORT_H
+#define GRAVITY_TRANSPORT_H
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// How the processes of a distributed run talk to each other. Everything the
+// domain decomposition needs is one collective: every rank hands a message
+// to every other rank and gets one back from each. Another backend (TCP
+// between nodes, MPI's Alltoallv) only has to implement exchange().
+class Transport {
+public:
+    using Message = std::vector<char>;
+
+    virtual ~Transport() = default;
+
+    size_t getRank() const { return rank; }
+    size_t getProcessCount() const { return processCount; }
+
+    // Sends outgoing[q] to rank q and returns incoming, where incoming[q] came
+    // from rank q. outgoing[getRank()] is handed straight back. Every rank
+    // must call it the same number of times; it blocks until all messages are
+    // through. Throws std::runtime_error if a peer goes away.
+    virtual std::vector<Message> exchange(std::vector<Message> outgoing) = 0;
+
+    // Every rank's copy of message, in rank order
+    std::vector<Message> allGather(const Message& message);
+
+    // Bytes this rank has put on the wire so far
+    virtual uint64_t getBytesSent() const { return 0; }
+
+protected:
+    Transport(size_t rank, size_t processCount) : rank(rank), processCount(processCount) {}
+
+private:
+    size_t rank;
+    size_t processCount;
+};
+
+// A single process talking to itself
+class LocalTransport : public Transport {
+public:
+    LocalTransport() : Transport(0, 1) {}
+    std::vector<Message> exchange(std::vector<Message> outgoing) override { return outgoing; }
+};
+
+#ifdef GRAVITY_SOCKET_TRANSPORT
+// Processes on one Linux machine, connected pairwise by Unix domain socket
+// pairs. Only built on POSIX systems, which define GRAVITY_SOCKET_TRANSPORT. Messages are framed by an 8-byte length and moved with non-blocking
+// sends and receives on all peers at once, so large exchanges cannot
+// deadlock on full socket buffers.
+class SocketTransport : public Transport {
+public:
+    // Forks processCount - 1 workers and returns each process its end of the
+    // mesh: rank 0 in the caller, ranks 1 and up in the workers. Flush any
+    // buffered output first, or the workers print it again. A worker forked
+    // from a process with running threads has none of them, so it should
+    // leave with _exit once its share of the work is done. Rank 0's
+    // destructor waits for the workers.
+    static std::unique_ptr<SocketTransport> fork(size_t processCount);
+
+    ~SocketTransport() override;
+    SocketTransport(const SocketTransport&) = delete;
+    SocketTransport& operator=(const SocketTransport&) = delete;
+
+    std::vector<Message> exchange(std::vector<Message> outgoing) override;
+
+    uint64_t getBytesSent() const override { return bytesSent; }
+
+private:
+    SocketTransport(size_t rank, size_t processCount, std::vector<int> peers, std::vector<int> children);
+
+    std::vector<int> peers;     // Socket to each rank, -1 for this one
+    std::vector<int> children;  // Worker process ids, rank 0 only
+    uint64_t bytesSent = 0;
+};
+#endif
+
+#endif //GRAVITY_TRANSPORT_H
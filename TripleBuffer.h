@@ -0,0 +1,43 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+
+#ifndef GRAVITY_TRIPLEBUFFER_H
+#define GRAVITY_TRIPLEBUFFER_H
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Lock-free hand-over of values from one writer thread to one reader thread.
+// The writer fills the back slot and publishes it, the reader swaps in the
+// newest published slot and reads it for as long as it likes. Neither side
+// ever waits: the third slot is the one being handed over, so the writer can
+// always publish again while the reader still holds its front slot.
+template <typename T>
+class TripleBuffer {
+public:
+    // Writer side
+    T& back() { return slots[backIndex]; }
+    void publish() {
+        backIndex = shared.exchange(static_cast<uint8_t>(backIndex | FRESH), std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Reader side. Swaps in the newest published value, returns false if
+    // nothing was published since the last call.
+    bool update() {
+        if (!(shared.load(std::memory_order_relaxed) & FRESH)) return false;
+        frontIndex = shared.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& front() const { return slots[frontIndex]; }
+
+private:
+    static const uint8_t INDEX = 3;
+    static const uint8_t FRESH = 4;  // The shared slot holds a value the reader has not seen
+
+    T slots[3];
+    uint8_t backIndex = 0;
+    uint8_t frontIndex = 1;
+    std::atomic<uint8_t> shared{2};
+};
+#endif //GRAVITY_TRIPLEBUFFER_H
@@ -0,0 +1,54 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+#include "Visibility.h"
+#include <cmath>
+#include <limits>
+
+namespace {
+    glm::vec4 row(const glm::mat4& m, int r) {
+        return glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+    }
+}
+
+// Gribb and Hartmann: each plane is the last row of the matrix plus or minus
+// one of the others, normalised so that distances come out in world units
+Frustum::Frustum(const glm::mat4& viewProjection) {
+    const glm::vec4 w = row(viewProjection, 3);
+    for (int axis = 0; axis < 3; ++axis) {
+        const glm::vec4 r = row(viewProjection, axis);
+        planes[2 * axis] = w + r;
+        planes[2 * axis + 1] = w - r;
+    }
+    for (glm::vec4& plane : planes) {
+        const float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        plane = plane / length;
+    }
+}
+
+bool Frustum::intersects(const glm::vec3& center, float radius) const {
+    for (const glm::vec4& plane : planes) {
+        if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+float projectedDiameter(const glm::mat4& viewProjection, float pixelsPerUnit, const glm::vec3& center, float radius) {
+    // Clip w is the depth along the view direction
+    const glm::vec4 w = row(viewProjection, 3);
+    const float depth = w.x * center.x + w.y * center.y + w.z * center.z + w.w;
+    if (depth <= radius) {
+        return std::numeric_limits<float>::infinity();
+    }
+    return 2.0f * radius * pixelsPerUnit / depth;
+}
+
+BodyLod chooseLod(float diameter, const LodThresholds& thresholds) {
+    if (diameter < thresholds.impostor) return BodyLod::Point;
+    if (diameter < thresholds.sphere32) return BodyLod::Impostor;
+    if (diameter < thresholds.sphere64) return BodyLod::Sphere32;
+    if (diameter < thresholds.sphere128) return BodyLod::Sphere64;
+    return BodyLod::Sphere128;
+}
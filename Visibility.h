@@ -0,0 +1,50 @@
+//
+// Created by Quinta on 10/18/2026.
+//
+
+#ifndef GRAVITY_VISIBILITY_H
+#define GRAVITY_VISIBILITY_H
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+
+// How a visible body is drawn, from cheapest to most detailed
+enum class BodyLod : uint8_t {
+    Point,      // Under a pixel across: one vertex
+    Impostor,   // A quad ray-cast into a sphere in the fragment shader: four vertices
+    Sphere32,   // 32 x 16 mesh
+    Sphere64,   // 64 x 32 mesh
+    Sphere128,  // 128 x 64 mesh
+    Count
+};
+
+// Projected diameters in pixels from which each level takes over. Between
+// switches a mesh edge stays under about 12 pixels long.
+struct LodThresholds {
+    float impostor = 1.0f;
+    float sphere32 = 64.0f;
+    float sphere64 = 128.0f;
+    float sphere128 = 256.0f;
+};
+
+// The six planes of a view-projection matrix, for culling bounding spheres
+class Frustum {
+public:
+    explicit Frustum(const glm::mat4& viewProjection);
+
+    // False only when the sphere lies wholly outside one of the planes, so a
+    // few spheres near the corners are kept although they are not visible
+    bool intersects(const glm::vec3& center, float radius) const;
+
+private:
+    glm::vec4 planes[6];  // Inward normal in xyz, offset in w
+};
+
+// Diameter in pixels of a sphere seen through viewProjection, where
+// pixelsPerUnit is the viewport height over 2 tan(fov / 2). Spheres that
+// reach behind the camera count as infinitely large.
+float projectedDiameter(const glm::mat4& viewProjection, float pixelsPerUnit, const glm::vec3& center, float radius);
+
+BodyLod chooseLod(float diameter, const LodThresholds& thresholds = LodThresholds());
+
+#endif //GRAVITY_VISIBILITY_H
@@ -0,0 +1,415 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+#include "Simulator.h"
+#include "Distributed.h"
+#include "ForceKernels.h"
+#include "Scenario.h"
+#include "Transport.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef GRAVITY_SOCKET_TRANSPORT
+#include <unistd.h>
+#endif
+
+namespace {
+    const double AU = 149.6e9;
+
+    struct Options {
+        size_t minBodies = 10;
+        size_t maxBodies = 1000000;
+        std::vector<std::string> kernels = {"force", "pairwise_double", "pairwise_mixed", "pairwise_float",
+                                            "update_pairwise", "update_barnes_hut", "update_multipole",
+                                            "update_mesh", "body_update", "collisions", "trajectory",
+                                            "rebalance"};
+        std::vector<std::string> distributions = {"uniform", "clustered", "solar"};
+        size_t threads = std::thread::hardware_concurrency();
+        double budget = 1.0;            // Seconds of timing per measurement
+        double memoryLimit = 4e9;       // Bytes; larger trajectory runs are skipped
+        std::string format = "csv";
+        std::string output;
+        std::string baseline;
+        double threshold = 10.0;        // Percent
+    };
+
+    struct Result {
+        std::string kernel;
+        std::string distribution;
+        size_t bodies = 0;
+        size_t threads = 1;
+        size_t iterations = 0;
+        double secondsPerIteration = 0.0;
+        double interactionsPerIteration = 0.0;
+        bool skipped = false;
+
+        double nsPerInteraction() const {
+            return interactionsPerIteration > 0.0 ? secondsPerIteration * 1e9 / interactionsPerIteration : 0.0;
+        }
+        double stepsPerSecond() const { return secondsPerIteration > 0.0 ? 1.0 / secondsPerIteration : 0.0; }
+        std::string key() const { return kernel + "/" + distribution + "/" + std::to_string(bodies); }
+    };
+
+    std::vector<std::string> split(const std::string& text, char separator) {
+        std::vector<std::string> parts;
+        std::stringstream stream(text);
+        std::string part;
+        while (std::getline(stream, part, separator)) {
+            parts.push_back(part);
+        }
+        return parts;
+    }
+
+    // Random masses between 1e20 and 1e24 kg with small radii so collisions stay rare
+    CelestialBody randomBody(std::mt19937_64& rng, const glm::dvec3& position) {
+        std::uniform_real_distribution<double> logMass(20.0, 24.0);
+        return CelestialBody(std::pow(10.0, logMass(rng)), position, glm::dvec3(0.0), 1e3);
+    }
+
+    void populate(Simulator& simulator, const std::string& distribution, size_t bodies, unsigned seed) {
+        std::mt19937_64 rng(seed);
+        if (distribution == "solar") {
+            // The main.cpp solar system, padded out with belt asteroids
+            addAsteroidBelt(simulator, bodies > 10 ? bodies - 10 : 0, seed);
+        } else if (distribution == "clustered") {
+            std::uniform_real_distribution<double> centre(-20.0 * AU, 20.0 * AU);
+            std::normal_distribution<double> spread(0.0, 0.5 * AU);
+            std::vector<glm::dvec3> centres(16);
+            for (auto& c : centres) {
+                c = glm::dvec3(centre(rng), centre(rng), centre(rng));
+            }
+            for (size_t i = 0; i < bodies; ++i) {
+                const glm::dvec3& c = centres[i % centres.size()];
+                simulator.addBody(randomBody(rng, c + glm::dvec3(spread(rng), spread(rng), spread(rng))));
+            }
+        } else {
+            std::uniform_real_distribution<double> coordinate(-20.0 * AU, 20.0 * AU);
+            for (size_t i = 0; i < bodies; ++i) {
+                simulator.addBody(randomBody(rng, glm::dvec3(coordinate(rng), coordinate(rng), coordinate(rng))));
+            }
+        }
+    }
+
+    // Repeats run until the budget is spent (at least once) and returns seconds per call
+    double timeIt(const std::function<void()>& run, double budget, size_t& iterations) {
+        using clock = std::chrono::steady_clock;
+        iterations = 0;
+        auto start = clock::now();
+        double elapsed = 0.0;
+        do {
+            run();
+            ++iterations;
+            elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        } while (elapsed < budget);
+        return elapsed / static_cast<double>(iterations);
+    }
+
+#ifdef GRAVITY_SOCKET_TRANSPORT
+    // Three forked ranks cut the domains again and again, alternating between
+    // the curves so that about a third of the bodies change owner every time.
+    // Before each call, rank 0 tells the workers whether another one follows.
+    double timeRebalance(const Simulator& simulator, double budget, size_t& iterations) {
+        std::cout.flush();
+        std::cerr.flush();
+        std::unique_ptr<SocketTransport> transport = SocketTransport::fork(3);
+        DistributedSimulator distributed(*transport, simulator);
+        auto rebalance = [&distributed]() {
+            distributed.setCurve(distributed.getCurve() == CurveOrder::Hilbert ? CurveOrder::Morton
+                                                                              : CurveOrder::Hilbert);
+            distributed.rebalance();
+        };
+        const Transport::Message more(1, 1), done(1, 0);
+        if (transport->getRank() != 0) {
+            while (transport->allGather(done)[0][0]) {
+                rebalance();
+            }
+            _exit(0);
+        }
+        const double seconds = timeIt([&]() {
+            transport->allGather(more);
+            rebalance();
+        }, budget, iterations);
+        transport->allGather(done);
+        return seconds;
+    }
+#endif
+
+    Result measure(const Options& options, const std::string& kernel, const std::string& distribution, size_t bodies) {
+        Result result;
+        result.kernel = kernel;
+        result.distribution = distribution;
+        result.bodies = bodies;
+        result.threads = 1;
+
+        Simulator simulator;
+        populate(simulator, distribution, bodies, 1);
+        const BodyStore& store = simulator.getBodies();
+        const double n = static_cast<double>(store.size());
+        const double dt = 3600.0;
+
+        if (kernel == "force") {
+            // A fixed sample of random pairs so the cost is independent of N
+            std::mt19937_64 rng(2);
+            std::uniform_int_distribution<size_t> pick(0, store.size() - 1);
+            const size_t sampleCount = 100000;
+            std::vector<CelestialBody> first, second;
+            for (size_t k = 0; k < 1024; ++k) {
+                size_t i = pick(rng), j = pick(rng);
+                if (i == j) j = (j + 1) % store.size();
+                first.push_back(store.get(i));
+                second.push_back(store.get(j));
+            }
+            result.secondsPerIteration = timeIt([&]() {
+                glm::dvec3 sum(0.0);
+                for (size_t k = 0; k < sampleCount; ++k) {
+                    sum += simulator.calculateGravitationalForce(first[k & 1023], second[k & 1023]);
+                }
+                // Keeps the forces from being optimised away
+                volatile double sink = sum.x + sum.y + sum.z;
+                (void)sink;
+            }, options.budget, result.iterations);
+            result.interactionsPerIteration = static_cast<double>(sampleCount);
+        } else if (kernel == "pairwise_double" || kernel == "pairwise_mixed" || kernel == "pairwise_float") {
+            // Direct summation alone under each precision policy, with the build's softening
+            simulator.setThreadCount(options.threads);
+            result.threads = simulator.getThreadCount();
+            BodyStore copy = store;
+            auto sum = kernel == "pairwise_double" ? accumulatePairwiseAccelerations<DoublePrecision>
+                       : kernel == "pairwise_mixed" ? accumulatePairwiseAccelerations<MixedPrecision>
+                       : accumulatePairwiseAccelerations<FloatPrecision>;
+            result.secondsPerIteration = timeIt([&]() { sum(copy, simulator.getThreadPool(), nullptr); },
+                                                options.budget, result.iterations);
+            result.interactionsPerIteration = n * (n - 1.0) / 2.0;
+        } else if (kernel == "update_pairwise" || kernel == "update_barnes_hut" || kernel == "update_multipole"
+                   || kernel == "update_mesh") {
+            // A whole step: forces, integration, trajectory upkeep and the
+            // collision sweep. Interactions are the pairs for direct summation
+            // and the bodies for the other solvers, whose pair counts depend on
+            // the distribution, so these are whole-step costs per pair or body.
+            simulator.setThreadCount(options.threads);
+            result.threads = simulator.getThreadCount();
+            if (kernel == "update_pairwise") {
+                result.interactionsPerIteration = n * (n - 1.0) / 2.0;
+            } else {
+                simulator.setForceSolver(kernel == "update_barnes_hut" ? ForceSolver::BarnesHut
+                                         : kernel == "update_multipole" ? ForceSolver::FastMultipole
+                                         : ForceSolver::ParticleMesh);
+                result.interactionsPerIteration = n;
+            }
+            simulator.update(dt);   // Warm up: first step sorts and sizes the buffers
+            result.secondsPerIteration = timeIt([&]() { simulator.update(dt); }, options.budget, result.iterations);
+        } else if (kernel == "body_update") {
+            std::vector<CelestialBody> bodyList;
+            bodyList.reserve(store.size());
+            for (size_t i = 0; i < store.size(); ++i) {
+                bodyList.push_back(store.get(i));
+                bodyList.back().applyForce(glm::dvec3(1e15, 0.0, 0.0));
+            }
+            result.secondsPerIteration = timeIt([&]() {
+                for (auto& body : bodyList) {
+                    body.update(dt);
+                }
+            }, options.budget, result.iterations);
+            result.interactionsPerIteration = n;
+        } else if (kernel == "collisions") {
+            simulator.setThreadCount(options.threads);
+            result.threads = simulator.getThreadCount();
+            // One interaction per body's search of the sorted list plus one per
+            // candidate pair it tested, so a broad phase that lets through more
+            // pairs shows up. Bodies are small enough that nothing merges.
+            simulator.checkCollisions();
+            result.secondsPerIteration = timeIt([&]() { simulator.checkCollisions(); }, options.budget, result.iterations);
+            result.interactionsPerIteration = n + static_cast<double>(simulator.getCollisionTests());
+        } else if (kernel == "trajectory") {
+            // Steady state: every trajectory already holds its maximum number of points
+            BodyStore copy = store;
+            for (size_t i = 0; i < copy.size(); ++i) {
+                for (size_t k = 0; k < copy.trajectory.getHistoryLength(); ++k) {
+                    copy.addToTrajectory(i, copy.getPosition(i));
+                }
+            }
+            result.secondsPerIteration = timeIt([&]() {
+                for (size_t i = 0; i < copy.size(); ++i) {
+                    copy.addToTrajectory(i, copy.getPosition(i));
+                }
+            }, options.budget, result.iterations);
+            result.interactionsPerIteration = n;
+        } else if (kernel == "rebalance") {
+            // Wall time of moving the bodies between ranks, per body
+#ifdef GRAVITY_SOCKET_TRANSPORT
+            result.secondsPerIteration = timeRebalance(simulator, options.budget, result.iterations);
+            result.interactionsPerIteration = n;
+#else
+            result.skipped = true;
+#endif
+        }
+        return result;
+    }
+
+    void writeCsv(std::ostream& out, const std::vector<Result>& results) {
+        out << "kernel,distribution,bodies,threads,iterations,seconds_per_iteration,interactions_per_iteration,"
+               "ns_per_interaction,steps_per_second,skipped\n";
+        for (const auto& r : results) {
+            out << r.kernel << ',' << r.distribution << ',' << r.bodies << ',' << r.threads << ','
+                << r.iterations << ',' << r.secondsPerIteration << ',' << r.interactionsPerIteration << ','
+                << r.nsPerInteraction() << ',' << r.stepsPerSecond() << ',' << (r.skipped ? 1 : 0) << '\n';
+        }
+    }
+
+    void writeJson(std::ostream& out, const std::vector<Result>& results) {
+        out << "[\n";
+        for (size_t k = 0; k < results.size(); ++k) {
+            const auto& r = results[k];
+            out << "  {\"kernel\": \"" << r.kernel << "\", \"distribution\": \"" << r.distribution
+                << "\", \"bodies\": " << r.bodies << ", \"threads\": " << r.threads
+                << ", \"iterations\": " << r.iterations << ", \"seconds_per_iteration\": " << r.secondsPerIteration
+                << ", \"interactions_per_iteration\": " << r.interactionsPerIteration
+                << ", \"ns_per_interaction\": " << r.nsPerInteraction()
+                << ", \"steps_per_second\": " << r.stepsPerSecond()
+                << ", \"skipped\": " << (r.skipped ? "true" : "false") << "}"
+                << (k + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "]\n";
+    }
+
+    // Reads ns_per_interaction per kernel/distribution/bodies from a CSV written by this tool
+    bool readBaseline(const std::string& path, std::map<std::string, double>& baseline) {
+        std::ifstream in(path);
+        if (!in) return false;
+        std::string line;
+        std::getline(in, line);
+        while (std::getline(in, line)) {
+            auto fields = split(line, ',');
+            if (fields.size() < 10 || fields[9] == "1") continue;
+            baseline[fields[0] + "/" + fields[1] + "/" + fields[2]] = std::stod(fields[7]);
+        }
+        return true;
+    }
+
+    void printUsage(const char* program) {
+        std::cerr << "Usage: " << program << " [options]\n"
+                  << "  --min-bodies N        Smallest body count (default 10)\n"
+                  << "  --max-bodies N        Largest body count, in powers of ten (default 1000000)\n"
+                  << "  --kernels LIST        Comma separated: force, pairwise_double, pairwise_mixed,\n"
+                  << "                        pairwise_float, update_pairwise, update_barnes_hut,\n"
+                  << "                        update_multipole, update_mesh, body_update, collisions,\n"
+                  << "                        trajectory, rebalance\n"
+                  << "                        (default all)\n"
+                  << "  --distributions LIST  Comma separated: uniform, clustered, solar (default all)\n"
+                  << "  --threads N           Threads for update and collisions (default: hardware cores)\n"
+                  << "  --budget SECONDS      Timing budget per measurement (default 1)\n"
+                  << "  --format csv|json     Output format (default csv)\n"
+                  << "  --output PATH         Write results to PATH instead of stdout\n"
+                  << "  --baseline PATH       Compare against a CSV written by an earlier run\n"
+                  << "  --threshold PERCENT   Slowdown that counts as a regression (default 10)\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--min-bodies" && hasValue) {
+                options.minBodies = std::stoul(argv[++i]);
+            } else if (arg == "--max-bodies" && hasValue) {
+                options.maxBodies = std::stoul(argv[++i]);
+            } else if (arg == "--kernels" && hasValue) {
+                options.kernels = split(argv[++i], ',');
+            } else if (arg == "--distributions" && hasValue) {
+                options.distributions = split(argv[++i], ',');
+            } else if (arg == "--threads" && hasValue) {
+                options.threads = std::stoul(argv[++i]);
+            } else if (arg == "--budget" && hasValue) {
+                options.budget = std::stod(argv[++i]);
+            } else if (arg == "--format" && hasValue) {
+                options.format = argv[++i];
+            } else if (arg == "--output" && hasValue) {
+                options.output = argv[++i];
+            } else if (arg == "--baseline" && hasValue) {
+                options.baseline = argv[++i];
+            } else if (arg == "--threshold" && hasValue) {
+                options.threshold = std::stod(argv[++i]);
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::exception&) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<Result> results;
+    for (const auto& kernel : options.kernels) {
+        for (const auto& distribution : options.distributions) {
+            bool overBudget = false;
+            for (size_t bodies = options.minBodies; bodies <= options.maxBodies; bodies *= 10) {
+                // Once one call takes longer than the budget, larger N would only take longer
+                double trajectoryBytes = std::min(static_cast<double>(TrajectoryStore::getMemoryBudget()),
+                                                  static_cast<double>(bodies) * TrajectoryStore::LEVELS
+                                                      * TrajectoryStore::MAX_POINTS_PER_LEVEL * sizeof(glm::vec3));
+                if (overBudget || (kernel == "trajectory" && trajectoryBytes > options.memoryLimit)) {
+                    Result skipped;
+                    skipped.kernel = kernel;
+                    skipped.distribution = distribution;
+                    skipped.bodies = bodies;
+                    skipped.skipped = true;
+                    results.push_back(skipped);
+                    continue;
+                }
+                Result result = measure(options, kernel, distribution, bodies);
+                overBudget = result.secondsPerIteration > options.budget;
+                results.push_back(result);
+                std::cerr << result.key() << ": " << result.nsPerInteraction() << " ns/interaction" << std::endl;
+            }
+        }
+    }
+
+    std::ofstream file;
+    if (!options.output.empty()) {
+        file.open(options.output);
+        if (!file) {
+            std::cerr << "Cannot write " << options.output << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = options.output.empty() ? std::cout : file;
+    if (options.format == "json") {
+        writeJson(out, results);
+    } else {
+        writeCsv(out, results);
+    }
+
+    if (options.baseline.empty()) return 0;
+
+    std::map<std::string, double> baseline;
+    if (!readBaseline(options.baseline, baseline)) {
+        std::cerr << "Cannot read baseline " << options.baseline << std::endl;
+        return 1;
+    }
+    int regressions = 0;
+    for (const auto& r : results) {
+        auto it = baseline.find(r.key());
+        if (r.skipped || it == baseline.end() || it->second <= 0.0) continue;
+        double change = (r.nsPerInteraction() / it->second - 1.0) * 100.0;
+        if (change > options.threshold) {
+            std::cerr << "REGRESSION " << r.key() << ": " << it->second << " -> " << r.nsPerInteraction()
+                      << " ns/interaction (+" << change << "%)" << std::endl;
+            ++regressions;
+        }
+    }
+    std::cerr << regressions << " regression(s) above " << options.threshold << "%" << std::endl;
+    return regressions > 0 ? 2 : 0;
+}
@@ -0,0 +1,518 @@
+//
+// Created by Quinta on 10/17/2026.
+//
+#include "Simulator.h"
+#include "Checkpoint.h"
+#include "Distributed.h"
+#include "Ensemble.h"
+#include "Profiler.h"
+#include "Scenario.h"
+#include "StateStream.h"
+#include "Transport.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef GRAVITY_SOCKET_TRANSPORT
+#include <unistd.h>
+#endif
+
+namespace {
+    void printUsage(const char* program) {
+        std::cerr << "Usage: " << program << " [options]\n"
+                  << "  --steps N          Number of steps to run (default 8760, one year at dt = 3600)\n"
+                  << "  --dt SECONDS       Time step (default 3600)\n"
+                  << "  --scenario NAME    solar, belt, cloud, plummer, disk, kepler, or a .csv/.bin body table\n"
+                  << "                     (default solar)\n"
+                  << "  --bodies N         Bodies for the generated scenarios (default 1000)\n"
+                  << "  --seed N           Random seed for generated scenarios (default 1)\n"
+                  << "  --threads N        Worker threads (default: one per hardware core)\n"
+                  << "  --barnes-hut       Use the Barnes-Hut solver instead of direct summation\n"
+                  << "  --fmm              Use the fast multipole solver instead of direct summation\n"
+                  << "  --theta T          Tree opening angle (default 0.5 for Barnes-Hut, 0.8 for --fmm)\n"
+                  << "  --order P          Multipole expansion order (default 4)\n"
+                  << "  --pm               Use the particle-mesh solver instead of direct summation\n"
+                  << "  --mesh N           Particle-mesh side, a power of two (default 64)\n"
+                  << "  --cic              Cloud-in-cell mass assignment instead of triangular-shaped cloud\n"
+                  << "  --check-forces N   Before running, compare the solver with direct summation\n"
+                  << "                     for N random bodies\n"
+                  << "  --integrator NAME  leapfrog, yoshida4 or constant (default leapfrog)\n"
+                  << "  --block-levels N   Leapfrog block timesteps down to dt / 2^N (default off)\n"
+                  << "  --eta E            Block timestep accuracy parameter (default 0.01)\n"
+                  << "  --restart PATH     Continue from a checkpoint instead of loading a scenario\n"
+                  << "  --checkpoint PATH  Write a checkpoint at the end of the run\n"
+                  << "  --checkpoint-every N  Also write it every N steps, in the background\n"
+                  << "  --output PATH      Stream positions, velocities, masses and ids to a columnar file\n"
+                  << "  --output-every K   Record every K steps (default 1)\n"
+                  << "  --compress         Delta-code the streamed columns\n"
+                  << "  --profile-every N  Print phase timings and counters every N steps\n"
+                  << "                     (needs a GRAVITY_PROFILE build)\n"
+                  << "  --trace PATH       Write a Chrome trace of every phase at the end of the run\n"
+                  << "  --ensemble M       Step M copies of the scenario together (leapfrog, direct summation)\n"
+                  << "  --perturb E        Offset each copy but the first by a relative Gaussian of width E\n"
+                  << "  --mass-sweep BODY LOW HIGH  Sweep the mass of BODY linearly across the copies\n"
+                  << "  --summary PATH     Per-member summaries as CSV (default standard output)\n"
+                  << "  --summary-every K  Write summaries every K steps (default: at the end only)\n"
+                  << "  --events-every S   Report merges, softened and rejected forces and close encounters\n"
+                  << "                     at most every S seconds of wall time (default 1, 0 turns them off)\n"
+                  << "  --encounter-distance D  Report pairs passing within D metres (default off)\n"
+                  << "  --conservation-every K  Print energy, momentum and angular momentum drifts every K steps\n"
+                  << "  --drift-threshold X     Report drifts beyond X, relative (default 1e-3, 0 never)\n"
+                  << "  --processes N      Split the bodies over N processes on this machine (leapfrog, Barnes-Hut;\n"
+                  << "                     --threads is shared between them)\n"
+                  << "  --rebalance-every K  Cut the domains again every K steps (default 10, 0 never)\n"
+                  << "  --curve NAME       Domain order, hilbert or morton (default hilbert)\n";
+    }
+
+    void printConservation(std::ostream& out, const Simulator& simulator) {
+        const ConservationSample& sample = simulator.getConservation();
+        const ConservationDrift& drift = simulator.getConservationDrift();
+        out << "t = " << sample.time << " s: E = " << sample.totalEnergy() << " J (kinetic "
+            << sample.kineticEnergy << ", potential " << sample.potentialEnergy << "), drift: energy "
+            << drift.energy << ", momentum " << drift.momentum << ", angular momentum " << drift.angularMomentum
+            << ", centre of mass " << drift.centerOfMass << std::endl;
+    }
+
+    struct MassSweep {
+        size_t body;
+        double low;
+        double high;
+    };
+
+    void writeSummaries(std::ostream& out, const std::vector<EnsembleSummary>& summaries) {
+        for (const EnsembleSummary& s : summaries) {
+            out << s.time << ',' << s.member << ',' << s.kineticEnergy << ',' << s.potentialEnergy << ','
+                << s.energyError << ',' << s.minSeparation << '\n';
+        }
+    }
+
+    // Steps the members in runs of summaryInterval steps, each one update of
+    // the ensemble, and writes their summaries after every run
+    int runEnsemble(const Simulator& simulator, size_t members, double perturbation, unsigned seed,
+                    const std::vector<MassSweep>& sweeps, long long steps, double dt,
+                    const std::string& summaryPath, long long summaryInterval) {
+        Ensemble ensemble(simulator, members);
+        ensemble.setThreadCount(simulator.getThreadCount());
+        std::ofstream file;
+        if (!summaryPath.empty()) {
+            file.open(summaryPath);
+            if (!file) {
+                std::cerr << "Cannot write " << summaryPath << std::endl;
+                return 1;
+            }
+        }
+        std::ostream& out = summaryPath.empty() ? std::cout : file;
+        const std::streamsize precision = out.precision(17);
+        try {
+            if (perturbation > 0.0) {
+                ensemble.perturb(perturbation, seed);
+            }
+            for (const MassSweep& sweep : sweeps) {
+                ensemble.sweepMass(sweep.body, sweep.low, sweep.high);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+
+        std::cout << "Running " << steps << " steps of " << dt << " s on " << members << " members of "
+                  << ensemble.getBodyCount() << " bodies with " << ensemble.getThreadCount() << " thread(s)"
+                  << std::endl;
+        out << "time,member,kinetic,potential,energy_error,min_separation\n";
+        const long long interval = summaryInterval > 0 ? summaryInterval : std::max(steps, 1LL);
+        double summarySeconds = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (long long step = 0; step < steps; step += interval) {
+            ensemble.update(dt, static_cast<size_t>(std::min(interval, steps - step)));
+            auto summaryStart = std::chrono::steady_clock::now();
+            writeSummaries(out, ensemble.summarize());
+            summarySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - summaryStart).count();
+        }
+        out.flush();
+        out.precision(precision);
+        double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double stepSeconds = wallSeconds - summarySeconds;
+
+        std::cout << "Simulated time: " << steps * dt << " s\n"
+                  << "Wall time:      " << wallSeconds << " s (" << summarySeconds << " s in summaries)\n"
+                  << "Member-steps/s: " << (stepSeconds > 0.0 ? ensemble.getMemberSteps() / stepSeconds : 0.0)
+                  << std::endl;
+        return 0;
+    }
+
+    // Forks the workers and runs every rank's share of the steps; only rank 0
+    // prints. The simulator's threads are stopped first, since a forked
+    // process would not have them, and the thread count is split between the
+    // processes.
+    int runDistributed(Simulator& simulator, size_t processes, size_t rebalanceInterval, CurveOrder curve,
+                       long long steps, double dt) {
+        const size_t threads = std::max<size_t>(simulator.getThreadCount() / processes, 1);
+        simulator.setThreadCount(1);
+        std::cout.flush();
+        std::cerr.flush();
+        std::unique_ptr<Transport> transport;
+        try {
+            if (processes > 1) {
+#ifdef GRAVITY_SOCKET_TRANSPORT
+                transport = SocketTransport::fork(processes);
+#else
+                throw std::runtime_error("--processes above 1 is unsupported on this platform");
+#endif
+            } else {
+                transport = std::make_unique<LocalTransport>();
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        const bool root = transport->getRank() == 0;
+        Profiler::setThreadName("rank " + std::to_string(transport->getRank()));
+
+        try {
+            DistributedSimulator distributed(*transport, simulator);
+            distributed.setThreadCount(threads);
+            distributed.setRebalanceInterval(rebalanceInterval);
+            distributed.setCurve(curve);
+            if (root) {
+                std::cout << "Running " << steps << " steps of " << dt << " s on " << distributed.getGlobalBodyCount()
+                          << " bodies with " << processes << " process(es) of " << threads << " thread(s)"
+                          << std::endl;
+            }
+            auto start = std::chrono::steady_clock::now();
+            for (long long step = 0; step < steps; ++step) {
+                distributed.update(dt);
+            }
+            double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            const std::vector<DistributedStatistics> statistics = distributed.gatherStatistics();
+#ifdef GRAVITY_SOCKET_TRANSPORT
+            if (!root) {
+                // A forked worker leaves without running the parent's exit handlers and destructors
+                std::cout.flush();
+                _exit(0);
+            }
+#endif
+            uint64_t fewest = statistics[0].bodies, most = 0, importedPoints = 0, migrated = 0, bytes = 0;
+            double work = 0.0, largestWork = 0.0;
+            for (const DistributedStatistics& s : statistics) {
+                fewest = std::min(fewest, s.bodies);
+                most = std::max(most, s.bodies);
+                importedPoints += s.importedPoints;
+                migrated += s.migratedBodies;
+                bytes += s.bytesSent;
+                work += s.work;
+                largestWork = std::max(largestWork, s.work);
+            }
+            const double meanWork = work / static_cast<double>(statistics.size());
+            std::cout << "Simulated time: " << steps * dt << " s\n"
+                      << "Wall time:      " << wallSeconds << " s\n"
+                      << "Steps/second:   " << (wallSeconds > 0.0 ? steps / wallSeconds : 0.0) << "\n"
+                      << "Bodies/rank:    " << fewest << " to " << most << "\n"
+                      << "Imported:       " << importedPoints << " cells and bodies in the last step\n"
+                      << "Rebalances:     " << statistics[0].rebalances << ", " << migrated << " bodies moved\n"
+                      << "Exchanged:      " << bytes / 1e6 << " MB\n"
+                      << "Load imbalance: " << (meanWork > 0.0 ? largestWork / meanWork : 1.0)
+                      << " (largest rank's tree interactions over the mean)" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Rank " << transport->getRank() << ": " << e.what() << std::endl;
+#ifdef GRAVITY_SOCKET_TRANSPORT
+            if (!root) _exit(1);
+#endif
+            return 1;
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Simulator simulator;
+    simulator.setThreadCount(std::thread::hardware_concurrency());
+    std::string scenario = "solar";
+    size_t bodyCount = 1000;
+    unsigned seed = 1;
+    long long steps = 8760;
+    double dt = 3600.0;
+    int blockLevels = -1;
+    double eta = 0.01;
+    std::string restartPath;
+    std::string checkpointPath;
+    long long checkpointInterval = 0;
+    std::string outputPath;
+    size_t outputInterval = 1;
+    bool compress = false;
+    long long profileInterval = 0;
+    std::string tracePath;
+    size_t checkSamples = 0;
+    size_t ensembleMembers = 0;
+    double perturbation = 0.0;
+    std::vector<MassSweep> sweeps;
+    std::string summaryPath;
+    long long summaryInterval = 0;
+    double eventInterval = 1.0;
+    size_t conservationInterval = 0;
+    double driftThreshold = 1e-3;
+    size_t processes = 0;
+    size_t rebalanceInterval = 10;
+    CurveOrder curve = CurveOrder::Hilbert;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--steps" && hasValue) {
+                steps = std::stoll(argv[++i]);
+            } else if (arg == "--dt" && hasValue) {
+                dt = std::stod(argv[++i]);
+            } else if (arg == "--scenario" && hasValue) {
+                scenario = argv[++i];
+            } else if (arg == "--bodies" && hasValue) {
+                bodyCount = std::stoul(argv[++i]);
+            } else if (arg == "--seed" && hasValue) {
+                seed = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (arg == "--threads" && hasValue) {
+                simulator.setThreadCount(std::stoul(argv[++i]));
+            } else if (arg == "--barnes-hut") {
+                simulator.setForceSolver(ForceSolver::BarnesHut);
+            } else if (arg == "--fmm") {
+                simulator.setForceSolver(ForceSolver::FastMultipole);
+            } else if (arg == "--theta" && hasValue) {
+                simulator.setOpeningAngle(std::stod(argv[++i]));
+            } else if (arg == "--order" && hasValue) {
+                simulator.setMultipoleOrder(std::stoi(argv[++i]));
+            } else if (arg == "--pm") {
+                simulator.setForceSolver(ForceSolver::ParticleMesh);
+            } else if (arg == "--mesh" && hasValue) {
+                simulator.setMeshSize(std::stoul(argv[++i]));
+            } else if (arg == "--cic") {
+                simulator.setMassAssignment(MassAssignment::CloudInCell);
+            } else if (arg == "--check-forces" && hasValue) {
+                checkSamples = std::stoul(argv[++i]);
+            } else if (arg == "--integrator" && hasValue) {
+                std::string name = argv[++i];
+                if (name == "leapfrog") {
+                    simulator.setIntegrator(Integrator::Leapfrog);
+                } else if (name == "yoshida4") {
+                    simulator.setIntegrator(Integrator::Yoshida4);
+                } else if (name == "constant") {
+                    simulator.setIntegrator(Integrator::ConstantAcceleration);
+                } else {
+                    printUsage(argv[0]);
+                    return 1;
+                }
+            } else if (arg == "--block-levels" && hasValue) {
+                blockLevels = std::stoi(argv[++i]);
+            } else if (arg == "--eta" && hasValue) {
+                eta = std::stod(argv[++i]);
+            } else if (arg == "--restart" && hasValue) {
+                restartPath = argv[++i];
+            } else if (arg == "--checkpoint" && hasValue) {
+                checkpointPath = argv[++i];
+            } else if (arg == "--checkpoint-every" && hasValue) {
+                checkpointInterval = std::stoll(argv[++i]);
+            } else if (arg == "--output" && hasValue) {
+                outputPath = argv[++i];
+            } else if (arg == "--output-every" && hasValue) {
+                outputInterval = std::stoul(argv[++i]);
+            } else if (arg == "--compress") {
+                compress = true;
+            } else if (arg == "--profile-every" && hasValue) {
+                profileInterval = std::stoll(argv[++i]);
+            } else if (arg == "--trace" && hasValue) {
+                tracePath = argv[++i];
+            } else if (arg == "--ensemble" && hasValue) {
+                ensembleMembers = std::stoul(argv[++i]);
+            } else if (arg == "--perturb" && hasValue) {
+                perturbation = std::stod(argv[++i]);
+            } else if (arg == "--mass-sweep" && i + 3 < argc) {
+                MassSweep sweep;
+                sweep.body = std::stoul(argv[++i]);
+                sweep.low = std::stod(argv[++i]);
+                sweep.high = std::stod(argv[++i]);
+                sweeps.push_back(sweep);
+            } else if (arg == "--summary" && hasValue) {
+                summaryPath = argv[++i];
+            } else if (arg == "--summary-every" && hasValue) {
+                summaryInterval = std::stoll(argv[++i]);
+            } else if (arg == "--events-every" && hasValue) {
+                eventInterval = std::stod(argv[++i]);
+            } else if (arg == "--encounter-distance" && hasValue) {
+                simulator.setEncounterDistance(std::stod(argv[++i]));
+            } else if (arg == "--conservation-every" && hasValue) {
+                conservationInterval = std::stoul(argv[++i]);
+            } else if (arg == "--drift-threshold" && hasValue) {
+                driftThreshold = std::stod(argv[++i]);
+            } else if (arg == "--processes" && hasValue) {
+                processes = std::stoul(argv[++i]);
+            } else if (arg == "--rebalance-every" && hasValue) {
+                rebalanceInterval = std::stoul(argv[++i]);
+            } else if (arg == "--curve" && hasValue) {
+                std::string name = argv[++i];
+                if (name == "hilbert") {
+                    curve = CurveOrder::Hilbert;
+                } else if (name == "morton") {
+                    curve = CurveOrder::Morton;
+                } else {
+                    printUsage(argv[0]);
+                    return 1;
+                }
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::exception&) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (ensembleMembers > 0 && (!restartPath.empty() || !checkpointPath.empty() || !outputPath.empty()
+                                || blockLevels >= 0 || checkSamples > 0
+                                || simulator.getForceSolver() != ForceSolver::Pairwise
+                                || simulator.getIntegrator() != Integrator::Leapfrog)) {
+        std::cerr << "--ensemble runs leapfrog with direct summation from a scenario; it cannot be combined with "
+                     "--restart, --checkpoint, --output, --block-levels, --check-forces, another solver or "
+                     "another integrator" << std::endl;
+        return 1;
+    }
+    if (processes > 0 && (ensembleMembers > 0 || !restartPath.empty() || !checkpointPath.empty()
+                          || !outputPath.empty() || blockLevels >= 0 || checkSamples > 0 || conservationInterval > 0
+                          || (simulator.getForceSolver() != ForceSolver::Pairwise
+                              && simulator.getForceSolver() != ForceSolver::BarnesHut)
+                          || simulator.getIntegrator() != Integrator::Leapfrog)) {
+        std::cerr << "--processes runs leapfrog with Barnes-Hut from a scenario; it cannot be combined with "
+                     "--ensemble, --restart, --checkpoint, --output, --block-levels, --check-forces, "
+                     "--conservation-every, another solver or another integrator" << std::endl;
+        return 1;
+    }
+    if (blockLevels >= 0) {
+        simulator.setBlockTimesteps(true, blockLevels, eta);
+    }
+    if ((profileInterval > 0 || !tracePath.empty()) && !Profiler::ENABLED) {
+        std::cerr << "Built without GRAVITY_PROFILE, --profile-every and --trace have no effect" << std::endl;
+    }
+    Profiler::setThreadName("main");
+    Profiler::setTracing(!tracePath.empty());
+
+    if (!restartPath.empty()) {
+        // The checkpoint's own solver and integrator settings replace any given above
+        try {
+            Checkpoint::load(simulator, restartPath);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "Restarting at t = " << simulator.getTime() << " s from " << restartPath << std::endl;
+    } else {
+        auto loadStart = std::chrono::steady_clock::now();
+        try {
+            if (!loadScenario(simulator, scenario, bodyCount, seed)) {
+                std::cerr << "Unknown scenario: " << scenario << std::endl;
+                return 1;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+        std::cout << "Set up " << simulator.getBodies().size() << " bodies in " << loadSeconds << " s" << std::endl;
+    }
+
+    if (ensembleMembers > 0) {
+        int result = runEnsemble(simulator, ensembleMembers, perturbation, seed, sweeps, steps, dt, summaryPath,
+                                 summaryInterval);
+        if (result == 0 && !tracePath.empty()) {
+            try {
+                Profiler::writeChromeTrace(tracePath);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        }
+        return result;
+    }
+
+    if (processes > 0) {
+        return runDistributed(simulator, processes, rebalanceInterval, curve, steps, dt);
+    }
+
+    if (checkSamples > 0) {
+        auto checkStart = std::chrono::steady_clock::now();
+        ForceError error = simulator.checkForces(checkSamples, seed);
+        double checkSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - checkStart).count();
+        std::cout << "Force error against direct summation over " << error.samples << " bodies: rms "
+                  << error.rms << ", max " << error.max << ", normalised " << error.normalized << " ("
+                  << checkSeconds << " s)" << std::endl;
+    }
+
+    std::cout << "Running " << steps << " steps of " << dt << " s on " << simulator.getBodies().size()
+              << " bodies with " << simulator.getThreadCount() << " thread(s)" << std::endl;
+
+    std::unique_ptr<StateStream> output;
+    CheckpointWriter checkpoints;
+    simulator.getEvents().setEnabled(eventInterval > 0.0);
+    EventReporter events(simulator.getEvents(), std::cerr, eventInterval);
+    simulator.setConservationChecks(conservationInterval, driftThreshold);
+    auto start = std::chrono::steady_clock::now();
+    try {
+        if (!outputPath.empty()) {
+            output = std::make_unique<StateStream>(outputPath, compress ? StateStream::Compression::Delta
+                                                                        : StateStream::Compression::None);
+            simulator.setOutput(output.get(), outputInterval);
+        }
+        for (long long step = 0; step < steps; ++step) {
+            simulator.update(dt);
+            events.poll();
+            if (!checkpointPath.empty() && checkpointInterval > 0 && (step + 1) % checkpointInterval == 0
+                && step + 1 < steps) {
+                checkpoints.save(simulator, checkpointPath);
+            }
+            if (conservationInterval > 0 && (step + 1) % static_cast<long long>(conservationInterval) == 0) {
+                printConservation(std::cout, simulator);
+            }
+            if (profileInterval > 0 && (step + 1) % profileInterval == 0) {
+                Profiler::printSummary(std::cout);
+            }
+        }
+        events.flush();
+        if (!checkpointPath.empty()) {
+            checkpoints.save(simulator, checkpointPath);
+            checkpoints.wait();
+        }
+        if (output) {
+            simulator.setOutput(nullptr);
+            output->close();
+        }
+        if (!tracePath.empty()) {
+            Profiler::writeChromeTrace(tracePath);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Simulated time: " << steps * dt << " s\n"
+              << "Wall time:      " << wallSeconds << " s\n"
+              << "Steps/second:   " << (wallSeconds > 0.0 ? steps / wallSeconds : 0.0) << "\n"
+              << "Bodies left:    " << simulator.getBodies().size() << "\n"
+              << "Force evals:    " << simulator.getForceEvaluations() << std::endl;
+    if (simulator.getEvents().isEnabled()) {
+        const EventCounts counts = simulator.getEvents().getCounts();
+        std::cout << "Events:         " << counts[EventType::Merge] << " merges, "
+                  << counts[EventType::CloseEncounter] << " close encounters, "
+                  << counts[EventType::SoftenedForce] << " softened pair forces, "
+                  << counts[EventType::NonFiniteForce] << " rejected non-finite forces, "
+                  << counts[EventType::ConservationDrift] << " conservation drifts" << std::endl;
+    }
+    if (output) {
+        std::cout << "Frames written: " << output->getFramesWritten() << ", "
+                  << output->getBytesWritten() / 1e6 << " MB (" << output->getRawBytes() / 1e6 << " MB uncompressed)"
+                  << std::endl;
+    }
+    return 0;
+}
@@ -3,72 +3,138 @@
 //
 #include "Simulator.h"
 #include "Renderer.h"
+#include "Checkpoint.h"
+#include "Profiler.h"
+#include "Scenario.h"
+#include "SimulationThread.h"
+#include <algorithm>
 #include <chrono>
+#include <iostream>
+#include <string>
 #include <thread>
 
-glm::dvec3 calculateOrbitalVelocity(double centralMass, double distance) {
-    const double G = 6.67430e-11;
-    double speed = std::sqrt(G * centralMass / distance);
-    return glm::dvec3(0, speed, 0);  // Assuming orbit in the XZ plane
-}
-
-int main() {
+int main(int argc, char* argv[]) {
     Simulator simulator;
-    Renderer renderer(1600, 1200);
-
-    double sunMass = 1.989e30;
-
-    // Sun (at the center)
-    simulator.addBody(CelestialBody(sunMass, glm::dvec3(0, 0, 0), glm::dvec3(0, 0, 0), 6.96e8));
-
-    // Mercury
-    double mercuryDist = 57.9e9;
-    simulator.addBody(CelestialBody(3.285e23, glm::dvec3(mercuryDist, 0, 0), calculateOrbitalVelocity(sunMass, mercuryDist), 2.44e6));
-
-    // Venus
-    double venusDist = 108.2e9;
-    simulator.addBody(CelestialBody(4.867e24, glm::dvec3(venusDist, 0, 0), calculateOrbitalVelocity(sunMass, venusDist), 6.05e6));
-
-    // Earth
-    double earthDist = 149.6e9;
-    simulator.addBody(CelestialBody(5.972e24, glm::dvec3(earthDist, 0, 0), calculateOrbitalVelocity(sunMass, earthDist), 6.37e6));
-
-    // Mars
-    double marsDist = 227.9e9;
-    simulator.addBody(CelestialBody(6.39e23, glm::dvec3(marsDist, 0, 0), calculateOrbitalVelocity(sunMass, marsDist), 3.39e6));
-
-    // Jupiter
-    double jupiterDist = 778.5e9;
-    simulator.addBody(CelestialBody(1.898e27, glm::dvec3(jupiterDist, 0, 0), calculateOrbitalVelocity(sunMass, jupiterDist), 69.91e6));
-
-    // Saturn
-    double saturnDist = 1.429e12;
-    simulator.addBody(CelestialBody(5.683e26, glm::dvec3(saturnDist, 0, 0), calculateOrbitalVelocity(sunMass, saturnDist), 58.23e6));
-
-    // Uranus
-    double uranusDist = 2.871e12;
-    simulator.addBody(CelestialBody(8.681e25, glm::dvec3(uranusDist, 0, 0), calculateOrbitalVelocity(sunMass, uranusDist ), 25.36e6));
-
-    // Neptune
-    double neptuneDist = 4.495e12;
-    simulator.addBody(CelestialBody(1.024e26, glm::dvec3(neptuneDist, 0, 0), calculateOrbitalVelocity(sunMass, neptuneDist), 24.62e6));
-
-    // Pluto
-    double plutoDist = 5.906e12;
-    simulator.addBody(CelestialBody(1.309e22, glm::dvec3(plutoDist, 0, 0), calculateOrbitalVelocity(sunMass, plutoDist), 1.18e6));
-
+    simulator.setThreadCount(std::thread::hardware_concurrency());
+    std::string scenario = "solar";
+    size_t bodyCount = 1000;
+    unsigned seed = 1;
+    size_t spriteThreshold = 10000;
+    double timeScale = 225000.0;  // Simulated seconds per wall second, one hour per 16 ms
+    std::string restartPath;
+    bool profile = false;
+    std::string tracePath;
+    GridStyle gridStyle = GridStyle::Sheet;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--barnes-hut") {
+            simulator.setForceSolver(ForceSolver::BarnesHut);
+        } else if (arg == "--fmm") {
+            simulator.setForceSolver(ForceSolver::FastMultipole);
+        } else if (arg == "--theta" && i + 1 < argc) {
+            simulator.setOpeningAngle(std::stod(argv[++i]));
+        } else if (arg == "--order" && i + 1 < argc) {
+            simulator.setMultipoleOrder(std::stoi(argv[++i]));
+        } else if (arg == "--pm") {
+            simulator.setForceSolver(ForceSolver::ParticleMesh);
+        } else if (arg == "--mesh" && i + 1 < argc) {
+            simulator.setMeshSize(std::stoul(argv[++i]));
+        } else if (arg == "--integrator" && i + 1 < argc) {
+            std::string name = argv[++i];
+            simulator.setIntegrator(name == "yoshida4" ? Integrator::Yoshida4
+                                    : name == "constant" ? Integrator::ConstantAcceleration
+                                    : Integrator::Leapfrog);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            simulator.setThreadCount(std::stoul(argv[++i]));
+        } else if (arg == "--scenario" && i + 1 < argc) {
+            scenario = argv[++i];
+        } else if (arg == "--bodies" && i + 1 < argc) {
+            bodyCount = std::stoul(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--sprite-threshold" && i + 1 < argc) {
+            spriteThreshold = std::stoul(argv[++i]);
+        } else if (arg == "--time-scale" && i + 1 < argc) {
+            timeScale = std::stod(argv[++i]);
+        } else if (arg == "--restart" && i + 1 < argc) {
+            restartPath = argv[++i];
+        } else if (arg == "--profile") {
+            profile = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--grid" && i + 1 < argc) {
+            std::string name = argv[++i];
+            gridStyle = name == "flat" ? GridStyle::Flat
+                        : name == "heatmap" ? GridStyle::Heatmap
+                        : GridStyle::Sheet;
+        }
+    }
+    if ((profile || !tracePath.empty()) && !Profiler::ENABLED) {
+        std::cerr << "Built without GRAVITY_PROFILE, --profile and --trace have no effect" << std::endl;
+    }
+    Profiler::setThreadName("render");
+    Profiler::setTracing(!tracePath.empty());
+
+    if (!restartPath.empty()) {
+        try {
+            Checkpoint::load(simulator, restartPath);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    } else {
+        try {
+            if (!loadScenario(simulator, scenario, bodyCount, seed)) {
+                std::cerr << "Unknown scenario: " << scenario << std::endl;
+                return 1;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
 
+    Renderer renderer(1600, 1200);
+    renderer.setSpriteThreshold(spriteThreshold);
+    renderer.setGridStyle(gridStyle);
+    // A share of the cores, the rest are the simulation's
+    renderer.setFieldThreadCount(std::max(1u, std::thread::hardware_concurrency() / 4));
 
     const float dt = 3600.0f; // Time step of 1 hour
 
+    // The simulator runs on its own thread from here on, the render loop
+    // only reads the snapshots it publishes
+    SimulationThread simulation(simulator, dt);
+    simulation.setTimeScale(timeScale);
+    simulation.setCaptureTrajectories(renderer.needsTrajectories());
+    simulation.start();
+
+    // Drained here, off the simulation thread
+    EventReporter events(simulator.getEvents(), std::cerr, 2.0);
+    auto lastSummary = std::chrono::steady_clock::now();
     while (!renderer.shouldClose()) {
         renderer.processInput();
-        simulator.update(dt);
-        renderer.render(simulator);
+        renderer.render(simulation.latest());
         renderer.swapBuffers();
+        events.poll();
 
+        if (profile && std::chrono::steady_clock::now() - lastSummary >= std::chrono::seconds(2)) {
+            Profiler::printSummary(std::cout);
+            lastSummary = std::chrono::steady_clock::now();
+        }
         std::this_thread::sleep_for(std::chrono::milliseconds(16));
     }
+    simulation.stop();
+    events.flush();
+
+    if (!tracePath.empty()) {
+        try {
+            Profiler::writeChromeTrace(tracePath);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
 
     return 0;
-}
\ No newline at end of file
+}